@@ -149,3 +149,161 @@ int mutt_from_base64 (char *out, const char *in, size_t olen)
 
   return len;
 }
+
+/*
+ * Block codec used for MIME bodies (sendlib.c, handler.c).  The state
+ * structures let callers feed arbitrarily sized buffers.
+ */
+
+/* line length of encoded bodies, a multiple of 4 */
+#define B64_LINELEN 72
+
+static inline void b64_encode_group (char *out, const unsigned char *in)
+{
+  out[0] = B64Chars[in[0] >> 2];
+  out[1] = B64Chars[((in[0] << 4) & 0x30) | (in[1] >> 4)];
+  out[2] = B64Chars[((in[1] << 2) & 0x3c) | (in[2] >> 6)];
+  out[3] = B64Chars[in[2] & 0x3f];
+}
+
+/* Encodes len bytes of in, breaking the output into lines of
+ * B64_LINELEN characters.  An incomplete group is kept in enc for
+ * the next call.  out must hold B64_ENCODE_SIZE(len) bytes.
+ * Returns the number of characters written; out is not terminated. */
+size_t mutt_b64_encode_block (B64_ENCODER *enc, char *out,
+                              const unsigned char *in, size_t len)
+{
+  char *o = out;
+  size_t n;
+
+  /* complete the group left over from the last call */
+  while (enc->ncarry && len)
+  {
+    enc->carry[enc->ncarry++] = *in++;
+    len--;
+    if (enc->ncarry == 3)
+    {
+      if (enc->linelen >= B64_LINELEN)
+      {
+        *o++ = '\n';
+        enc->linelen = 0;
+      }
+      b64_encode_group (o, enc->carry);
+      o += 4;
+      enc->linelen += 4;
+      enc->ncarry = 0;
+    }
+  }
+
+  while (len >= 3)
+  {
+    if (enc->linelen >= B64_LINELEN)
+    {
+      *o++ = '\n';
+      enc->linelen = 0;
+    }
+    /* the rest of this line in one go */
+    for (n = MIN (len / 3, (B64_LINELEN - enc->linelen) / 4); n; n--)
+    {
+      b64_encode_group (o, in);
+      o += 4;
+      in += 3;
+      len -= 3;
+      enc->linelen += 4;
+    }
+  }
+
+  while (len--)
+    enc->carry[enc->ncarry++] = *in++;
+
+  return o - out;
+}
+
+/* Writes the padded final group, if any.  out must hold 6 bytes.
+ * Returns the number of characters written. */
+size_t mutt_b64_encode_finish (B64_ENCODER *enc, char *out)
+{
+  char *o = out;
+
+  if (!enc->ncarry)
+    return 0;
+
+  if (enc->linelen >= B64_LINELEN)
+  {
+    *o++ = '\n';
+    enc->linelen = 0;
+  }
+
+  if (enc->ncarry < 2)
+    enc->carry[1] = 0;
+  enc->carry[2] = 0;
+  b64_encode_group (o, enc->carry);
+  if (enc->ncarry < 2)
+    o[2] = '=';
+  o[3] = '=';
+  o += 4;
+  enc->linelen += 4;
+  enc->ncarry = 0;
+
+  return o - out;
+}
+
+/* Decodes len characters of in, skipping anything outside the base64
+ * alphabet and stopping at padding.  out must hold len * 3 / 4 + 3
+ * bytes.  Returns the number of bytes written. */
+size_t mutt_b64_decode_block (B64_DECODER *dec, char *out, const char *in,
+                              size_t len)
+{
+  const unsigned char *i = (const unsigned char *) in;
+  const unsigned char *end = i + len;
+  char *o = out;
+  int c1, c2, c3, c4;
+
+  if (dec->done)
+    return 0;
+
+  while (i < end)
+  {
+    /* fast path: a whole group of valid characters.  base64val() is
+     * -1 for anything else, so one test covers all four. */
+    if (!dec->nbits && end - i >= 4 && (i[0] | i[1] | i[2] | i[3]) < 128 &&
+        ((c1 = base64val (i[0])) | (c2 = base64val (i[1])) |
+         (c3 = base64val (i[2])) | (c4 = base64val (i[3]))) >= 0)
+    {
+      *o++ = (c1 << 2) | (c2 >> 4);
+      *o++ = (c2 << 4) | (c3 >> 2);
+      *o++ = (c3 << 6) | c4;
+      i += 4;
+      continue;
+    }
+
+    c1 = *i++;
+    if (c1 == '=')
+    {
+      if (dec->nbits == 2)
+        *o++ = dec->bits >> 4;
+      else if (dec->nbits == 3)
+      {
+        *o++ = dec->bits >> 10;
+        *o++ = dec->bits >> 2;
+      }
+      dec->nbits = 0;
+      dec->done = 1;
+      break;
+    }
+    if (c1 > 127 || (c1 = base64val (c1)) == BAD)
+      continue;
+
+    dec->bits = (dec->bits << 6) | c1;
+    if (++dec->nbits == 4)
+    {
+      *o++ = dec->bits >> 16;
+      *o++ = dec->bits >> 8;
+      *o++ = dec->bits;
+      dec->bits = 0;
+      dec->nbits = 0;
+    }
+  }
+
+  return o - out;
+}
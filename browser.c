@@ -39,6 +39,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <locale.h>
 
@@ -81,6 +82,29 @@ static void destroy_state (struct browser_state *state)
   FREE (&state->entry);
 }
 
+/* Fills in the lstat() fields of an entry that examine_directory() only
+ * knew the file type of.  Called before the entry is displayed, or
+ * sorted by date or size. */
+static void browser_stat_entry (struct folder_file *ff)
+{
+  struct stat s;
+
+  if (!ff->stat_pending)
+    return;
+  ff->stat_pending = 0;
+
+  if (lstat (ff->full_path, &s) == -1)
+    return;
+
+  ff->mode = s.st_mode;
+  ff->mtime = s.st_mtime;
+  /* No size for directories or symlinks */
+  ff->size = (S_ISDIR (s.st_mode) || S_ISLNK (s.st_mode)) ? 0 : s.st_size;
+  ff->gid = s.st_gid;
+  ff->uid = s.st_uid;
+  ff->nlink = s.st_nlink;
+}
+
 /* This is set by browser_sort() */
 static int sort_reverse_flag = 0;
 
@@ -149,6 +173,7 @@ static void browser_sort (struct browser_state *state)
   int (*f) (const void *, const void *);
   short sort_variable;
   unsigned int first_sort_index = 0;
+  int need_stat = 0;
 
   sort_variable = state->buffy ? BrowserSortMailboxes : BrowserSort;
 
@@ -159,9 +184,11 @@ static void browser_sort (struct browser_state *state)
       break;
     case SORT_DATE:
       f = browser_compare_date;
+      need_stat = 1;
       break;
     case SORT_SIZE:
       f = browser_compare_size;
+      need_stat = 1;
       break;
     case SORT_COUNT:
       f = browser_compare_count;
@@ -177,6 +204,14 @@ static void browser_sort (struct browser_state *state)
 
   sort_reverse_flag = (sort_variable & SORT_REVERSE) ? 1 : 0;
 
+  if (need_stat)
+  {
+    unsigned int i;
+
+    for (i = 0; i < state->entrylen; i++)
+      browser_stat_entry (&state->entry[i]);
+  }
+
   /* Keep the ".." entry at the top in file mode. */
   if (!state->buffy)
   {
@@ -531,6 +566,47 @@ static void init_state (struct browser_state *state, MUTTMENU *menu)
     menu->data = state->entry;
 }
 
+/* Finds the file type of a directory entry.  When readdir() already
+ * reports it, the lstat() is deferred to browser_stat_entry(), so that
+ * a large directory doesn't need one before the browser is shown.
+ * Sets *pending in that case.  Returns -1 if the entry can't be
+ * examined. */
+static int examine_dirent (DIR *dp, struct dirent *de, const char *full_path,
+                           struct stat *s, int *pending)
+{
+  memset (s, 0, sizeof (struct stat));
+  *pending = 0;
+
+#ifdef HAVE_DIRENT_D_TYPE
+  switch (de->d_type)
+  {
+    case DT_REG:
+      s->st_mode = S_IFREG;
+      *pending = 1;
+      return 0;
+    case DT_DIR:
+      s->st_mode = S_IFDIR;
+      *pending = 1;
+      return 0;
+    case DT_LNK:
+      s->st_mode = S_IFLNK;
+      *pending = 1;
+      return 0;
+    case DT_UNKNOWN:
+      break;
+    default:
+      /* not listed by the browser */
+      return -1;
+  }
+#endif
+
+#if defined(HAVE_FSTATAT) && defined(HAVE_DIRFD)
+  return fstatat (dirfd (dp), de->d_name, s, AT_SYMLINK_NOFOLLOW);
+#else
+  return lstat (full_path, s);
+#endif
+}
+
 static int examine_directory (MUTTMENU *menu, struct browser_state *state,
 			      const char *d, const char *prefix)
 {
@@ -539,6 +615,7 @@ static int examine_directory (MUTTMENU *menu, struct browser_state *state,
   struct dirent *de;
   BUFFER *full_path = NULL;
   BUFFY *tmp;
+  int pending;
 
   while (stat (d, &s) == -1)
   {
@@ -585,7 +662,7 @@ static int examine_directory (MUTTMENU *menu, struct browser_state *state,
       continue;
 
     mutt_buffer_concat_path (full_path, d, de->d_name);
-    if (lstat (mutt_b2s (full_path), &s) == -1)
+    if (examine_dirent (dp, de, mutt_b2s (full_path), &s, &pending) == -1)
       continue;
 
     /* No size for directories or symlinks */
@@ -594,9 +671,7 @@ static int examine_directory (MUTTMENU *menu, struct browser_state *state,
     else if (! S_ISREG (s.st_mode))
       continue;
 
-    tmp = Incoming;
-    while (tmp && mutt_strcmp (mutt_b2s (full_path), mutt_b2s (tmp->pathbuf)))
-      tmp = tmp->next;
+    tmp = mutt_buffy_find_path (mutt_b2s (full_path));
     if (tmp && Context && !tmp->nopoll &&
         !mutt_strcmp (tmp->realpath, Context->realpath))
     {
@@ -604,6 +679,7 @@ static int examine_directory (MUTTMENU *menu, struct browser_state *state,
       tmp->msg_unread = Context->unread;
     }
     add_folder (menu, state, de->d_name, mutt_b2s (full_path), &s, tmp);
+    state->entry[state->entrylen - 1].stat_pending = pending;
   }
   closedir (dp);
   browser_sort (state);
@@ -706,6 +782,8 @@ static void folder_entry (char *s, size_t slen, MUTTMENU *menu, int num)
   folder.ff = &((struct folder_file *) menu->data)[num];
   folder.num = num;
 
+  browser_stat_entry (folder.ff);
+
   mutt_FormatString (s, slen, 0, MuttIndexWindow->cols, NONULL(FolderFormat), folder_format_str,
                      &folder, MUTT_FORMAT_ARROWCURSOR);
 }
@@ -45,6 +45,7 @@ struct folder_file
 #endif
   unsigned has_buffy : 1;
   unsigned local : 1; /* folder is on local filesystem */
+  unsigned stat_pending : 1; /* only the file type in mode is known */
   unsigned tagged : 1;
 };
 
@@ -41,6 +41,10 @@
 #include "monitor.h"
 #endif
 
+#ifdef USE_HCACHE
+#include "hcache.h"
+#endif
+
 #include <string.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -48,6 +52,8 @@
 #include <utime.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sys/wait.h>
 
 #include <stdio.h>
 
@@ -57,7 +63,15 @@ time_t BuffyDoneTime = 0;	/* last time we knew for sure how much mail there was.
 static short BuffyCount = 0;	/* how many boxes with new mail */
 static short BuffyNotify = 0;	/* # of unnotified new boxes */
 
+/* Incoming is also indexed by path and by realpath, so that looking up a
+ * mailbox doesn't walk the whole list.  BuffyTail is where the next
+ * mailbox is appended. */
+static HASH *BuffyPathHash = NULL;
+static HASH *BuffyRealpathHash = NULL;
+static BUFFY **BuffyTail = &Incoming;
+
 static BUFFY* buffy_get (const char *path);
+static BUFFY *find_buffy (const char *path);
 
 /* Find the last message in the file.
  * upon success return 0. If no message found - return -1 */
@@ -204,6 +218,9 @@ BUFFY *mutt_find_mailbox (const char *path)
   if (stat (path,&sb) != 0)
     return NULL;
 
+  if ((tmp = find_buffy (path)) != NULL)
+    return tmp;
+
   for (tmp = Incoming; tmp; tmp = tmp->next)
   {
     if (stat (mutt_b2s (tmp->pathbuf), &tmp_sb) ==0 &&
@@ -255,18 +272,84 @@ static void buffy_free (BUFFY **mailbox)
   FREE (mailbox); /* __FREE_CHECKED__ */
 }
 
-static BUFFY **find_buffy_slot (const char *path)
+/* Appends a new mailbox to Incoming and indexes it */
+static void buffy_link (BUFFY *buffy)
+{
+  if (!BuffyPathHash)
+  {
+    BuffyPathHash = hash_create (1031, MUTT_HASH_STRDUP_KEYS |
+                                 MUTT_HASH_ALLOW_DUPS);
+    BuffyRealpathHash = hash_create (1031, MUTT_HASH_ALLOW_DUPS);
+  }
+
+  *BuffyTail = buffy;
+  BuffyTail = &buffy->next;
+
+  hash_insert (BuffyPathHash, mutt_b2s (buffy->pathbuf), buffy);
+  hash_insert (BuffyRealpathHash, buffy->realpath, buffy);
+}
+
+/* Removes a mailbox from Incoming and from the indexes */
+static void buffy_unlink (BUFFY *buffy)
+{
+  BUFFY **slot;
+
+  for (slot = &Incoming; *slot && *slot != buffy; slot = &((*slot)->next))
+    ;
+  if (!*slot)
+    return;
+
+  *slot = buffy->next;
+  if (BuffyTail == &buffy->next)
+    BuffyTail = slot;
+
+  hash_delete (BuffyPathHash, mutt_b2s (buffy->pathbuf), buffy, NULL);
+  hash_delete (BuffyRealpathHash, buffy->realpath, buffy, NULL);
+}
+
+/* Expands the path of a mailbox in place, keeping BuffyPathHash in step.
+ * This must be done late because e.g. IMAP delimiter may change. */
+static void buffy_expand_path (BUFFY *buffy)
+{
+  BUFFER *old;
+
+  old = mutt_buffer_pool_get ();
+  mutt_buffer_strcpy (old, mutt_b2s (buffy->pathbuf));
+
+  mutt_buffer_expand_path (buffy->pathbuf);
+  if (mutt_strcmp (mutt_b2s (old), mutt_b2s (buffy->pathbuf)))
+  {
+    hash_delete (BuffyPathHash, mutt_b2s (old), buffy, NULL);
+    hash_insert (BuffyPathHash, mutt_b2s (buffy->pathbuf), buffy);
+  }
+
+  mutt_buffer_pool_release (&old);
+}
+
+/* Returns the mailbox whose path is exactly path, or NULL */
+BUFFY *mutt_buffy_find_path (const char *path)
+{
+  if (!path)
+    return NULL;
+  return hash_find (BuffyPathHash, path);
+}
+
+/* Returns the mailbox whose realpath is rp, or NULL */
+BUFFY *mutt_buffy_find_realpath (const char *rp)
+{
+  if (!rp)
+    return NULL;
+  return hash_find (BuffyRealpathHash, rp);
+}
+
+/* Returns the mailbox with the same realpath as path, or NULL */
+static BUFFY *find_buffy (const char *path)
 {
   const char *p;
   char rp[PATH_MAX];
-  BUFFY **slot;
 
   p = realpath (path, rp);
-  for (slot = &Incoming; *slot; slot = &((*slot)->next))
-    if (mutt_strcmp (p ? p : path, (*slot)->realpath) == 0)
-      break;
-
-  return slot;
+  return mutt_buffy_find_realpath (p ? p : path);
 }
 
 /* To avoid overwriting existing values:
@@ -276,7 +359,7 @@ static BUFFY **find_buffy_slot (const char *path)
  */
 void mutt_buffy_add (const char *path, const char *label, int nopoll, int nonotify)
 {
-  BUFFY **tmp;
+  BUFFY *tmp;
   struct stat sb;
   int new = 0;
 
@@ -285,42 +368,43 @@ void mutt_buffy_add (const char *path, const char *label, int nopoll, int nonoti
 
   dprint (3, (debugfile, "mutt_buffy_add: %s\n", path));
 
-  tmp = find_buffy_slot (path);
-  if (!*tmp)
+  tmp = find_buffy (path);
+  if (!tmp)
   {
     new = 1;
-    *tmp = buffy_new (path);
+    tmp = buffy_new (path);
+    buffy_link (tmp);
 #ifdef USE_SIDEBAR
-    mutt_sb_notify_mailbox (*tmp, 1);
+    mutt_sb_notify_mailbox (tmp, 1);
 #endif
   }
 
   if (label)
-    mutt_str_replace (&(*tmp)->label, label);
+    mutt_str_replace (&tmp->label, label);
 
   if (nopoll == -1)
-    nopoll = (*tmp)->nopoll;
+    nopoll = tmp->nopoll;
 
-  if (new || (nopoll != (*tmp)->nopoll))
+  if (new || (nopoll != tmp->nopoll))
   {
-    (*tmp)->nopoll = nopoll;
+    tmp->nopoll = nopoll;
 #ifdef USE_INOTIFY
     if (!nopoll)
     {
-      (*tmp)->magic = mx_get_magic (mutt_b2s ((*tmp)->pathbuf));
-      mutt_monitor_add (*tmp);
+      tmp->magic = mx_get_magic (mutt_b2s (tmp->pathbuf));
+      mutt_monitor_add (tmp);
     }
     else
-      mutt_monitor_remove (*tmp);
+      mutt_monitor_remove (tmp);
 #endif
   }
 
   if (nonotify != -1)
-      (*tmp)->nonotify = nonotify;
+      tmp->nonotify = nonotify;
 
-  (*tmp)->new = 0;
-  (*tmp)->notified = 1;
-  (*tmp)->newly_created = 0;
+  tmp->new = 0;
+  tmp->notified = 1;
+  tmp->newly_created = 0;
 
   /* for check_mbox_size, it is important that if the folder is new (tested by
    * reading it), the size is set to 0 so that later when we check we see
@@ -328,46 +412,40 @@ void mutt_buffy_add (const char *path, const char *label, int nopoll, int nonoti
    */
   if (!nopoll &&
       option(OPTCHECKMBOXSIZE) &&
-      stat (mutt_b2s ((*tmp)->pathbuf), &sb) == 0 &&
-      !test_new_folder (mutt_b2s ((*tmp)->pathbuf)))
+      stat (mutt_b2s (tmp->pathbuf), &sb) == 0 &&
+      !test_new_folder (mutt_b2s (tmp->pathbuf)))
   {
     /* some systems out there don't have an off_t type */
-    (*tmp)->size = (off_t) sb.st_size;
+    tmp->size = (off_t) sb.st_size;
   }
   else
-    (*tmp)->size = 0;
+    tmp->size = 0;
 }
 
-static void buffy_remove (BUFFY **pbuffy)
+static void buffy_remove (BUFFY *buffy)
 {
-  BUFFY *next;
-
-  next = (*pbuffy)->next;
-
 #ifdef USE_SIDEBAR
-  mutt_sb_notify_mailbox (*pbuffy, 0);
+  mutt_sb_notify_mailbox (buffy, 0);
 #endif
 #ifdef USE_INOTIFY
-  if (!(*pbuffy)->nopoll)
-    mutt_monitor_remove (*pbuffy);
+  if (!buffy->nopoll)
+    mutt_monitor_remove (buffy);
 #endif
-  buffy_free (pbuffy);
-
-  *pbuffy = next;
+  buffy_unlink (buffy);
+  buffy_free (&buffy);
 }
 
 void mutt_buffy_remove (const char *path)
 {
-  BUFFY **pbuffy;
+  BUFFY *buffy;
 
   if (!path || !*path)
     return;
 
   dprint (3, (debugfile, "mutt_buffy_remove: %s\n", path));
 
-  pbuffy = find_buffy_slot (path);
-  if (*pbuffy)
-    buffy_remove (pbuffy);
+  if ((buffy = find_buffy (path)) != NULL)
+    buffy_remove (buffy);
 }
 
 int mutt_parse_mailboxes (BUFFER *path, BUFFER *s, union pointer_long_t udata,
@@ -448,7 +526,7 @@ cleanup:
 
 int mutt_parse_unmailboxes (BUFFER *path, BUFFER *s, union pointer_long_t udata, BUFFER *err)
 {
-  BUFFY **pbuffy;
+  BUFFY *buffy;
 
   while (MoreArgs (s))
   {
@@ -456,9 +534,8 @@ int mutt_parse_unmailboxes (BUFFER *path, BUFFER *s, union pointer_long_t udata,
 
     if (mutt_strcmp(mutt_b2s (path),"*") == 0)
     {
-      pbuffy = &Incoming;
-      while (*pbuffy)
-        buffy_remove (pbuffy);
+      while (Incoming)
+        buffy_remove (Incoming);
       return 0;
     }
 
@@ -466,9 +543,8 @@ int mutt_parse_unmailboxes (BUFFER *path, BUFFER *s, union pointer_long_t udata,
     if (!mutt_buffer_len (path))
       continue;
 
-    pbuffy = find_buffy_slot (mutt_b2s (path));
-    if (*pbuffy)
-      buffy_remove (pbuffy);
+    if ((buffy = find_buffy (mutt_b2s (path))) != NULL)
+      buffy_remove (buffy);
   }
   return 0;
 }
@@ -588,6 +664,277 @@ static int buffy_maildir_check (BUFFY* mailbox, int check_stats)
   return rc;
 }
 
+/* Skips the rest of a line that fgets() cut short at the end of buf.
+ * Like mutt_read_rfc822_header(), which reads header lines whole, this
+ * keeps the tail of a long header line from being taken for a header
+ * field or for the separator of another message.
+ */
+static void buffy_mbox_skip_line (const char *buf, FILE *fp)
+{
+  char skip[STRING];
+  size_t len;
+
+  len = strlen (buf);
+  if (len && buf[len - 1] != '\n')
+    while (fgets (skip, sizeof (skip), fp) != NULL &&
+           (len = strlen (skip)) && skip[len - 1] != '\n')
+      ;
+}
+
+/* Reads one mbox header for buffy_mbox_scan(), noting the Status:,
+ * X-Status: and Content-Length: fields.  Like mutt_read_rfc822_header(),
+ * the header ends at an empty line, or before the first line that is
+ * not a header field, which is left unread.
+ */
+static void buffy_mbox_scan_header (FILE *fp, char *buf, size_t buflen,
+                                    int *read, int *flagged, LOFF_T *length)
+{
+  char return_path[STRING];
+  char *p;
+  LOFF_T loc;
+  time_t t;
+
+  while ((loc = ftello (fp)), fgets (buf, buflen, fp) != NULL)
+  {
+    buffy_mbox_skip_line (buf, fp);
+
+    if (*buf == ' ' || *buf == '\t')
+      continue;
+    if (*buf == '\n' || (*buf == '\r' && buf[1] == '\n'))
+      break;
+
+    if ((p = strpbrk (buf, ": \t")) == NULL || *p != ':')
+    {
+      if (mutt_strncmp (">From ", buf, 6) == 0 ||
+          is_from (buf, return_path, sizeof (return_path), &t))
+        continue;
+      fseeko (fp, loc, SEEK_SET);
+      break;
+    }
+
+    p++;
+    SKIPWS (p);
+    if (ascii_strncasecmp ("status:", buf, 7) == 0)
+    {
+      if (strchr (p, 'R'))
+        *read = 1;
+    }
+    else if (ascii_strncasecmp ("x-status:", buf, 9) == 0)
+    {
+      if (strchr (p, 'F'))
+        *flagged = 1;
+    }
+    else if (ascii_strncasecmp ("content-length:", buf, 15) == 0)
+    {
+      mutt_remove_trailing_ws (p);
+      if (mutt_atolofft (p, length, 0) < 0)
+        *length = -1;
+    }
+  }
+}
+
+#ifdef USE_HCACHE
+/* What buffy_mbox_scan() counted, kept in the folder's header cache
+ * so that the next session can start from it. */
+typedef struct
+{
+  LOFF_T size;          /* bytes counted */
+  time_t mtime;         /* of the folder then, 0 if it might still change */
+  int count;
+  int unread;
+  int flagged;
+} BUFFY_MBOX_SCAN;
+
+#define BUFFY_MBOX_SCAN_KEY "/MBOXSTATS"
+
+/* Picks up the counts saved by an earlier session, unless scan_size
+ * already holds counts of this session.  Returns 1 if the folder hasn't
+ * changed since they were saved, so that they can be used as they are.
+ */
+static int buffy_mbox_scan_fetch (BUFFY *mailbox, struct stat *sb)
+{
+  header_cache_t *hc;
+  void *data;
+  BUFFY_MBOX_SCAN scan;
+  int rc = 0;
+
+  if (mailbox->scan_size != 0 ||
+      !(hc = mutt_hcache_open (HeaderCache, mutt_b2s (mailbox->pathbuf), NULL)))
+    return 0;
+
+  data = mutt_hcache_fetch_raw (hc, BUFFY_MBOX_SCAN_KEY, mutt_strlen);
+  if (data)
+  {
+    memcpy (&scan, data, sizeof (scan));
+    mutt_hcache_free (&data);
+
+    mailbox->scan_size = scan.size;
+    mailbox->scan_count = scan.count;
+    mailbox->scan_unread = scan.unread;
+    mailbox->scan_flagged = scan.flagged;
+    rc = scan.mtime && scan.mtime == sb->st_mtime && scan.size == sb->st_size;
+  }
+  mutt_hcache_close (hc);
+
+  return rc;
+}
+
+static void buffy_mbox_scan_store (BUFFY *mailbox, struct stat *sb)
+{
+  header_cache_t *hc;
+  BUFFY_MBOX_SCAN scan;
+
+  if (!(hc = mutt_hcache_open (HeaderCache, mutt_b2s (mailbox->pathbuf), NULL)))
+    return;
+
+  memset (&scan, 0, sizeof (scan));
+  scan.size = mailbox->scan_size;
+  /* a folder modified within this second may change again unnoticed */
+  if (sb->st_mtime < time (NULL))
+    scan.mtime = sb->st_mtime;
+  scan.count = mailbox->scan_count;
+  scan.unread = mailbox->scan_unread;
+  scan.flagged = mailbox->scan_flagged;
+
+  mutt_hcache_store_raw (hc, BUFFY_MBOX_SCAN_KEY, &scan, sizeof (scan),
+                         mutt_strlen);
+  mutt_hcache_close (hc);
+}
+#endif /* USE_HCACHE */
+
+/* Counts the messages of an mbox folder without parsing them into
+ * headers, following the separator and Content-Length rules of
+ * mbox_parse_mailbox().  If the folder only grew since the last scan,
+ * which like mbox_check_mailbox() is assumed when a message separator
+ * is found at exactly the old end of the folder, only the appended
+ * messages are read.  With the header cache, the counts are saved for
+ * the next session too.
+ * Returns 0 on success, -1 on error.
+ */
+static int buffy_mbox_scan (BUFFY *mailbox, struct stat *sb)
+{
+  FILE *fp;
+  const char *path = mutt_b2s (mailbox->pathbuf);
+  char buf[HUGE_STRING], return_path[STRING];
+  LOFF_T loc, tmploc, length;
+  int count = 0, unread = 0, flagged = 0;
+  int read, flag, locked;
+  time_t t;
+
+#ifdef USE_HCACHE
+  if (buffy_mbox_scan_fetch (mailbox, sb))
+  {
+    mailbox->msg_count = mailbox->scan_count;
+    mailbox->msg_unread = mailbox->scan_unread;
+    mailbox->msg_flagged = mailbox->scan_flagged;
+    mutt_get_stat_timespec (&mailbox->stats_last_checked, sb, MUTT_STAT_MTIME);
+    return 0;
+  }
+#endif
+
+  if ((fp = fopen (path, "r")) == NULL)
+    return -1;
+
+  /* a lock failure just risks counting a message being delivered */
+  locked = !mx_lock_file (path, fileno (fp), 0, 1, 1);
+
+  loc = 0;
+  if (mailbox->scan_size > 0 && sb->st_size > mailbox->scan_size &&
+      fseeko (fp, mailbox->scan_size, SEEK_SET) == 0 &&
+      fgets (buf, sizeof (buf), fp) != NULL &&
+      is_from (buf, return_path, sizeof (return_path), &t))
+  {
+    loc = mailbox->scan_size;
+    count = mailbox->scan_count;
+    unread = mailbox->scan_unread;
+    flagged = mailbox->scan_flagged;
+  }
+  if (fseeko (fp, loc, SEEK_SET) != 0)
+  {
+    if (locked)
+      mx_unlock_file (path, fileno (fp), 1);
+    safe_fclose (&fp);
+    return -1;
+  }
+
+  /* like mbox_parse_mailbox(), look for separators in fgets() chunks */
+  while (fgets (buf, sizeof (buf), fp) != NULL)
+  {
+    if (!is_from (buf, return_path, sizeof (return_path), &t))
+      continue;
+    buffy_mbox_skip_line (buf, fp);
+
+    count++;
+    read = flag = 0;
+    length = -1;
+    buffy_mbox_scan_header (fp, buf, sizeof (buf), &read, &flag, &length);
+    if (!read)
+      unread++;
+    if (flag)
+      flagged++;
+
+    /* skip the body if the Content-Length points at the next separator */
+    if (length > 0)
+    {
+      loc = ftello (fp);
+      tmploc = length < sb->st_size ? loc + length + 1 : -1;
+
+      if (0 < tmploc && tmploc < sb->st_size)
+      {
+        if (fseeko (fp, tmploc, SEEK_SET) != 0 ||
+            fgets (buf, sizeof (buf), fp) == NULL ||
+            mutt_strncmp ("From ", buf, 5) != 0 ||
+            fseeko (fp, tmploc, SEEK_SET) != 0)
+          fseeko (fp, loc, SEEK_SET);
+      }
+      else if (tmploc == sb->st_size)
+        fseeko (fp, tmploc, SEEK_SET);
+    }
+  }
+
+  mailbox->scan_size = ftello (fp);
+  mailbox->msg_count = mailbox->scan_count = count;
+  mailbox->msg_unread = mailbox->scan_unread = unread;
+  mailbox->msg_flagged = mailbox->scan_flagged = flagged;
+  mutt_get_stat_timespec (&mailbox->stats_last_checked, sb, MUTT_STAT_MTIME);
+
+  if (locked)
+    mx_unlock_file (path, fileno (fp), 1);
+  safe_fclose (&fp);
+
+#ifdef USE_HCACHE
+  buffy_mbox_scan_store (mailbox, sb);
+#endif
+  return 0;
+}
+
+/* Counts total, new, and flagged messages of an mbox or mmdf mailbox,
+ * if it was modified since the last count.
+ * Returns 1 if the counts were updated.
+ */
+static int buffy_mbox_stats (BUFFY* mailbox, struct stat *sb)
+{
+  CONTEXT ctx;
+
+  if (mutt_stat_timespec_compare (sb, MUTT_STAT_MTIME, &mailbox->stats_last_checked) <= 0)
+    return 0;
+
+  if (mailbox->magic == MUTT_MBOX)
+    return buffy_mbox_scan (mailbox, sb) == 0;
+
+  if (mx_open_mailbox (mutt_b2s (mailbox->pathbuf),
+                       MUTT_READONLY | MUTT_QUIET | MUTT_NOSORT | MUTT_PEEK,
+                       &ctx) == NULL)
+    return 0;
+
+  mailbox->msg_count       = ctx.msgcount;
+  mailbox->msg_unread      = ctx.unread;
+  mailbox->msg_flagged     = ctx.flagged;
+  mailbox->stats_last_checked = ctx.mtime;
+  mx_close_mailbox (&ctx, 0);
+  return 1;
+}
+
 /* Checks new mail for an mbox mailbox
  * check_stats: if true, also count total, new, and flagged messages.
  * Returns 1 if the mailbox has new mail.
@@ -596,7 +943,6 @@ static int buffy_mbox_check (BUFFY* mailbox, struct stat *sb, int check_stats)
 {
   int rc = 0;
   int new_or_changed;
-  CONTEXT ctx;
 
   if (option (OPTCHECKMBOXSIZE))
     new_or_changed = sb->st_size > mailbox->size;
@@ -625,22 +971,226 @@ static int buffy_mbox_check (BUFFY* mailbox, struct stat *sb, int check_stats)
       (sb->st_ctime != sb->st_mtime || sb->st_ctime != sb->st_atime))
     mailbox->newly_created = 0;
 
-  if (check_stats &&
-      (mutt_stat_timespec_compare (sb, MUTT_STAT_MTIME, &mailbox->stats_last_checked) > 0))
+  if (check_stats)
+    buffy_mbox_stats (mailbox, sb);
+
+  return rc;
+}
+
+/* With $mail_check_stats, the message counts of local mailboxes are
+ * computed by a forked worker so that opening every changed mbox, or
+ * reading every maildir, does not block the user interface.  The worker
+ * writes one line per mailbox to a pipe:
+ *   "<count> <unread> <flagged> <mtime sec> <mtime nsec> <scan size> <realpath>\n"
+ * for each mailbox whose counts changed.
+ * buffy_stats_collect() reads it back without blocking.
+ */
+static pid_t BuffyStatsPid = 0;
+static int BuffyStatsFd = -1;
+static BUFFER *BuffyStatsBuf = NULL;
+static short BuffyStatsPending = 0;	/* stats requested while the worker ran */
+
+/* Returns 1 if the counts of the mailbox were updated. */
+static int buffy_stats_count (BUFFY *mailbox)
+{
+  struct stat sb;
+
+  switch (mailbox->magic)
+  {
+    case MUTT_MBOX:
+    case MUTT_MMDF:
+      if (stat (mutt_b2s (mailbox->pathbuf), &sb) == 0)
+        return buffy_mbox_stats (mailbox, &sb);
+      break;
+
+    case MUTT_MAILDIR:
+      mailbox->msg_count   = 0;
+      mailbox->msg_unread  = 0;
+      mailbox->msg_flagged = 0;
+      buffy_maildir_check_dir (mailbox, "new", 0, 1);
+      buffy_maildir_check_dir (mailbox, "cur", 0, 1);
+      return 1;
+
+    case MUTT_MH:
+      mh_buffy (mailbox, 1);
+      return 1;
+  }
+
+  return 0;
+}
+
+static void buffy_stats_child (int fd)
+{
+  BUFFY *tmp;
+  FILE *fp;
+  int devnull;
+
+  /* the worker must not read the terminal or write to the screen */
+  setsid ();
+  if ((devnull = open ("/dev/null", O_RDWR)) != -1)
   {
-    if (mx_open_mailbox (mutt_b2s (mailbox->pathbuf),
-                         MUTT_READONLY | MUTT_QUIET | MUTT_NOSORT | MUTT_PEEK,
-                         &ctx) != NULL)
+    dup2 (devnull, 0);
+    dup2 (devnull, 1);
+    dup2 (devnull, 2);
+    if (devnull > 2)
+      close (devnull);
+  }
+  mutt_reset_child_signals ();
+  set_option (OPTNOCURSES);
+#ifdef DEBUG
+  debugfile = NULL;
+  debuglevel = 0;
+#endif
+
+  if ((fp = fdopen (fd, "w")) == NULL)
+    _exit (127);
+
+  for (tmp = Incoming; tmp; tmp = tmp->next)
+  {
+    if (!tmp->stats_queued)
+      continue;
+
+    if (!buffy_stats_count (tmp))
+      continue;
+    fprintf (fp, "%d %d %d %ld %ld %lld %s\n",
+             tmp->msg_count, tmp->msg_unread, tmp->msg_flagged,
+             (long) tmp->stats_last_checked.tv_sec,
+             (long) tmp->stats_last_checked.tv_nsec,
+             (long long) tmp->scan_size,
+             tmp->realpath);
+    /* publish each mailbox as soon as it is counted */
+    fflush (fp);
+  }
+
+  safe_fclose (&fp);
+  _exit (0);
+}
+
+/* Forks the worker for all mailboxes with stats_queued set.
+ * Returns 0 on success, -1 if the stats must be counted in place.
+ */
+static int buffy_stats_start (void)
+{
+  int fds[2];
+  int flags;
+  pid_t pid;
+
+  if (pipe (fds) == -1)
+    return -1;
+
+  if ((pid = fork ()) == 0)
+  {
+    close (fds[0]);
+    buffy_stats_child (fds[1]);
+  }
+
+  close (fds[1]);
+  if (pid == -1)
+  {
+    dprint (1, (debugfile, "buffy_stats_start: fork failed: %s\n", strerror (errno)));
+    close (fds[0]);
+    return -1;
+  }
+
+  if ((flags = fcntl (fds[0], F_GETFL)) != -1)
+    fcntl (fds[0], F_SETFL, flags | O_NONBLOCK);
+  fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+
+  BuffyStatsPid = pid;
+  BuffyStatsFd = fds[0];
+  return 0;
+}
+
+static void buffy_stats_apply (const char *line)
+{
+  BUFFY *tmp;
+  int count, unread, flagged, n = 0;
+  long sec, nsec;
+  long long scan_size;
+
+  if (sscanf (line, "%d %d %d %ld %ld %lld %n",
+              &count, &unread, &flagged, &sec, &nsec, &scan_size, &n) < 6 || !n)
+    return;
+
+  tmp = mutt_buffy_find_realpath (line + n);
+  /* the mailbox was removed while the worker ran */
+  if (!tmp)
+    return;
+
+#ifdef USE_SIDEBAR
+  if ((count != tmp->msg_count) ||
+      (unread != tmp->msg_unread) ||
+      (flagged != tmp->msg_flagged))
+    mutt_set_current_menu_redraw (REDRAW_SIDEBAR);
+#endif
+
+  tmp->msg_count   = count;
+  tmp->msg_unread  = unread;
+  tmp->msg_flagged = flagged;
+  tmp->stats_last_checked.tv_sec = sec;
+  tmp->stats_last_checked.tv_nsec = nsec;
+  /* also when 0: an mbox truncated to empty must not be resumed */
+  tmp->scan_size    = (LOFF_T) scan_size;
+  tmp->scan_count   = count;
+  tmp->scan_unread  = unread;
+  tmp->scan_flagged = flagged;
+}
+
+/* Applies whatever results the worker has published so far, and reaps
+ * the worker once it is done.  Never blocks on the worker.
+ */
+static void buffy_stats_collect (void)
+{
+  char buf[STRING];
+  char *p, *nl;
+  ssize_t n;
+  int done = 0;
+
+  if (BuffyStatsFd == -1)
+    return;
+
+  if (!BuffyStatsBuf)
+    BuffyStatsBuf = mutt_buffer_new ();
+
+  FOREVER
+  {
+    n = read (BuffyStatsFd, buf, sizeof (buf));
+    if (n > 0)
     {
-      mailbox->msg_count       = ctx.msgcount;
-      mailbox->msg_unread      = ctx.unread;
-      mailbox->msg_flagged     = ctx.flagged;
-      mailbox->stats_last_checked = ctx.mtime;
-      mx_close_mailbox (&ctx, 0);
+      mutt_buffer_addstr_n (BuffyStatsBuf, buf, n);
+      continue;
     }
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      done = 1;
+    break;
   }
 
-  return rc;
+  p = BuffyStatsBuf->data;
+  while (p && (nl = strchr (p, '\n')) != NULL)
+  {
+    *nl = '\0';
+    buffy_stats_apply (p);
+    p = nl + 1;
+  }
+  /* keep a partially written line for the next call */
+  if (p && p != BuffyStatsBuf->data)
+  {
+    memmove (BuffyStatsBuf->data, p, strlen (p) + 1);
+    mutt_buffer_fix_dptr (BuffyStatsBuf);
+  }
+
+  if (done)
+  {
+    close (BuffyStatsFd);
+    BuffyStatsFd = -1;
+    /* the worker exits right after closing the pipe.  It may already
+     * have been reaped by mutt_background_process_waitpid(). */
+    waitpid (BuffyStatsPid, NULL, 0);
+    BuffyStatsPid = 0;
+    mutt_buffer_clear (BuffyStatsBuf);
+  }
 }
 
 /* Check all Incoming for new mail and total/new/flagged messages
@@ -655,6 +1205,7 @@ int mutt_buffy_check (int force)
   struct stat contex_sb;
   time_t t;
   int check_stats = 0;
+  int queue_stats = 0, queued = 0;
 #ifdef USE_SIDEBAR
   short orig_new;
   int orig_count, orig_unread, orig_flagged;
@@ -673,6 +1224,9 @@ int mutt_buffy_check (int force)
   /* fastest return if there are no mailboxes */
   if (!Incoming)
     return 0;
+
+  buffy_stats_collect ();
+
   t = time (NULL);
   if (!force && (t - BuffyTime < BuffyTimeout))
     return BuffyCount;
@@ -684,6 +1238,16 @@ int mutt_buffy_check (int force)
     check_stats = 1;
     BuffyStatsTime = t;
   }
+  else if (BuffyStatsPending && BuffyStatsFd == -1)
+    check_stats = 1;
+
+  /* local mailboxes are counted by the worker.  If the previous one is
+   * still running, count them again once it has finished. */
+  if (check_stats)
+  {
+    queue_stats = (BuffyStatsFd == -1);
+    BuffyStatsPending = !queue_stats;
+  }
 
   BuffyTime = t;
   BuffyCount = 0;
@@ -731,6 +1295,9 @@ int mutt_buffy_check (int force)
           tmp->newly_created = 1;
           tmp->magic = 0;
           tmp->size = 0;
+          /* an emptied mbox must be scanned from the start again,
+           * without the counts saved in the header cache */
+          tmp->scan_size = -1;
           continue;
         }
     }
@@ -746,20 +1313,24 @@ int mutt_buffy_check (int force)
       {
         case MUTT_MBOX:
         case MUTT_MMDF:
-          if (buffy_mbox_check (tmp, &sb, check_stats) > 0)
+          if (buffy_mbox_check (tmp, &sb, 0) > 0)
             BuffyCount++;
+          tmp->stats_queued = queue_stats;
           break;
 
         case MUTT_MAILDIR:
-          if (buffy_maildir_check (tmp, check_stats) > 0)
+          if (buffy_maildir_check (tmp, 0) > 0)
             BuffyCount++;
+          tmp->stats_queued = queue_stats;
           break;
 
         case MUTT_MH:
-          if (mh_buffy (tmp, check_stats) > 0)
+          if (mh_buffy (tmp, 0) > 0)
             BuffyCount++;
+          tmp->stats_queued = queue_stats;
           break;
       }
+      queued += tmp->stats_queued;
     }
     else if (option(OPTCHECKMBOXSIZE) && Context && Context->path)
       tmp->size = (off_t) sb.st_size;	/* update the size of current folder */
@@ -784,6 +1355,22 @@ int mutt_buffy_check (int force)
     }
   }
 
+  if (queued)
+  {
+    if (buffy_stats_start () == -1)
+    {
+      for (tmp = Incoming; tmp; tmp = tmp->next)
+        if (tmp->stats_queued)
+          buffy_stats_count (tmp);
+#ifdef USE_SIDEBAR
+      mutt_set_current_menu_redraw (REDRAW_SIDEBAR);
+#endif
+    }
+
+    for (tmp = Incoming; tmp; tmp = tmp->next)
+      tmp->stats_queued = 0;
+  }
+
   BuffyDoneTime = BuffyTime;
   return (BuffyCount);
 }
@@ -907,7 +1494,7 @@ void mutt_buffer_buffy (BUFFER *s)
     for (pass = 0; pass < 2; pass++)
       for (tmp = Incoming; tmp; tmp = tmp->next)
       {
-	mutt_buffer_expand_path (tmp->pathbuf);
+	buffy_expand_path (tmp);
 	if ((found || pass) && tmp->new)
 	{
 	  mutt_buffer_strcpy (s, mutt_b2s (tmp->pathbuf));
@@ -939,10 +1526,16 @@ static BUFFY* buffy_get (const char *path)
   mutt_buffer_strcpy (epath, NONULL (path));
   mutt_buffer_expand_path (epath);
 
+  if ((cur = mutt_buffy_find_path (mutt_b2s (epath))) != NULL)
+  {
+    mutt_buffer_pool_release (&epath);
+    return cur;
+  }
+
+  /* a path may only expand to epath now, see buffy_expand_path() */
   for (cur = Incoming; cur; cur = cur->next)
   {
-    /* must be done late because e.g. IMAP delimiter may change */
-    mutt_buffer_expand_path (cur->pathbuf);
+    buffy_expand_path (cur);
     if (!mutt_strcmp (mutt_b2s (cur->pathbuf), mutt_b2s (epath)))
     {
       mutt_buffer_pool_release (&epath);
@@ -40,8 +40,16 @@ typedef struct buffy_t
   short notified;		/* user has been notified */
   short magic;			/* mailbox type */
   short newly_created;		/* mbox or mmdf just popped into existence */
+  short stats_queued;		/* counts are due from the stats worker */
   struct timespec last_visited;		/* time of last exit from this mailbox */
   struct timespec stats_last_checked;	/* mtime of mailbox the last time stats where checked. */
+
+  /* mbox counts of the first scan_size bytes, reused when the folder
+   * only grew since.  0 if not counted yet, -1 if it was emptied. */
+  LOFF_T scan_size;
+  int scan_count;
+  int scan_unread;
+  int scan_flagged;
 }
 BUFFY;
 
@@ -62,6 +70,8 @@ int mutt_buffy_check (int);
 int mutt_buffy_notify (void);
 
 BUFFY *mutt_find_mailbox (const char *path);
+BUFFY *mutt_buffy_find_path (const char *path);
+BUFFY *mutt_buffy_find_realpath (const char *rp);
 void mutt_update_mailbox (BUFFY * b);
 
 /* fixes up atime + mtime after mbox/mmdf mailbox was modified
@@ -291,6 +291,14 @@ out:
   }
 }
 
+/* Charsets which are known to encode ASCII as themselves, so that
+ * 7-bit text converts between them unchanged. */
+int mutt_is_ascii_superset (const char *s)
+{
+  return mutt_is_us_ascii (s) || mutt_is_utf8 (s) ||
+    !ascii_strncasecmp (s, "iso-8859-", 9);
+}
+
 int mutt_chscmp (const char *s, const char *chs)
 {
   char buffer[STRING];
@@ -352,6 +360,127 @@ int iconv_close (iconv_t cd)
 #endif /* !HAVE_ICONV */
 
 
+/*
+ * Conversion descriptors are kept open for reuse, since iconv_open()
+ * costs far more than converting the odd header word, which is what
+ * most callers do.  A handle is handed out to one caller at a time and
+ * reset when it is taken again.  Entries are keyed by the names that
+ * were finally passed to iconv_open(), so changing hooks can't leave
+ * stale entries behind.  Failed opens are remembered too.
+ */
+
+#define ICONV_CACHE_SIZE 16
+
+typedef struct
+{
+  char *tocode;
+  char *fromcode;
+  iconv_t cd;
+  unsigned long used;		/* for LRU eviction */
+  unsigned int busy : 1;	/* handed out */
+}
+ICONV_CACHE;
+
+static ICONV_CACHE IconvCache[ICONV_CACHE_SIZE];
+static unsigned long IconvCacheClock = 0;
+static unsigned long IconvCacheHits = 0;
+static unsigned long IconvCacheMisses = 0;
+static unsigned long IconvCacheEvictions = 0;
+
+static void iconv_cache_free (ICONV_CACHE *c)
+{
+  if (c->cd != (iconv_t) -1)
+    iconv_close (c->cd);
+  FREE (&c->tocode);
+  FREE (&c->fromcode);
+  memset (c, 0, sizeof (ICONV_CACHE));
+}
+
+static iconv_t iconv_cache_open (const char *tocode, const char *fromcode)
+{
+  ICONV_CACHE *c, *slot = NULL;
+  iconv_t cd;
+  int i;
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+  {
+    c = &IconvCache[i];
+    if (!c->tocode)
+    {
+      if (!slot || slot->tocode)
+        slot = c;
+      continue;
+    }
+    if (!c->busy && !mutt_strcmp (c->tocode, tocode) &&
+        !mutt_strcmp (c->fromcode, fromcode))
+    {
+      IconvCacheHits++;
+      c->used = ++IconvCacheClock;
+      if (c->cd != (iconv_t) -1)
+      {
+        c->busy = 1;
+        /* back to the initial shift state */
+        iconv (c->cd, NULL, NULL, NULL, NULL);
+      }
+      return c->cd;
+    }
+    /* least recently used idle entry, unless there's a free one */
+    if (!c->busy && (!slot || (slot->tocode && c->used < slot->used)))
+      slot = c;
+  }
+
+  IconvCacheMisses++;
+  cd = iconv_open (tocode, fromcode);
+
+  /* all entries handed out: the caller gets a handle of its own */
+  if (!slot)
+    return cd;
+
+  if (slot->tocode)
+  {
+    IconvCacheEvictions++;
+    iconv_cache_free (slot);
+  }
+  slot->tocode = safe_strdup (tocode);
+  slot->fromcode = safe_strdup (fromcode);
+  slot->cd = cd;
+  slot->used = ++IconvCacheClock;
+  slot->busy = (cd != (iconv_t) -1);
+
+  return cd;
+}
+
+/* Gives back a handle from mutt_iconv_open(). */
+void mutt_iconv_close (iconv_t cd)
+{
+  int i;
+
+  if (cd == (iconv_t) -1)
+    return;
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+    if (IconvCache[i].tocode && IconvCache[i].cd == cd)
+    {
+      IconvCache[i].busy = 0;
+      return;
+    }
+
+  iconv_close (cd);
+}
+
+/* Closes the handles not in use. */
+void mutt_iconv_cache_flush (void)
+{
+  int i;
+
+  dprint (1, (debugfile, "mutt_iconv_cache_flush: %lu hits, %lu misses, %lu evictions\n",
+              IconvCacheHits, IconvCacheMisses, IconvCacheEvictions));
+
+  for (i = 0; i < ICONV_CACHE_SIZE; i++)
+    if (IconvCache[i].tocode && !IconvCache[i].busy)
+      iconv_cache_free (&IconvCache[i]);
+}
+
 /*
  * Like iconv_open, but canonicalises the charsets, applies
  * charset-hooks, recanonicalises, and finally applies iconv-hooks.
@@ -364,6 +493,7 @@ int iconv_close (iconv_t cd)
  * in some setups. Note: By design charset-hooks should never be, and
  * are never, applied to tocode. Highlight note: The top-well-named
  * MUTT_ICONV_HOOK_FROM acts on charset-hooks, not at all on iconv-hooks.
+ * The handle must be given back with mutt_iconv_close().
  */
 
 iconv_t mutt_iconv_open (const char *tocode, const char *fromcode, int flags)
@@ -392,7 +522,7 @@ iconv_t mutt_iconv_open (const char *tocode, const char *fromcode, int flags)
   fromcode2 = (fromcode2) ? fromcode2 : fromcode1;
 
   /* call system iconv with names it appreciates */
-  if ((cd = iconv_open (tocode2, fromcode2)) != (iconv_t) -1)
+  if ((cd = iconv_cache_open (tocode2, fromcode2)) != (iconv_t) -1)
     return cd;
 
   return (iconv_t) -1;
@@ -509,7 +639,7 @@ int mutt_convert_string (char **ps, const char *from, const char *to, int flags)
     ob = buf = safe_malloc (obl + 1);
 
     mutt_iconv (cd, &ib, &ibl, &ob, &obl, inrepls, outrepl);
-    iconv_close (cd);
+    mutt_iconv_close (cd);
 
     *ob = '\0';
 
@@ -597,6 +727,38 @@ char *fgetconvs (char *buf, size_t l, FGETCONV *_fc)
     return NULL;
 }
 
+/* Reads up to l converted bytes into buf.  Unconverted files are
+ * read directly, otherwise whole converted chunks are copied out. */
+size_t fgetconv_read (char *buf, size_t l, FGETCONV *_fc)
+{
+  struct fgetconv_s *fc = (struct fgetconv_s *)_fc;
+  size_t r = 0, n;
+  int c;
+
+  if (!fc)
+    return 0;
+  if (fc->cd == (iconv_t)-1)
+    return fread (buf, 1, l, fc->file);
+
+  while (r < l)
+  {
+    if (fc->p && fc->p < fc->ob)
+    {
+      n = MIN ((size_t)(fc->ob - fc->p), l - r);
+      memcpy (buf + r, fc->p, n);
+      fc->p += n;
+      r += n;
+      continue;
+    }
+    /* refills bufo */
+    if ((c = fgetconv (_fc)) == EOF)
+      break;
+    buf[r++] = (char) c;
+  }
+
+  return r;
+}
+
 int fgetconv (FGETCONV *_fc)
 {
   struct fgetconv_s *fc = (struct fgetconv_s *)_fc;
@@ -654,8 +816,7 @@ void fgetconv_close (FGETCONV **_fc)
 {
   struct fgetconv_s *fc = (struct fgetconv_s *) *_fc;
 
-  if (fc->cd != (iconv_t)-1)
-    iconv_close (fc->cd);
+  mutt_iconv_close (fc->cd);
   FREE (_fc);		/* __FREE_CHECKED__ */
 }
 
@@ -677,7 +838,7 @@ int mutt_check_charset (const char *s, int strict)
 
   if ((cd = mutt_iconv_open (s, s, 0)) != (iconv_t)(-1))
   {
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     return 0;
   }
 
@@ -37,6 +37,9 @@ int iconv_close (iconv_t);
 int mutt_convert_string (char **, const char *, const char *, int);
 
 iconv_t mutt_iconv_open (const char *, const char *, int);
+void mutt_iconv_close (iconv_t);
+int mutt_is_ascii_superset (const char *);
+void mutt_iconv_cache_flush (void);
 size_t mutt_iconv (iconv_t, ICONV_CONST char **, size_t *, char **, size_t *, ICONV_CONST char **, const char *);
 
 typedef void * FGETCONV;
@@ -44,6 +47,7 @@ typedef void * FGETCONV;
 FGETCONV *fgetconv_open (FILE *, const char *, const char *, int);
 int fgetconv (FGETCONV *);
 char * fgetconvs (char *, size_t, FGETCONV *);
+size_t fgetconv_read (char *, size_t, FGETCONV *);
 void fgetconv_close (FGETCONV **);
 
 void mutt_set_langinfo_charset (void);
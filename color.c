@@ -173,6 +173,7 @@ static void mutt_free_color_line(COLOR_LINE **l,
   regfree(&tmp->rx);
   mutt_pattern_free(&tmp->color_pattern);
   FREE (&tmp->pattern);
+  FREE (&tmp->literal);
   FREE (l);		/* __FREE_CHECKED__ */
 }
 
@@ -799,11 +800,25 @@ add_pattern (COLOR_LINE **top, const char *s, int sensitive,
 	return -1;
       }
     }
-    else if ((r = REGCOMP (&tmp->rx, s, (sensitive ? mutt_which_case (s) : REG_ICASE))) != 0)
+    else
     {
-      regerror (r, &tmp->rx, err->data, err->dsize);
-      mutt_free_color_line(&tmp, 1);
-      return (-1);
+      int flags = sensitive ? mutt_which_case (s) : REG_ICASE;
+      int anchored = 0;
+
+      if ((r = REGCOMP (&tmp->rx, s, flags)) != 0)
+      {
+        regerror (r, &tmp->rx, err->data, err->dsize);
+        mutt_free_color_line(&tmp, 1);
+        return (-1);
+      }
+
+      /* lets the pager skip regexec() on lines that can't match */
+      if ((tmp->literal = mutt_regex_literal (s, &anchored)) != NULL)
+      {
+        tmp->literal_len = mutt_strlen (tmp->literal);
+        tmp->anchored = anchored;
+        tmp->icase = (flags & REG_ICASE) ? 1 : 0;
+      }
     }
     tmp->next = *top;
     tmp->pattern = safe_strdup (s);
@@ -54,6 +54,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <signal.h>
 #include <utime.h>
 
 static const char *ExtPagerProgress = "all";
@@ -157,14 +158,126 @@ static void process_protected_headers (HEADER *cur)
 #endif
 }
 
+/* With $pager_stream a message is rendered by a forked child, so that the
+ * pager can show the first screen while later parts are still being
+ * decoded.  The child writes the text to the pager's file, then a single
+ * result character to a pipe: '0' when the whole message was rendered,
+ * '1' when some part failed, and none when it could not be copied.
+ * mutt_pager() polls both.
+ */
+
+static void render_message_term (int sig)
+{
+  mutt_autoview_kill_jobs ();
+  _exit (127);
+}
+
+static void render_message_child (FILE *fpout, FILE *fpin, HEADER *cur,
+                                  int cmflags, int chflags, int fd)
+{
+  struct sigaction act;
+  int devnull, res;
+
+  /* the child must not read the terminal or write to the screen */
+  setsid ();
+  if ((devnull = open ("/dev/null", O_RDWR)) != -1)
+  {
+    dup2 (devnull, 0);
+    dup2 (devnull, 1);
+    dup2 (devnull, 2);
+    if (devnull > 2)
+      close (devnull);
+  }
+  mutt_reset_child_signals ();
+  set_option (OPTNOCURSES);
+#ifdef DEBUG
+  debugfile = NULL;
+  debuglevel = 0;
+#endif
+
+  /* the pager stops the child with SIGTERM when it is left early.
+   * It was blocked until now, see render_message_start(). */
+  memset (&act, 0, sizeof (act));
+  act.sa_handler = render_message_term;
+  sigemptyset (&act.sa_mask);
+  sigaction (SIGTERM, &act, NULL);
+  mutt_unblock_signals ();
+
+  res = _mutt_copy_message (fpout, fpin, cur, cur->content, cmflags, chflags);
+  if (safe_fclose (&fpout) != 0 || res < 0)
+    _exit (127);
+
+  if (write (fd, res ? "1" : "0", 1) != 1)
+    _exit (127);
+  _exit (0);
+}
+
+/* Forks the child rendering cur into fpout.  Returns its pid and sets *fd
+ * to the read end of its result pipe, or returns -1 if the message must
+ * be rendered in place.
+ */
+static pid_t render_message_start (FILE *fpout, HEADER *cur, int cmflags,
+                                   int chflags, int *fd)
+{
+  MESSAGE *msg;
+  FILE *fpin;
+  int fds[2];
+  int flags;
+  pid_t pid;
+
+  if ((msg = mx_open_message (Context, cur->msgno, 0)) == NULL)
+    return -1;
+
+  if (pipe (fds) == -1)
+  {
+    mx_close_message (Context, &msg);
+    return -1;
+  }
+
+  /* nothing still buffered may be written by both processes */
+  fflush (NULL);
+
+  mutt_block_signals ();
+  if ((pid = fork ()) == 0)
+  {
+    close (fds[0]);
+    /* an mbox message is read from the folder's stream, whose offset
+     * the parent moves when checking for new mail */
+    fpin = msg->fp;
+    if (fpin == Context->fp && (fpin = fopen (Context->path, "r")) == NULL)
+      _exit (127);
+    render_message_child (fpout, fpin, cur, cmflags, chflags, fds[1]);
+  }
+
+  mutt_unblock_signals ();
+  close (fds[1]);
+  mx_close_message (Context, &msg);
+  if (pid == -1)
+  {
+    dprint (1, (debugfile, "render_message_start: fork failed: %s\n", strerror (errno)));
+    close (fds[0]);
+    return -1;
+  }
+
+  if ((flags = fcntl (fds[0], F_GETFL)) != -1)
+    fcntl (fds[0], F_SETFL, flags | O_NONBLOCK);
+  fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+
+  *fd = fds[0];
+  return pid;
+}
+
 int mutt_display_message (HEADER *cur)
 {
   BUFFER *tempfile = NULL;
   int rc = 0, builtin = 0;
   int cmflags = MUTT_CM_DECODE | MUTT_CM_DISPLAY | MUTT_CM_CHARCONV;
+  int chflags;
   FILE *fpout = NULL;
   FILE *fpfilterout = NULL;
   pid_t filterpid = -1;
+  pid_t streampid = -1;
+  int streamfd = -1;
   int res;
 
   mutt_parse_mime_message (Context, cur);
@@ -241,15 +354,25 @@ int mutt_display_message (HEADER *cur)
 
     hfi.ctx = Context;
     hfi.pager_progress = ExtPagerProgress;
+    hfi.pager_search = NULL;
     hfi.hdr = cur;
     mutt_make_string_info (buf, sizeof (buf), MuttIndexWindow->cols, NONULL(PagerFmt), &hfi, 0);
     fputs (buf, fpout);
     fputs ("\n\n", fpout);
   }
 
-  res = mutt_copy_message (fpout, Context, cur, cmflags,
-                           (option (OPTWEED) ? (CH_WEED | CH_REORDER) : 0) |
-                           CH_DECODE | CH_FROM | CH_DISPLAY);
+  chflags = (option (OPTWEED) ? (CH_WEED | CH_REORDER) : 0) |
+    CH_DECODE | CH_FROM | CH_DISPLAY;
+
+  /* crypto may prompt, so it is never left to the child */
+  if (builtin && !fpfilterout && option (OPTPAGERSTREAM) &&
+      !(WithCrypto && cur->security))
+    streampid = render_message_start (fpout, cur, cmflags, chflags, &streamfd);
+
+  if (streampid > 0)
+    res = 0;
+  else
+    res = mutt_copy_message (fpout, Context, cur, cmflags, chflags);
   if ((safe_fclose (&fpout) != 0 && errno != EPIPE) || res < 0)
   {
     mutt_error (_("Could not copy message"));
@@ -258,6 +381,13 @@ int mutt_display_message (HEADER *cur)
       mutt_wait_filter (filterpid);
       safe_fclose (&fpfilterout);
     }
+    if (streampid > 0)
+    {
+      if (kill (-streampid, SIGTERM) == -1)
+        kill (streampid, SIGTERM);
+      close (streamfd);
+      waitpid (streampid, NULL, 0);
+    }
     mutt_unlink (mutt_b2s (tempfile));
     goto cleanup;
   }
@@ -328,6 +458,11 @@ int mutt_display_message (HEADER *cur)
     memset (&info, 0, sizeof (pager_t));
     info.hdr = cur;
     info.ctx = Context;
+    if (streampid > 0)
+    {
+      info.stream_pid = streampid;
+      info.stream_fd = streamfd;
+    }
     rc = mutt_pager (NULL, mutt_b2s (tempfile), MUTT_PAGER_MESSAGE, &info);
   }
   else
@@ -1049,8 +1049,7 @@ int mutt_protected_headers_handler (BODY *a, STATE *s)
     if (a->mime_headers->subject)
     {
       if ((s->flags & MUTT_DISPLAY) && option (OPTWEED) &&
-          mutt_matches_ignore ("subject", Ignore) &&
-          !mutt_matches_ignore ("subject", UnIgnore))
+          mutt_ignore_header ("subject"))
         return 0;
 
       state_mark_protected_header (s);
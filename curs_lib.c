@@ -30,6 +30,9 @@
 #ifdef USE_INOTIFY
 #include "monitor.h"
 #endif
+#ifdef USE_SOCKET
+#include "mutt_socket.h"
+#endif
 
 #include <termios.h>
 #include <sys/types.h>
@@ -127,10 +130,12 @@ void mutt_getch_timeout (int delay)
   timeout (delay);
 }
 
-#ifdef USE_INOTIFY
+#if defined(USE_INOTIFY) || defined(USE_SOCKET)
+/* waits on STDIN together with the file monitor and any watched
+ * connections, see mutt_monitor_poll() and mutt_socket_wait_stdin() */
 static int mutt_monitor_getch (void)
 {
-  int ch;
+  int ch, rc;
 
   /* ncurses has its own internal buffer, so before we perform a poll,
    * we need to make sure there isn't a character waiting */
@@ -139,14 +144,19 @@ static int mutt_monitor_getch (void)
   timeout (MuttGetchTimeout);
   if (ch == ERR)
   {
-    if (mutt_monitor_poll () != 0)
+#ifdef USE_INOTIFY
+    rc = mutt_monitor_poll ();
+#else
+    rc = mutt_socket_wait_stdin (MuttGetchTimeout);
+#endif
+    if (rc != 0)
       ch = ERR;
     else
       ch = getch ();
   }
   return ch;
 }
-#endif /* USE_INOTIFY */
+#endif /* USE_INOTIFY || USE_SOCKET */
 
 event_t mutt_getch (void)
 {
@@ -168,11 +178,11 @@ event_t mutt_getch (void)
   ch = KEY_RESIZE;
   while (ch == KEY_RESIZE)
 #endif /* KEY_RESIZE */
-#ifdef USE_INOTIFY
+#if defined(USE_INOTIFY) || defined(USE_SOCKET)
     ch = mutt_monitor_getch ();
 #else
     ch = getch ();
-#endif /* USE_INOTIFY */
+#endif /* USE_INOTIFY || USE_SOCKET */
   mutt_allow_interrupt (0);
 
   if (SigInt)
@@ -584,14 +584,6 @@ static void index_menu_redraw (MUTTMENU *menu)
     mutt_show_error ();
   }
 
-#ifdef USE_SIDEBAR
-  if (menu->redraw & REDRAW_SIDEBAR)
-  {
-    mutt_sb_set_buffystats (Context);
-    menu_redraw_sidebar (menu);
-  }
-#endif
-
   if (Context && Context->hdrs && !(menu->current >= Context->vcount))
   {
     menu_check_recenter (menu);
@@ -624,6 +616,16 @@ static void index_menu_redraw (MUTTMENU *menu)
     }
   }
 
+#ifdef USE_SIDEBAR
+  /* The status line's %b may have picked up new mailbox counts, so the
+   * sidebar is drawn last. */
+  if (menu->redraw & REDRAW_SIDEBAR)
+  {
+    mutt_sb_set_buffystats (Context);
+    menu_redraw_sidebar (menu);
+  }
+#endif
+
   menu->redraw = 0;
 }
 
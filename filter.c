@@ -32,10 +32,12 @@
 
 /* Invokes a command on a pipe and optionally connects its stdin and stdout
  * to the specified handles.
+ * With MUTT_FILTER_NEW_GROUP the command gets a process group of its own,
+ * so that kill (-pid, ...) also reaches what the shell started.
  */
 pid_t
-mutt_create_filter_fd (const char *cmd, FILE **in, FILE **out, FILE **err,
-		       int fdin, int fdout, int fderr)
+_mutt_create_filter_fd (const char *cmd, FILE **in, FILE **out, FILE **err,
+			int fdin, int fdout, int fderr, int flags)
 {
   int pin[2], pout[2], perr[2], thepid;
   char columns[11];
@@ -87,6 +89,9 @@ mutt_create_filter_fd (const char *cmd, FILE **in, FILE **out, FILE **err,
     mutt_unblock_signals_system (0);
     mutt_reset_child_signals ();
 
+    if (flags & MUTT_FILTER_NEW_GROUP)
+      setsid ();
+
     if (in)
     {
       close (pin[1]);
@@ -228,6 +228,7 @@ extern unsigned char QuadOptions[];
 
 WHERE unsigned short Counter;
 
+WHERE short AutoviewJobs;
 WHERE short ConnectTimeout;
 WHERE short ErrorHistSize;
 WHERE short HistSize;
@@ -256,12 +257,20 @@ WHERE LIST *SidebarWhitelist;
 #endif
 
 #ifdef USE_IMAP
+#ifdef USE_ZLIB
+WHERE long  ImapDeflateBufferSize;
+#endif
 WHERE long  ImapFetchChunkSize;
+WHERE short ImapFetchConnections;
 WHERE short ImapKeepalive;
 WHERE short ImapPipelineDepth;
 WHERE short ImapPollTimeout;
 #endif
 
+#ifdef USE_SMTP
+WHERE short SmtpIdleTimeout;
+#endif
+
 /* flags for received signals */
 WHERE SIG_ATOMIC_VOLATILE_T SigAlrm;
 WHERE SIG_ATOMIC_VOLATILE_T SigInt;
@@ -25,6 +25,7 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <sys/wait.h>
+#include <signal.h>
 #include <sys/stat.h>
 
 #include "mutt.h"
@@ -206,163 +207,155 @@ static void qp_decode_line (char *dest, char *src, size_t *l,
   *l = d - dest;
 }
 
+/* Decodes one line of quoted-printable input, or a chunk of an overlong
+ * one.  line must be followed by a spare byte for the terminator. */
+static size_t qp_decode_chunk (char *dest, char *line, size_t linelen)
+{
+  int last = linelen ? line[linelen - 1] : 0;
+  size_t l;
+
+  /* chop trailing whitespace if we got the full line */
+  if (last == '\n')
+  {
+    while (linelen > 0 && ISSPACE (line[linelen-1]))
+      linelen--;
+  }
+  line[linelen] = 0;
+
+  qp_decode_line (dest, line, &l, last);
+  return l;
+}
+
 /*
  * Decode an attachment encoded with quoted-printable.
  *
- * Why doesn't this overflow any buffers?  First, it's guaranteed
- * that the length of a line grows when you _en_-code it to
- * quoted-printable.  That means that we always can store the
- * result in a buffer of at most the _same_ size.
- *
- * Now, we don't special-case if the line we read with fgets()
- * isn't terminated.  We don't care about this, since STRING > 78,
- * so corrupted input will just be corrupted a bit more.  That
- * implies that STRING+1 bytes are always sufficient to store the
- * result of qp_decode_line.
- *
- * Finally, at soft line breaks, some part of a multibyte character
- * may have been left over by mutt_convert_to_state().  This shouldn't
- * be more than 6 characters, so STRING + 7 should be sufficient
- * memory to store the decoded data.
- *
- * Just to make sure that I didn't make some off-by-one error
- * above, we just use STRING*2 for the target buffer's size.
+ * The input is read in blocks of HUGE_STRING bytes and decoded a line
+ * at a time.  Decoding never makes a line longer, so the decoded
+ * lines are collected in decline until at least a block's worth is
+ * pending, then converted together.  Lines longer than a block, which
+ * the MIME spec doesn't allow anyway, are processed in chunks that
+ * don't end inside an =XX escape.
  *
+ * At soft line breaks, some part of a multibyte character may have
+ * been left over by mutt_convert_to_state(), which is why decline is
+ * twice the block size.
  */
 
 static void mutt_decode_quoted (STATE *s, LOFF_T len, int istext, iconv_t cd)
 {
-  char line[STRING];
-  char decline[2*STRING];
+  char line[HUGE_STRING];
+  char decline[2*HUGE_STRING];
+  char *p, *nl, next;
   size_t l = 0;
-  size_t linelen;      /* number of input bytes in `line' */
-  size_t l3;
-
-  int last;    /* store the last character in the input line */
+  size_t have = 0;     /* unprocessed input bytes in `line' */
+  size_t n, linelen;
+  int eof = 0;
 
   if (istext)
     state_set_prefix(s);
 
-  while (len > 0)
+  while (!eof)
   {
-    last = 0;
-
-    /*
-     * It's ok to use a fixed size buffer for input, even if the line turns
-     * out to be longer than this.  Just process the line in chunks.  This
-     * really shouldn't happen according the MIME spec, since Q-P encoded
-     * lines are at most 76 characters, but we should be liberal about what
-     * we accept.
-     */
-    if (fgets (line, MIN ((ssize_t)sizeof (line), len + 1), s->fpin) == NULL)
-      break;
-
-    linelen = strlen(line);
-    len -= linelen;
+    n = 0;
+    if (len > 0)
+      n = fread (line + have, 1, MIN ((LOFF_T) (sizeof (line) - 1 - have), len),
+                 s->fpin);
+    len -= n;
+    have += n;
+    eof = !n;
+
+    for (p = line; have; p += linelen, have -= linelen)
+    {
+      if ((nl = memchr (p, '\n', have)))
+        linelen = nl - p + 1;
+      else if (eof)
+        linelen = have;
+      else if (have == sizeof (line) - 1)
+      {
+        /* split an overlong line before an incomplete =XX escape */
+        linelen = have;
+        if (p[linelen - 1] == '=')
+          linelen--;
+        else if (p[linelen - 2] == '=')
+          linelen -= 2;
+      }
+      else
+        break;
 
-    /*
-     * inspect the last character we read so we can tell if we got the
-     * entire line.
-     */
-    last = linelen ? line[linelen - 1] : 0;
+      /* the terminator may overwrite the first byte of the next line */
+      next = p[linelen];
+      l += qp_decode_chunk (decline + l, p, linelen);
+      p[linelen] = next;
 
-    /* chop trailing whitespace if we got the full line */
-    if (last == '\n')
-    {
-      while (linelen > 0 && ISSPACE (line[linelen-1]))
-        linelen--;
-      line[linelen]=0;
+      if (l >= sizeof (line))
+        mutt_convert_to_state (cd, decline, &l, s);
     }
 
-    /* decode and do character set conversion */
-    qp_decode_line (decline + l, line, &l3, last);
-    l += l3;
-    mutt_convert_to_state (cd, decline, &l, s);
+    memmove (line, p, have);
   }
 
+  mutt_convert_to_state (cd, decline, &l, s);
   mutt_convert_to_state (cd, 0, 0, s);
   state_reset_prefix(s);
 }
 
-void mutt_decode_base64 (STATE *s, LOFF_T len, int istext, iconv_t cd)
+/* Drops the CR of CRLF pairs.  d may trail s by one byte in the same
+ * buffer, since a pending CR is only written back when the next
+ * character is not a newline. */
+static size_t b64_strip_cr (char *d, const char *s, size_t n, int *cr)
 {
-  char buf[5];
-  int c1, c2, c3, c4, ch, cr = 0, i;
-  char bufi[BUFI_SIZE];
-  size_t l = 0;
-
-  buf[4] = 0;
-
-  if (istext)
-    state_set_prefix(s);
+  char *start = d;
 
-  while (len > 0)
+  for (; n; n--, s++)
   {
-    for (i = 0 ; i < 4 && len > 0 ; len--)
-    {
-      if ((ch = fgetc (s->fpin)) == EOF)
-	break;
-      if (ch >= 0 && ch < 128 && (base64val(ch) != -1 || ch == '='))
-	buf[i++] = ch;
-    }
-    if (i != 4)
-    {
-      /* "i" may be zero if there is trailing whitespace, which is not an error */
-      if (i != 0)
-	dprint (2, (debugfile, "%s:%d [mutt_decode_base64()]: "
-                    "didn't get a multiple of 4 chars.\n", __FILE__, __LINE__));
-      break;
-    }
+    if (*cr && *s != '\n')
+      *d++ = '\r';
+    *cr = (*s == '\r');
+    if (!*cr)
+      *d++ = *s;
+  }
 
-    c1 = base64val (buf[0]);
-    c2 = base64val (buf[1]);
-    ch = (c1 << 2) | (c2 >> 4);
+  return d - start;
+}
 
-    if (cr && ch != '\n')
-      bufi[l++] = '\r';
+void mutt_decode_base64 (STATE *s, LOFF_T len, int istext, iconv_t cd)
+{
+  char bufi[HUGE_STRING];
+  char bufd[HUGE_STRING + STRING];
+  B64_DECODER dec;
+  size_t n, l = 0;
+  int cr = 0;
 
-    cr = 0;
+  memset (&dec, 0, sizeof (dec));
 
-    if (istext && ch == '\r')
-      cr = 1;
-    else
-      bufi[l++] = ch;
+  if (istext)
+    state_set_prefix(s);
 
-    if (buf[2] == '=')
+  while (len > 0 && !dec.done)
+  {
+    if ((n = fread (bufi, 1, MIN ((LOFF_T) sizeof (bufi), len), s->fpin)) == 0)
       break;
-    c3 = base64val (buf[2]);
-    ch = ((c2 & 0xf) << 4) | (c3 >> 2);
-
-    if (cr && ch != '\n')
-      bufi[l++] = '\r';
-
-    cr = 0;
-
-    if (istext && ch == '\r')
-      cr = 1;
-    else
-      bufi[l++] = ch;
+    len -= n;
 
-    if (buf[3] == '=') break;
-    c4 = base64val (buf[3]);
-    ch = ((c3 & 0x3) << 6) | c4;
-
-    if (cr && ch != '\n')
-      bufi[l++] = '\r';
-    cr = 0;
-
-    if (istext && ch == '\r')
-      cr = 1;
+    /* decode behind the bytes mutt_convert_to_state() left over, for
+     * text with one spare byte for a pending CR */
+    if (istext)
+    {
+      n = mutt_b64_decode_block (&dec, bufd + l + 1, bufi, n);
+      l += b64_strip_cr (bufd + l, bufd + l + 1, n, &cr);
+    }
     else
-      bufi[l++] = ch;
-
-    if (l + 8 >= sizeof (bufi))
-      mutt_convert_to_state (cd, bufi, &l, s);
+      l += mutt_b64_decode_block (&dec, bufd + l, bufi, n);
+    mutt_convert_to_state (cd, bufd, &l, s);
   }
 
-  if (cr) bufi[l++] = '\r';
+  if (dec.nbits)
+    dprint (2, (debugfile, "%s:%d [mutt_decode_base64()]: "
+                "didn't get a multiple of 4 chars.\n", __FILE__, __LINE__));
+
+  if (cr) bufd[l++] = '\r';
 
-  mutt_convert_to_state (cd, bufi, &l, s);
+  mutt_convert_to_state (cd, bufd, &l, s);
   mutt_convert_to_state (cd, 0, 0, s);
 
   state_reset_prefix(s);
@@ -1229,6 +1222,316 @@ int mutt_can_decode (BODY *a)
   return (0);
 }
 
+/* Copies the output of an autoview command to the state, along with
+ * anything it wrote to stderr. */
+static void autoview_output (STATE *s, const char *command, FILE *fpout,
+                             FILE *fperr)
+{
+  char buffer[LONG_STRING];
+
+  /* Note: only replying and forwarding use s->prefix, but just to
+   * be safe, keep an explicit check for s->prefix too. */
+  if ((s->flags & (MUTT_REPLYING | MUTT_FORWARDING)) || s->prefix)
+  {
+    /* Remove ansi and formatting from autoview output.
+     * The user may want to see the formatting in the pager, but it
+     * shouldn't be in their quoted reply or inline forward text too.
+     */
+    BUFFER *stripped = mutt_buffer_pool_get ();
+    while (fgets (buffer, sizeof(buffer), fpout) != NULL)
+    {
+      mutt_buffer_strip_formatting (stripped, buffer, 0);
+      if (s->prefix)
+        state_puts (s->prefix, s);
+      state_puts (mutt_b2s (stripped), s);
+    }
+    mutt_buffer_pool_release (&stripped);
+  }
+  else
+  {
+    mutt_copy_stream (fpout, s->fpout);
+  }
+
+  /* Check for stderr messages */
+  if (fgets (buffer, sizeof(buffer), fperr))
+  {
+    if (s->flags & MUTT_DISPLAY)
+    {
+      state_mark_attach (s);
+      state_printf (s, _("[-- Autoview stderr of %s --]\n"), command);
+    }
+
+    if (s->prefix)
+      state_puts (s->prefix, s);
+    state_puts (buffer, s);
+
+    if (s->prefix)
+    {
+      while (fgets (buffer, sizeof(buffer), fperr) != NULL)
+      {
+        state_puts (s->prefix, s);
+        state_puts (buffer, s);
+      }
+    }
+    else
+      mutt_copy_stream (fperr, s->fpout);
+  }
+}
+
+/*
+ * With $autoview_jobs above 1, the autoview commands of sibling parts
+ * are started ahead of time, so that they run alongside each other
+ * while earlier parts are rendered.  Their output goes to unlinked
+ * temporary files, which autoview_finish() copies out in part order
+ * exactly as autoview_handler() would have.
+ */
+
+typedef struct autoview_job
+{
+  BODY *body;
+  char *command;
+  char *tempfile;	/* NULL once unlinked */
+  FILE *fpin;		/* input for piped commands */
+  FILE *fpout;
+  FILE *fperr;
+  pid_t pid;
+  struct autoview_job *next;
+} AUTOVIEW_JOB;
+
+static AUTOVIEW_JOB *AutoviewJobList = NULL;
+static int AutoviewJobCount = 0;
+
+static AUTOVIEW_JOB *autoview_find_job (BODY *b)
+{
+  AUTOVIEW_JOB *job;
+
+  for (job = AutoviewJobList; job; job = job->next)
+    if (job->body == b)
+      return job;
+  return NULL;
+}
+
+/* Waits for the job's command, if it is still running, and removes the
+ * job from the list. */
+static void autoview_free_job (AUTOVIEW_JOB **pjob)
+{
+  AUTOVIEW_JOB **p, *job = *pjob;
+
+  for (p = &AutoviewJobList; *p; p = &(*p)->next)
+    if (*p == job)
+    {
+      *p = job->next;
+      AutoviewJobCount--;
+      break;
+    }
+
+  if (job->pid > 0)
+    mutt_wait_filter (job->pid);
+  safe_fclose (&job->fpin);
+  safe_fclose (&job->fpout);
+  safe_fclose (&job->fperr);
+  if (job->tempfile)
+    mutt_unlink (job->tempfile);
+  FREE (&job->tempfile);
+  FREE (&job->command);
+  FREE (pjob);		/* __FREE_CHECKED__ */
+}
+
+static FILE *autoview_open_output (void)
+{
+  BUFFER *tempfile = mutt_buffer_pool_get ();
+  FILE *fp;
+
+  mutt_buffer_mktemp (tempfile);
+  if ((fp = safe_fopen (mutt_b2s (tempfile), "w+")) != NULL)
+    unlink (mutt_b2s (tempfile));
+  mutt_buffer_pool_release (&tempfile);
+
+  return fp;
+}
+
+/* Decodes `a' as run_decode_and_handler() would for autoview_handler()
+ * and starts its autoview command.  Returns 0 on success; on failure the
+ * part is left for autoview_handler(). */
+static int autoview_start (BODY *a, STATE *s)
+{
+  rfc1524_entry *entry = rfc1524_new_entry ();
+  char type[STRING];
+  BUFFER *command = NULL;
+  BUFFER *tempfile = NULL;
+  AUTOVIEW_JOB *job = NULL;
+  STATE decode;
+  char *fname;
+  int piped;
+  int rc = -1;
+
+  command = mutt_buffer_pool_get ();
+  tempfile = mutt_buffer_pool_get ();
+
+  snprintf (type, sizeof (type), "%s/%s", TYPE (a), a->subtype);
+  rfc1524_mailcap_lookup (a, type, sizeof(type), entry, MUTT_AUTOVIEW);
+  if (!entry->command)
+    goto cleanup;
+
+  fname = safe_strdup (a->filename);
+  mutt_sanitize_filename (fname, MUTT_SANITIZE_ALLOW_8BIT);
+  mutt_rfc1524_expand_filename (entry->nametemplate, fname, tempfile);
+  FREE (&fname);
+
+  mutt_buffer_strcpy (command, entry->command);
+  piped = mutt_rfc1524_expand_command (a, mutt_b2s (tempfile), type, command);
+
+  job = safe_calloc (1, sizeof (AUTOVIEW_JOB));
+  job->body = a;
+  job->command = safe_strdup (mutt_b2s (command));
+  job->tempfile = safe_strdup (mutt_b2s (tempfile));
+
+  if ((job->fpin = safe_fopen (job->tempfile, "w+")) == NULL)
+  {
+    FREE (&job->tempfile);
+    goto cleanup;
+  }
+  if ((job->fpout = autoview_open_output ()) == NULL ||
+      (job->fperr = autoview_open_output ()) == NULL)
+    goto cleanup;
+
+  memset (&decode, 0, sizeof (decode));
+  decode.fpin = s->fpin;
+  decode.fpout = job->fpin;
+  decode.flags = s->flags & ~MUTT_CHARCONV;
+
+  fseeko (s->fpin, a->offset, SEEK_SET);
+  if (a->encoding == ENCBASE64 || a->encoding == ENCQUOTEDPRINTABLE ||
+      a->encoding == ENCUUENCODED || mutt_is_text_part (a))
+    mutt_decode_attachment (a, &decode);
+  else
+    mutt_copy_bytes (s->fpin, job->fpin, a->length);
+
+  if (!piped)
+  {
+    safe_fclose (&job->fpin);
+    job->pid = _mutt_create_filter_fd (job->command, NULL, NULL, NULL, -1,
+                                       fileno (job->fpout), fileno (job->fperr),
+                                       MUTT_FILTER_NEW_GROUP);
+  }
+  else
+  {
+    unlink (job->tempfile);
+    FREE (&job->tempfile);
+    fflush (job->fpin);
+    rewind (job->fpin);
+    job->pid = _mutt_create_filter_fd (job->command, NULL, NULL, NULL,
+                                       fileno (job->fpin), fileno (job->fpout),
+                                       fileno (job->fperr), MUTT_FILTER_NEW_GROUP);
+  }
+
+  if (job->pid < 0)
+    goto cleanup;
+
+  dprint (2, (debugfile, "autoview_start: started %s for %s (pid %d)\n",
+              job->command, type, (int) job->pid));
+  job->next = AutoviewJobList;
+  AutoviewJobList = job;
+  AutoviewJobCount++;
+  job = NULL;
+  rc = 0;
+
+cleanup:
+  if (job)
+  {
+    safe_fclose (&job->fpin);
+    safe_fclose (&job->fpout);
+    safe_fclose (&job->fperr);
+    if (job->tempfile)
+      mutt_unlink (job->tempfile);
+    FREE (&job->tempfile);
+    FREE (&job->command);
+    FREE (&job);
+  }
+  rfc1524_free_entry (&entry);
+  mutt_buffer_pool_release (&command);
+  mutt_buffer_pool_release (&tempfile);
+
+  return rc;
+}
+
+/* Starts the autoview commands of `parts' and its following siblings,
+ * while fewer than $autoview_jobs are running. */
+static void autoview_start_jobs (BODY *parts, STATE *s)
+{
+  BODY *p;
+
+  /* multipart_handler() stops after the first part */
+  if ((s->flags & MUTT_REPLYING) && option (OPTINCLUDEONLYFIRST))
+    return;
+
+  for (p = parts; p && AutoviewJobCount < AutoviewJobs; p = p->next)
+  {
+    /* the same checks mutt_body_handler() makes before choosing
+     * autoview_handler() */
+    if (option (OPTHONORDISP) && p->disposition == DISPATTACH &&
+        !option (OPTVIEWATTACH))
+      continue;
+    if (autoview_find_job (p) || !mutt_is_autoview (p))
+      continue;
+    if (autoview_start (p, s) < 0)
+      break;
+  }
+}
+
+/* Stops waiting on the jobs of `parts' that were never displayed. */
+static void autoview_discard_jobs (BODY *parts)
+{
+  AUTOVIEW_JOB *job;
+  BODY *p;
+
+  for (p = parts; p; p = p->next)
+    if ((job = autoview_find_job (p)))
+    {
+      /* the shell's children too */
+      kill (-job->pid, SIGTERM);
+      autoview_free_job (&job);
+    }
+}
+
+/* Terminates all started autoview commands.  Only calls kill(), so that
+ * it can be used from a signal handler. */
+void mutt_autoview_kill_jobs (void)
+{
+  AUTOVIEW_JOB *job;
+
+  for (job = AutoviewJobList; job; job = job->next)
+    if (job->pid > 0)
+      kill (-job->pid, SIGTERM);
+}
+
+/* The counterpart of autoview_handler() for a part whose command was
+ * started by autoview_start(). */
+static int autoview_finish (AUTOVIEW_JOB *job, STATE *s)
+{
+  if (s->flags & MUTT_DISPLAY)
+  {
+    state_mark_attach (s);
+    state_printf (s, _("[-- Autoview using %s --]\n"), job->command);
+    mutt_message(_("Invoking autoview command: %s"), job->command);
+  }
+
+  /* a pager streaming the output can show what came before meanwhile */
+  fflush (s->fpout);
+  mutt_wait_filter (job->pid);
+  job->pid = -1;
+  rewind (job->fpout);
+  rewind (job->fperr);
+  autoview_output (s, job->command, job->fpout, job->fperr);
+
+  autoview_free_job (&job);
+
+  if (s->flags & MUTT_DISPLAY)
+    mutt_clear_error ();
+
+  return 0;
+}
+
 static int multipart_handler (BODY *a, STATE *s)
 {
   BODY *b, *p;
@@ -1253,6 +1556,9 @@ static int multipart_handler (BODY *a, STATE *s)
 
   for (p = b->parts, count = 1; p; p = p->next, count++)
   {
+    if (AutoviewJobs > 1)
+      autoview_start_jobs (p, s);
+
     if (s->flags & MUTT_DISPLAY)
     {
       state_mark_attach (s);
@@ -1293,6 +1599,9 @@ static int multipart_handler (BODY *a, STATE *s)
       break;
   }
 
+  if (AutoviewJobList)
+    autoview_discard_jobs (b->parts);
+
   if (a->encoding == ENCBASE64 || a->encoding == ENCQUOTEDPRINTABLE ||
       a->encoding == ENCUUENCODED)
     mutt_free_body (&b);
@@ -1306,7 +1615,6 @@ static int multipart_handler (BODY *a, STATE *s)
 static int autoview_handler (BODY *a, STATE *s)
 {
   rfc1524_entry *entry = rfc1524_new_entry ();
-  char buffer[LONG_STRING];
   char type[STRING];
   BUFFER *command = NULL;
   BUFFER *tempfile = NULL;
@@ -1378,53 +1686,9 @@ static int autoview_handler (BODY *a, STATE *s)
       goto bail;
     }
 
-    /* Note: only replying and forwarding use s->prefix, but just to
-     * be safe, keep an explicit check for s->prefix too. */
-    if ((s->flags & (MUTT_REPLYING | MUTT_FORWARDING)) || s->prefix)
-    {
-      /* Remove ansi and formatting from autoview output.
-       * The user may want to see the formatting in the pager, but it
-       * shouldn't be in their quoted reply or inline forward text too.
-       */
-      BUFFER *stripped = mutt_buffer_pool_get ();
-      while (fgets (buffer, sizeof(buffer), fpout) != NULL)
-      {
-        mutt_buffer_strip_formatting (stripped, buffer, 0);
-        if (s->prefix)
-          state_puts (s->prefix, s);
-        state_puts (mutt_b2s (stripped), s);
-      }
-      mutt_buffer_pool_release (&stripped);
-    }
-    else
-    {
-      mutt_copy_stream (fpout, s->fpout);
-    }
-
-    /* Check for stderr messages */
-    if (fgets (buffer, sizeof(buffer), fperr))
-    {
-      if (s->flags & MUTT_DISPLAY)
-      {
-        state_mark_attach (s);
-        state_printf (s, _("[-- Autoview stderr of %s --]\n"), mutt_b2s (command));
-      }
-
-      if (s->prefix)
-        state_puts (s->prefix, s);
-      state_puts (buffer, s);
-
-      if (s->prefix)
-      {
-	while (fgets (buffer, sizeof(buffer), fperr) != NULL)
-	{
-	  state_puts (s->prefix, s);
-	  state_puts (buffer, s);
-	}
-      }
-      else
-        mutt_copy_stream (fperr, s->fpout);
-    }
+    /* a pager streaming the output can show what came before meanwhile */
+    fflush (s->fpout);
+    autoview_output (s, mutt_b2s (command), fpout, fperr);
 
   bail:
     safe_fclose (&fpout);
@@ -1579,7 +1843,7 @@ void mutt_decode_attachment (const BODY *b, STATE *s)
   }
 
   if (cd != (iconv_t)(-1))
-    iconv_close (cd);
+    mutt_iconv_close (cd);
 }
 
 /* when generating format=flowed ($text_flowed is set) from format=fixed,
@@ -1775,6 +2039,7 @@ int mutt_body_handler (BODY *b, STATE *s)
 {
   int plaintext = 0;
   handler_t handler = NULL, encrypted_handler = NULL;
+  AUTOVIEW_JOB *job;
   int rc = 0;
   static unsigned short recurse_level = 0;
 
@@ -1881,7 +2146,13 @@ int mutt_body_handler (BODY *b, STATE *s)
         !option (OPTINCLUDEENCRYPTED))
       goto cleanup;
 
-    rc = run_decode_and_handler (b, s, handler, plaintext);
+    if (handler == autoview_handler && (job = autoview_find_job (b)))
+    {
+      rc = autoview_finish (job, s);
+      s->flags |= MUTT_FIRSTDONE;
+    }
+    else
+      rc = run_decode_and_handler (b, s, handler, plaintext);
   }
   /* print hint to use attachment menu for disposition == attachment
      if we're not already being called from there */
@@ -235,6 +235,7 @@ static char *apply_subject_mods (ENVELOPE *env)
  * %N = score
  * %O = like %L, except using address instead of name
  * %P = progress indicator for builtin pager
+ * %Q = search match last jumped to in builtin pager, and the total
  * %r = comma separated list of To: recipients
  * %R = comma separated list of Cc: recipients
  * %s = subject
@@ -567,6 +568,13 @@ hdr_format_str (char *dest,
       strfcpy(dest, NONULL(hfi->pager_progress), destlen);
       break;
 
+    case 'Q':
+      if (!optional)
+        mutt_format_s (dest, destlen, prefix, NONULL (hfi->pager_search));
+      else if (!hfi->pager_search || !*hfi->pager_search)
+        optional = 0;
+      break;
+
     case 'r':
       buf2[0] = 0;
       rfc822_write_address(buf2, sizeof(buf2), hdr->env->to, 1);
@@ -801,6 +809,7 @@ _mutt_make_string (char *dest, size_t destlen, const char *s, CONTEXT *ctx, HEAD
   hfi.hdr = hdr;
   hfi.ctx = ctx;
   hfi.pager_progress = 0;
+  hfi.pager_search = NULL;
 
   mutt_FormatString (dest, destlen, 0, MuttIndexWindow->cols, s, hdr_format_str, &hfi, flags);
 }
@@ -23,6 +23,7 @@
 #include "mutt.h"
 #include "mailbox.h"
 #include "mutt_crypt.h"
+#include "rfc2047.h"
 
 #ifdef USE_COMPRESSED
 #include "compress.h"
@@ -258,6 +259,10 @@ int mutt_parse_hook (BUFFER *buf, BUFFER *s, union pointer_long_t udata, BUFFER
   rc = 0;
 
 cleanup:
+  /* decoded headers depend on these */
+  if (!rc && (data & (MUTT_CHARSETHOOK | MUTT_ICONVHOOK)))
+    rfc2047_decode_cache_flush ();
+
   mutt_buffer_pool_release (&command);
   mutt_buffer_pool_release (&pattern);
   return rc;
@@ -281,6 +286,9 @@ static void delete_hooks (int type)
   HOOK *h;
   HOOK *prev;
 
+  if (!type || type == MUTT_CHARSETHOOK || type == MUTT_ICONVHOOK)
+    rfc2047_decode_cache_flush ();
+
   while (h = Hooks, h && (type == 0 || type == h->type))
   {
     Hooks = h->next;
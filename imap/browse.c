@@ -451,9 +451,7 @@ static void imap_add_folder (char delim, char *folder, int noselect,
   (state->entry)[state->entrylen].selectable = !noselect;
   (state->entry)[state->entrylen].inferiors = !noinferiors;
 
-  b = Incoming;
-  while (b && mutt_strcmp (tmp, mutt_b2s (b->pathbuf)))
-    b = b->next;
+  b = mutt_buffy_find_path (tmp);
   if (b)
   {
     if (Context && !b->nopoll &&
@@ -43,6 +43,7 @@ static int cmd_queue_full (IMAP_DATA* idata);
 static int cmd_queue (IMAP_DATA* idata, const char* cmdstr, int flags);
 static IMAP_COMMAND* cmd_new (IMAP_DATA* idata);
 static int cmd_status (const char *s);
+static int cmd_idle_dispatch (CONNECTION* conn);
 static void cmd_handle_fatal (IMAP_DATA* idata);
 static int cmd_handle_untagged (IMAP_DATA* idata);
 static void cmd_parse_capability (IMAP_DATA* idata, char* s);
@@ -291,6 +292,88 @@ int imap_exec (IMAP_DATA* idata, const char* cmdstr, int flags)
   return 0;
 }
 
+/* imap_exec_all: send the commands queued on each of the nidata
+ * connections in idatas, then collect the responses from all of them
+ * together, reading from whichever connection has data.  Waiting on
+ * several servers thus takes as long as the slowest one rather than
+ * the sum of them.  Failed commands are tolerated as with
+ * IMAP_CMD_FAIL_OK, and a connection is given up on if no server
+ * responds for $imap_poll_timeout seconds.
+ * Returns 0 on success, -1 if any connection failed */
+int imap_exec_all (IMAP_DATA** idatas, int nidata)
+{
+  CONNECTION** conns;
+  int* pending;
+  int npending = 0;
+  int i, rc, retval = 0;
+
+  conns = safe_calloc (nidata, sizeof (CONNECTION*));
+  pending = safe_calloc (nidata, sizeof (int));
+
+  for (i = 0; i < nidata; i++)
+  {
+    if (cmd_start (idatas[i], NULL, 0) < 0)
+    {
+      cmd_handle_fatal (idatas[i]);
+      retval = -1;
+      continue;
+    }
+    pending[i] = 1;
+    npending++;
+  }
+
+  while (npending)
+  {
+    for (i = 0; i < nidata; i++)
+      conns[i] = pending[i] ? idatas[i]->conn : NULL;
+
+    i = mutt_socket_select (conns, nidata,
+                            ImapPollTimeout > 0 ? ImapPollTimeout : 60);
+    if (i < 0)
+    {
+      if (SigInt)
+      {
+        mutt_query_exit ();
+        continue;
+      }
+      if (ImapPollTimeout <= 0)
+        continue;
+
+      for (i = 0; i < nidata; i++)
+      {
+        if (!pending[i])
+          continue;
+        mutt_error (_("Connection to %s timed out"),
+                    idatas[i]->conn->account.host);
+        mutt_sleep (0);
+        cmd_handle_fatal (idatas[i]);
+        pending[i] = 0;
+      }
+      npending = 0;
+      retval = -1;
+      break;
+    }
+
+    rc = imap_cmd_step (idatas[i]);
+    if (rc == IMAP_CMD_CONTINUE)
+      continue;
+
+    pending[i] = 0;
+    npending--;
+    if (rc != IMAP_CMD_OK && idatas[i]->status == IMAP_FATAL)
+    {
+      dprint (1, (debugfile, "imap_exec_all: command failed: %s\n",
+                  idatas[i]->buf));
+      retval = -1;
+    }
+  }
+
+  FREE (&conns);
+  FREE (&pending);
+
+  return retval;
+}
+
 /* imap_cmd_finish
  *
  * If a reopen is allowed, it attempts to perform cleanup (eg fetch new
@@ -308,7 +391,9 @@ void imap_cmd_finish (IMAP_DATA* idata)
     return;
   }
 
-  if (!(idata->state >= IMAP_SELECTED) || idata->ctx->closing)
+  /* helper connections opened by imap_read_headers() have a mailbox
+   * examined but no context of their own */
+  if (!(idata->state >= IMAP_SELECTED) || !idata->ctx || idata->ctx->closing)
     return;
 
   if (idata->reopen & IMAP_REOPEN_ALLOW)
@@ -361,6 +446,8 @@ int imap_cmd_idle (IMAP_DATA* idata)
   {
     /* successfully entered IDLE state */
     idata->state = IMAP_IDLE;
+    /* let the keyboard wait pick up notifications as they arrive */
+    idata->conn->conn_dispatch = cmd_idle_dispatch;
     /* queue automatic exit when next command is issued */
     mutt_buffer_addstr (idata->cmdbuf, "DONE\r\n");
     rc = IMAP_CMD_OK;
@@ -456,7 +543,10 @@ static int cmd_start (IMAP_DATA* idata, const char* cmdstr, int flags)
 
   /* unidle when command queue is flushed */
   if (idata->state == IMAP_IDLE)
+  {
     idata->state = IMAP_SELECTED;
+    idata->conn->conn_dispatch = NULL;
+  }
 
   return (rc < 0) ? IMAP_CMD_BAD : 0;
 }
@@ -474,6 +564,36 @@ static int cmd_status (const char *s)
   return IMAP_CMD_BAD;
 }
 
+/* cmd_idle_dispatch: conn_dispatch hook for an IDLEing connection.
+ * Consumes the untagged responses that have arrived, leaving them for
+ * imap_check_mailbox() to act on.  Returns 1 if anything was read, so
+ * that the caller runs a mailbox check. */
+static int cmd_idle_dispatch (CONNECTION* conn)
+{
+  IMAP_DATA* idata = (IMAP_DATA*) conn->data;
+  int rc = 0;
+
+  if (!idata || idata->state != IMAP_IDLE)
+  {
+    conn->conn_dispatch = NULL;
+    return 0;
+  }
+
+  while (mutt_socket_poll (conn, 0) > 0)
+  {
+    rc = 1;
+    if (imap_cmd_step (idata) != IMAP_CMD_CONTINUE)
+    {
+      /* leave error handling to imap_check_mailbox() */
+      dprint (1, (debugfile, "cmd_idle_dispatch: error reading IDLE response\n"));
+      conn->conn_dispatch = NULL;
+      break;
+    }
+  }
+
+  return rc;
+}
+
 /* cmd_handle_fatal: when IMAP_DATA is in fatal state, do what we can */
 static void cmd_handle_fatal (IMAP_DATA* idata)
 {
@@ -1130,101 +1130,168 @@ int imap_has_flag (LIST* flag_list, const char* flag)
   return 0;
 }
 
-static int compare_uid (const void *a, const void *b)
+/* A message set being turned into commands of the form
+ * "pre <set> post".  See imap_exec_msgset for the meaning of the
+ * fields. */
+typedef struct
 {
-  HEADER **pa = (HEADER **) a;
-  HEADER **pb = (HEADER **) b;
+  const char *pre;
+  const char *post;
+  int flag;
+  int changed;
+  int invert;
+
+  BUFFER *cmd;          /* command under construction */
+  unsigned int start;   /* first UID of the open range, 0 if none */
+  unsigned int end;     /* last UID of the open range */
+  int count;            /* number of messages in the set */
+}
+IMAP_MSGSET;
 
-  return mutt_numeric_cmp (HEADER_DATA(*pa)->uid, HEADER_DATA(*pb)->uid);
+static void msgset_init (IMAP_MSGSET *set, const char *pre, const char *post,
+                         int flag, int changed, int invert)
+{
+  memset (set, 0, sizeof (IMAP_MSGSET));
+  set->pre = pre;
+  set->post = post;
+  set->flag = flag;
+  set->changed = changed;
+  set->invert = invert;
+  set->cmd = mutt_buffer_pool_get ();
 }
 
-/* Note: headers must be in SORT_UID. See imap_exec_msgset for args.
- * Pos is an opaque pointer a la strtok. It should be 0 at first call. */
-static int imap_make_msg_set (IMAP_DATA* idata, BUFFER* buf, int flag,
-                              int changed, int invert, int* pos)
+static int msgset_match (IMAP_MSGSET *set, HEADER *h)
 {
-  HEADER** hdrs = idata->ctx->hdrs;
-  int count = 0;	/* number of messages in message set */
-  int match = 0;	/* whether current message matches flag condition */
-  unsigned int setstart = 0;	/* start of current message range */
-  int n;
-  int started = 0;
+  int match = 0;
 
-  hdrs = idata->ctx->hdrs;
+  /* don't include pending expunged messages.
+   *
+   * TODO: can we unset active in cmd_parse_expunge() and
+   * cmd_parse_vanished() instead of checking for index != INT_MAX. */
+  if (!h || !h->active || (h->index == INT_MAX))
+    return 0;
 
-  for (n = *pos;
-       (n < idata->ctx->msgcount) && (mutt_buffer_len (buf) < IMAP_MAX_CMDLEN);
-       n++)
+  switch (set->flag)
   {
-    match = 0;
-    /* don't include pending expunged messages.
-     *
-     * TODO: can we unset active in cmd_parse_expunge() and
-     * cmd_parse_vanished() instead of checking for index != INT_MAX. */
-    if (hdrs[n]->active && (hdrs[n]->index != INT_MAX))
-      switch (flag)
-      {
-        case MUTT_DELETED:
-          if (hdrs[n]->deleted != HEADER_DATA(hdrs[n])->deleted)
-            match = invert ^ hdrs[n]->deleted;
-	  break;
-        case MUTT_FLAG:
-          if (hdrs[n]->flagged != HEADER_DATA(hdrs[n])->flagged)
-            match = invert ^ hdrs[n]->flagged;
-	  break;
-        case MUTT_OLD:
-          if (hdrs[n]->old != HEADER_DATA(hdrs[n])->old)
-            match = invert ^ hdrs[n]->old;
-	  break;
-        case MUTT_READ:
-          if (hdrs[n]->read != HEADER_DATA(hdrs[n])->read)
-            match = invert ^ hdrs[n]->read;
-	  break;
-        case MUTT_REPLIED:
-          if (hdrs[n]->replied != HEADER_DATA(hdrs[n])->replied)
-            match = invert ^ hdrs[n]->replied;
-	  break;
-
-        case MUTT_TAG:
-	  if (hdrs[n]->tagged)
-	    match = 1;
-	  break;
-        case MUTT_TRASH:
-          if (hdrs[n]->deleted && !hdrs[n]->purge)
-            match = 1;
-	  break;
-      }
+    case MUTT_DELETED:
+      if (h->deleted != HEADER_DATA(h)->deleted)
+        match = set->invert ^ h->deleted;
+      break;
+    case MUTT_FLAG:
+      if (h->flagged != HEADER_DATA(h)->flagged)
+        match = set->invert ^ h->flagged;
+      break;
+    case MUTT_OLD:
+      if (h->old != HEADER_DATA(h)->old)
+        match = set->invert ^ h->old;
+      break;
+    case MUTT_READ:
+      if (h->read != HEADER_DATA(h)->read)
+        match = set->invert ^ h->read;
+      break;
+    case MUTT_REPLIED:
+      if (h->replied != HEADER_DATA(h)->replied)
+        match = set->invert ^ h->replied;
+      break;
+
+    case MUTT_TAG:
+      if (h->tagged)
+        match = 1;
+      break;
+    case MUTT_TRASH:
+      if (h->deleted && !h->purge)
+        match = 1;
+      break;
+  }
+
+  return match && (!set->changed || h->changed);
+}
+
+/* moves the command under construction to out, one command per line */
+static void msgset_finish_cmd (IMAP_MSGSET *set, BUFFER *out)
+{
+  if (!mutt_buffer_len (set->cmd))
+    return;
+
+  mutt_buffer_add_printf (out, "%s %s\n", mutt_b2s (set->cmd), set->post);
+  mutt_buffer_clear (set->cmd);
+}
+
+static void msgset_close_range (IMAP_MSGSET *set, BUFFER *out)
+{
+  if (!set->start)
+    return;
+
+  if (mutt_buffer_len (set->cmd))
+    mutt_buffer_addch (set->cmd, ',');
+  else
+    mutt_buffer_add_printf (set->cmd, "%s ", set->pre);
+
+  if (set->end > set->start)
+    mutt_buffer_add_printf (set->cmd, "%u:%u", set->start, set->end);
+  else
+    mutt_buffer_add_printf (set->cmd, "%u", set->start);
+  set->start = 0;
 
-    if (match && (!changed || hdrs[n]->changed))
+  if (mutt_buffer_len (set->cmd) >= IMAP_MAX_CMDLEN)
+    msgset_finish_cmd (set, out);
+}
+
+/* Builds the commands for several message sets in a single pass over
+ * the msn_index, which is ordered by UID already.  A range is only
+ * broken by a message that doesn't match, so it may span UIDs that
+ * don't exist in the mailbox.  The commands are appended to out, one
+ * per line, for imap_exec_cmds().  Nothing here talks to the server, so
+ * untagged EXPUNGE responses can't shift the msn_index under us. */
+static void imap_make_msg_sets (IMAP_DATA* idata, IMAP_MSGSET *sets,
+                                int nsets, BUFFER *out)
+{
+  HEADER *h;
+  unsigned int msn;
+  int i;
+
+  for (msn = 0; msn < idata->max_msn; msn++)
+  {
+    h = idata->msn_index[msn];
+
+    for (i = 0; i < nsets; i++)
     {
-      count++;
-      if (setstart == 0)
+      if (msgset_match (&sets[i], h))
       {
-        setstart = HEADER_DATA (hdrs[n])->uid;
-        if (started == 0)
-	{
-	  mutt_buffer_add_printf (buf, "%u", HEADER_DATA (hdrs[n])->uid);
-	  started = 1;
-	}
-        else
-	  mutt_buffer_add_printf (buf, ",%u", HEADER_DATA (hdrs[n])->uid);
+        if (!sets[i].start)
+          sets[i].start = HEADER_DATA (h)->uid;
+        sets[i].end = HEADER_DATA (h)->uid;
+        sets[i].count++;
       }
-      /* tie up if the last message also matches */
-      else if (n == idata->ctx->msgcount-1)
-	mutt_buffer_add_printf (buf, ":%u", HEADER_DATA (hdrs[n])->uid);
-    }
-    /* End current set if message doesn't match. */
-    else if (setstart)
-    {
-      if (HEADER_DATA (hdrs[n-1])->uid > setstart)
-	mutt_buffer_add_printf (buf, ":%u", HEADER_DATA (hdrs[n-1])->uid);
-      setstart = 0;
+      else
+        msgset_close_range (&sets[i], out);
     }
   }
 
-  *pos = n;
+  for (i = 0; i < nsets; i++)
+  {
+    msgset_close_range (&sets[i], out);
+    msgset_finish_cmd (&sets[i], out);
+    mutt_buffer_pool_release (&sets[i].cmd);
+  }
+}
 
-  return count;
+/* queues each line of cmds with imap_exec.
+ * Returns 0 on success, -1 on failure */
+static int imap_exec_cmds (IMAP_DATA* idata, BUFFER *cmds)
+{
+  char *cmd, *eol;
+
+  for (cmd = cmds->data; cmd && *cmd; cmd = eol + 1)
+  {
+    if (!(eol = strchr (cmd, '\n')))
+      break;
+    *eol = '\0';
+    if (imap_exec (idata, cmd, IMAP_CMD_QUEUE))
+      return -1;
+  }
+
+  return 0;
 }
 
 /* Prepares commands for all messages matching conditions (must be flushed
@@ -1240,75 +1307,20 @@ static int imap_make_msg_set (IMAP_DATA* idata, BUFFER* buf, int flag,
 int imap_exec_msgset (IMAP_DATA* idata, const char* pre, const char* post,
                       int flag, int changed, int invert)
 {
-  HEADER** hdrs = NULL;
-  short oldsort;
-  BUFFER* cmd;
-  int pos;
+  IMAP_MSGSET set;
+  BUFFER *cmds;
   int rc;
-  int count = 0, reopen_set = 0;
 
-  cmd = mutt_buffer_new ();
+  cmds = mutt_buffer_new ();
 
-  /* Unlike imap_sync_mailbox(), this function can be called when
-   * IMAP_REOPEN_ALLOW is not set.  In that case, the caller isn't
-   * prepared to handle context changes.  Resorting may not always
-   * give the same order, so we must make a copy.
-   *
-   * See the comment in imap_sync_mailbox() for the dangers of running
-   * even queued execs while reopen is set.  To prevent memory
-   * corruption and data loss we must disable reopen for the duration
-   * of the swapped hdrs.
-   */
-  if (idata->reopen & IMAP_REOPEN_ALLOW)
-  {
-    idata->reopen &= ~IMAP_REOPEN_ALLOW;
-    reopen_set = 1;
-  }
-  oldsort = Sort;
-  if (Sort != SORT_UID)
-  {
-    hdrs = idata->ctx->hdrs;
-    idata->ctx->hdrs = safe_malloc (idata->ctx->msgcount * sizeof (HEADER*));
-    memcpy (idata->ctx->hdrs, hdrs, idata->ctx->msgcount * sizeof (HEADER*));
-
-    Sort = SORT_UID;
-    qsort (idata->ctx->hdrs, idata->ctx->msgcount, sizeof (HEADER*),
-           compare_uid);
-  }
-
-  pos = 0;
-
-  do
-  {
-    mutt_buffer_clear (cmd);
-    mutt_buffer_add_printf (cmd, "%s ", pre);
-    rc = imap_make_msg_set (idata, cmd, flag, changed, invert, &pos);
-    if (rc > 0)
-    {
-      mutt_buffer_add_printf (cmd, " %s", post);
-      if (imap_exec (idata, cmd->data, IMAP_CMD_QUEUE))
-      {
-        rc = -1;
-        goto out;
-      }
-      count += rc;
-    }
-  }
-  while (rc > 0);
+  msgset_init (&set, pre, post, flag, changed, invert);
+  imap_make_msg_sets (idata, &set, 1, cmds);
 
-  rc = count;
-
-out:
-  mutt_buffer_free (&cmd);
-  if ((oldsort != Sort) || hdrs)
-  {
-    Sort = oldsort;
-    FREE (&idata->ctx->hdrs);
-    idata->ctx->hdrs = hdrs;
-  }
-  if (reopen_set)
-    idata->reopen |= IMAP_REOPEN_ALLOW;
+  rc = set.count;
+  if (imap_exec_cmds (idata, cmds) < 0)
+    rc = -1;
 
+  mutt_buffer_free (&cmds);
   return rc;
 }
 
@@ -1410,31 +1422,65 @@ int imap_sync_message_for_copy (IMAP_DATA *idata, HEADER *hdr, BUFFER *cmd,
   return 0;
 }
 
-static int sync_helper (IMAP_DATA* idata, int right, int flag, const char* name)
+/* Queues the UID STORE commands for all changed flags, building the
+ * message sets for every flag in one pass over the mailbox.
+ * Returns the number of changes queued, or -1 on failure. */
+static int sync_flags (IMAP_DATA* idata)
 {
-  int count = 0;
-  int rc;
-  char buf[LONG_STRING];
+  static const struct
+  {
+    int right;
+    int flag;
+    const char *name;
+  }
+  SyncFlags[] =
+  {
+    { MUTT_ACL_DELETE, MUTT_DELETED, "\\Deleted" },
+    { MUTT_ACL_WRITE,  MUTT_FLAG,    "\\Flagged" },
+    { MUTT_ACL_WRITE,  MUTT_OLD,     "Old" },
+    { MUTT_ACL_SEEN,   MUTT_READ,    "\\Seen" },
+    { MUTT_ACL_WRITE,  MUTT_REPLIED, "\\Answered" },
+  };
+  IMAP_MSGSET sets[2 * sizeof (SyncFlags) / sizeof (SyncFlags[0])];
+  char post[2 * sizeof (SyncFlags) / sizeof (SyncFlags[0])][SHORT_STRING];
+  BUFFER *cmds;
+  int i, nsets = 0, count = 0;
 
   if (!idata->ctx)
     return -1;
 
-  if (!mutt_bit_isset (idata->ctx->rights, right))
-    return 0;
+  for (i = 0; i < sizeof (SyncFlags) / sizeof (SyncFlags[0]); i++)
+  {
+    if (!mutt_bit_isset (idata->ctx->rights, SyncFlags[i].right))
+      continue;
+
+    if (SyncFlags[i].right == MUTT_ACL_WRITE &&
+        !imap_has_flag (idata->flags, SyncFlags[i].name))
+      continue;
+
+    snprintf (post[nsets], sizeof (post[nsets]), "+FLAGS.SILENT (%s)",
+              SyncFlags[i].name);
+    msgset_init (&sets[nsets], "UID STORE", post[nsets], SyncFlags[i].flag, 1, 0);
+    nsets++;
 
-  if (right == MUTT_ACL_WRITE && !imap_has_flag (idata->flags, name))
+    snprintf (post[nsets], sizeof (post[nsets]), "-FLAGS.SILENT (%s)",
+              SyncFlags[i].name);
+    msgset_init (&sets[nsets], "UID STORE", post[nsets], SyncFlags[i].flag, 1, 1);
+    nsets++;
+  }
+
+  if (!nsets)
     return 0;
 
-  snprintf (buf, sizeof(buf), "+FLAGS.SILENT (%s)", name);
-  if ((rc = imap_exec_msgset (idata, "UID STORE", buf, flag, 1, 0)) < 0)
-    return rc;
-  count += rc;
+  cmds = mutt_buffer_new ();
+  imap_make_msg_sets (idata, sets, nsets, cmds);
 
-  buf[0] = '-';
-  if ((rc = imap_exec_msgset (idata, "UID STORE", buf, flag, 1, 1)) < 0)
-    return rc;
-  count += rc;
+  for (i = 0; i < nsets; i++)
+    count += sets[i].count;
+  if (imap_exec_cmds (idata, cmds) < 0)
+    count = -1;
 
+  mutt_buffer_free (&cmds);
   return count;
 }
 
@@ -1448,8 +1494,6 @@ int imap_sync_mailbox (CONTEXT* ctx, int expunge, int* index_hint)
   IMAP_DATA* idata;
   CONTEXT* appendctx = NULL;
   HEADER* h;
-  HEADER** hdrs = NULL;
-  int oldsort;
   int n;
   int rc, quickdel_rc = 0;
 
@@ -1568,55 +1612,16 @@ int imap_sync_mailbox (CONTEXT* ctx, int expunge, int* index_hint)
   imap_hcache_close (idata);
 #endif
 
-  /* presort here to avoid doing 10 resorts in imap_exec_msgset.
-   *
-   * Note: sync_helper() may trigger an imap_exec() if the queue fills
-   * up.  Because IMAP_REOPEN_ALLOW is set, this may result in new
-   * messages being downloaded or an expunge being processed.  For new
-   * messages this would both result in memory corruption (since we're
-   * alloc'ing msgcount instead of hdrmax pointers) and data loss of
-   * the new messages.  For an expunge, the restored hdrs would point
-   * to headers that have been freed.
-   *
-   * Since reopen is allowed, we could sort before and after but this
-   * is noticable slower.
-   *
-   * So instead, just turn off reopen_allow for the duration of the
-   * swapped hdrs.  The imap_exec() below flushes the queue out,
-   * giving the opportunity to process any reopen events.
+  /* Note: the imap_exec() in sync_flags() flushes the queue if it fills
+   * up.  Processing new messages or expunges then would change the
+   * context under the loop below, so turn off reopen_allow until the
+   * imap_exec() below has flushed the rest of the queue.
    */
   imap_disallow_reopen (ctx);
-  oldsort = Sort;
-  if (Sort != SORT_UID)
-  {
-    hdrs = ctx->hdrs;
-    ctx->hdrs = safe_malloc (ctx->msgcount * sizeof (HEADER*));
-    memcpy (ctx->hdrs, hdrs, ctx->msgcount * sizeof (HEADER*));
-
-    Sort = SORT_UID;
-    qsort (ctx->hdrs, ctx->msgcount, sizeof (HEADER*),
-           compare_uid);
-  }
-
-  rc = sync_helper (idata, MUTT_ACL_DELETE, MUTT_DELETED, "\\Deleted");
-  if (rc >= 0)
-    rc |= sync_helper (idata, MUTT_ACL_WRITE, MUTT_FLAG, "\\Flagged");
-  if (rc >= 0)
-    rc |= sync_helper (idata, MUTT_ACL_WRITE, MUTT_OLD, "Old");
-  if (rc >= 0)
-    rc |= sync_helper (idata, MUTT_ACL_SEEN, MUTT_READ, "\\Seen");
-  if (rc >= 0)
-    rc |= sync_helper (idata, MUTT_ACL_WRITE, MUTT_REPLIED, "\\Answered");
-
-  if ((oldsort != Sort) || hdrs)
-  {
-    Sort = oldsort;
-    FREE (&ctx->hdrs);
-    ctx->hdrs = hdrs;
-  }
+  rc = sync_flags (idata);
   imap_allow_reopen (ctx);
 
-  /* Flush the queued flags if any were changed in sync_helper.
+  /* Flush the queued flags if any were changed in sync_flags.
    * The real (non-flag) changes loop might have flushed quickdel_rc
    * queued commands, so we double check the cmdbuf isn't empty. */
   if (((rc > 0) || (quickdel_rc > 0)) && mutt_buffer_len (idata->cmdbuf))
@@ -1896,12 +1901,14 @@ static int imap_get_mailbox (const char* path, IMAP_DATA** hidata, char* buf, si
 int imap_buffy_check (int force, int check_stats)
 {
   IMAP_DATA* idata;
-  IMAP_DATA* lastdata = NULL;
+  IMAP_DATA** pending = NULL;
+  int npending = 0, pendingmax = 0;
   BUFFY* mailbox;
   char name[LONG_STRING];
   char command[LONG_STRING*2];
   char munged[LONG_STRING];
   int buffies = 0;
+  int i;
 
   for (mailbox = Incoming; mailbox; mailbox = mailbox->next)
   {
@@ -1941,19 +1948,21 @@ int imap_buffy_check (int force, int check_stats)
       continue;
     }
 
-    if (lastdata && idata != lastdata)
+    /* Queue the commands for every server first, and send them
+     * all before waiting for any of the replies. */
+    for (i = 0; i < npending; i++)
+      if (pending[i] == idata)
+        break;
+    if (i == npending)
     {
-      /* Send commands to previous server. Sorting the buffy list
-       * may prevent some infelicitous interleavings */
-      if (imap_exec (lastdata, NULL, IMAP_CMD_FAIL_OK | IMAP_CMD_POLL) == -1)
-        dprint (1, (debugfile, "Error polling mailboxes\n"));
-
-      lastdata = NULL;
+      if (npending == pendingmax)
+      {
+        pendingmax += 5;
+        safe_realloc (&pending, pendingmax * sizeof (IMAP_DATA*));
+      }
+      pending[npending++] = idata;
     }
 
-    if (!lastdata)
-      lastdata = idata;
-
     imap_munge_mbox_name (idata, munged, sizeof (munged), name);
     if (check_stats)
       snprintf (command, sizeof (command),
@@ -1965,15 +1974,15 @@ int imap_buffy_check (int force, int check_stats)
     if (imap_exec (idata, command, IMAP_CMD_QUEUE | IMAP_CMD_POLL) < 0)
     {
       dprint (1, (debugfile, "Error queueing command\n"));
+      FREE (&pending);
       return 0;
     }
   }
 
-  if (lastdata && (imap_exec (lastdata, NULL, IMAP_CMD_FAIL_OK | IMAP_CMD_POLL) == -1))
-  {
+  /* a failed server doesn't invalidate the others' results */
+  if (npending && imap_exec_all (pending, npending) < 0)
     dprint (1, (debugfile, "Error polling mailboxes\n"));
-    return 0;
-  }
+  FREE (&pending);
 
   /* collect results */
   for (mailbox = Incoming; mailbox; mailbox = mailbox->next)
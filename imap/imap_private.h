@@ -281,6 +281,7 @@ void imap_cmd_finish (IMAP_DATA* idata);
 int imap_code (const char* s);
 const char* imap_cmd_trailer (IMAP_DATA* idata);
 int imap_exec (IMAP_DATA* idata, const char* cmd, int flags);
+int imap_exec_all (IMAP_DATA** idatas, int nidata);
 int imap_cmd_idle (IMAP_DATA* idata);
 
 /* message.c */
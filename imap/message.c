@@ -71,7 +71,7 @@ static FILE* msg_cache_put (IMAP_DATA* idata, HEADER* h);
 static int msg_cache_commit (IMAP_DATA* idata, HEADER* h);
 
 static int flush_buffer (char* buf, size_t* len, CONNECTION* conn);
-static int msg_fetch_header (CONTEXT* ctx, IMAP_HEADER* h, char* buf,
+static int msg_fetch_header (IMAP_DATA* idata, IMAP_HEADER* h, char* buf,
                              FILE* fp);
 static int msg_parse_fetch (IMAP_HEADER* h, char* s);
 static char* msg_parse_flags (IMAP_HEADER* h, char* s);
@@ -486,7 +486,7 @@ static int read_headers_normal_eval_cache (IMAP_DATA *idata,
       if (rc != IMAP_CMD_CONTINUE)
         break;
 
-      if ((mfhrc = msg_fetch_header (ctx, &h, idata->buf, NULL)) < 0)
+      if ((mfhrc = msg_fetch_header (idata, &h, idata->buf, NULL)) < 0)
         continue;
 
       if (!h.data->uid)
@@ -826,6 +826,448 @@ fail:
 }
 #endif  /* USE_HCACHE */
 
+/* Makes room for messages announced with EXISTS during a header
+ * download, extending *msn_end to cover them. */
+static void read_headers_grow_for_new_mail (IMAP_DATA *idata,
+                                            unsigned int *msn_end)
+{
+  CONTEXT *ctx = idata->ctx;
+
+  if (!(idata->reopen & IMAP_NEWMAIL_PENDING))
+    return;
+
+  *msn_end = idata->newMailCount;
+  while (*msn_end > ctx->hdrmax)
+    mx_alloc_memory (ctx);
+  imap_alloc_msn_index (idata, *msn_end);
+  idata->reopen &= ~IMAP_NEWMAIL_PENDING;
+  idata->newMailCount = 0;
+}
+
+/* Builds the HEADER for a FETCH response parsed by msg_fetch_header(),
+ * whose header fields were spooled to fp.  The header is entered into
+ * the msn_index and uid_hash; adding it to ctx->hdrs is up to the caller.
+ * Returns NULL if the response should be ignored. */
+static HEADER *read_headers_new_header (IMAP_DATA *idata, IMAP_HEADER *h,
+                                        FILE *fp, unsigned int msn_first,
+                                        unsigned int msn_last,
+                                        unsigned int *maxuid)
+{
+  CONTEXT *ctx = idata->ctx;
+  HEADER *hdr;
+
+  if (!ftello (fp))
+  {
+    dprint (2, (debugfile, "msg_fetch_header: ignoring fetch response with no body\n"));
+    return NULL;
+  }
+
+  /* make sure we don't get remnants from older larger message headers */
+  fputs ("\n\n", fp);
+
+  if (h->data->msn < msn_first || h->data->msn > msn_last)
+  {
+    dprint (1, (debugfile, "imap_read_headers: skipping FETCH response for "
+                "unknown message number %d\n", h->data->msn));
+    return NULL;
+  }
+
+  /* May receive FLAGS updates in a separate untagged response (#2935) */
+  if (idata->msn_index[h->data->msn - 1])
+  {
+    dprint (2, (debugfile, "imap_read_headers: skipping FETCH response for "
+                "duplicate message %d\n", h->data->msn));
+    return NULL;
+  }
+
+  hdr = mutt_new_header ();
+
+  idata->max_msn = MAX (idata->max_msn, h->data->msn);
+  idata->msn_index[h->data->msn - 1] = hdr;
+  int_hash_insert (idata->uid_hash, h->data->uid, hdr);
+
+  /* messages which have not been expunged are ACTIVE (borrowed from mh
+   * folders) */
+  hdr->active = 1;
+  hdr->changed = 0;
+  hdr->read = h->data->read;
+  hdr->old = h->data->old;
+  hdr->deleted = h->data->deleted;
+  hdr->flagged = h->data->flagged;
+  hdr->replied = h->data->replied;
+  hdr->received = h->received;
+  hdr->data = (void *) (h->data);
+
+  if (*maxuid < h->data->uid)
+    *maxuid = h->data->uid;
+
+  rewind (fp);
+  /* NOTE: if Date: header is missing, mutt_read_rfc822_header depends
+   *   on h.received being set */
+  hdr->env = mutt_read_rfc822_header (fp, hdr, 0, 0);
+  /* content built as a side-effect of mutt_read_rfc822_header */
+  hdr->content->length = h->content_length;
+  ctx->size += h->content_length;
+
+#if USE_HCACHE
+  imap_hcache_put (idata, hdr);
+#endif /* USE_HCACHE */
+
+  h->data = NULL;
+
+  return hdr;
+}
+
+/* One share of a header download split across several connections. */
+typedef struct
+{
+  IMAP_DATA *idata;
+  unsigned int msn_first;     /* first message of this share */
+  unsigned int msn_begin;     /* first message of the outstanding FETCH */
+  unsigned int msn_end;       /* last message of this share */
+  unsigned int fetch_msn_end; /* last message of the outstanding FETCH */
+  int running;
+} FETCH_SLICE;
+
+/* don't bother splitting off shares smaller than this */
+#define IMAP_FETCH_SLICE_MIN 500
+#define IMAP_FETCH_CONNECTIONS_MAX 8
+
+/* Opens a connection examining the mailbox selected by idata, to fetch
+ * headers alongside it.  The mailbox must look the same from there
+ * (same UIDVALIDITY, UIDNEXT and message count), so that both
+ * connections agree on the message numbers. */
+static IMAP_DATA *fetch_helper_open (IMAP_DATA *idata, unsigned int msn_end)
+{
+  IMAP_DATA *hdata;
+  char mbox[LONG_STRING];
+  char buf[LONG_STRING*2];
+  unsigned int uid_validity = 0, uidnext = 0, count = 0;
+  char *pc;
+  int rc;
+
+  if (!(hdata = imap_conn_find (&idata->conn->account,
+                                MUTT_IMAP_CONN_NOSELECT)))
+    return NULL;
+
+  imap_munge_mbox_name (hdata, mbox, sizeof (mbox), idata->mailbox);
+  snprintf (buf, sizeof (buf), "EXAMINE %s", mbox);
+
+  /* Helpers have no context.  The untagged response handlers and
+   * imap_cmd_finish() know to leave such connections alone.  The
+   * connection isn't in the selected state until EXAMINE succeeds, so
+   * the EXISTS count is picked up here rather than by
+   * cmd_handle_untagged(). */
+  hdata->ctx = NULL;
+  hdata->max_msn = 0;
+  hdata->newMailCount = 0;
+
+  imap_cmd_start (hdata, buf);
+  do
+  {
+    if ((rc = imap_cmd_step (hdata)) != IMAP_CMD_CONTINUE)
+      break;
+
+    pc = hdata->buf + 2;
+    if (isdigit ((unsigned char) *pc) &&
+        ascii_strncasecmp ("EXISTS", imap_next_word (pc), 6) == 0)
+      mutt_atoui (pc, &count, MUTT_ATOI_ALLOW_TRAILING);
+    else if (ascii_strncasecmp ("OK [UIDVALIDITY", pc, 14) == 0)
+      mutt_atoui (imap_next_word (pc + 3), &uid_validity,
+                  MUTT_ATOI_ALLOW_TRAILING);
+    else if (ascii_strncasecmp ("OK [UIDNEXT", pc, 11) == 0)
+      mutt_atoui (imap_next_word (pc + 3), &uidnext,
+                  MUTT_ATOI_ALLOW_TRAILING);
+  }
+  while (rc == IMAP_CMD_CONTINUE);
+
+  hdata->reopen = 0;
+
+  if (rc != IMAP_CMD_OK ||
+      !idata->uidnext ||
+      uid_validity != idata->uid_validity ||
+      uidnext != idata->uidnext ||
+      count != msn_end)
+  {
+    dprint (2, (debugfile, "fetch_helper_open: mailbox differs on helper "
+                "connection (UIDVALIDITY %u/%u UIDNEXT %u/%u EXISTS %u/%u)\n",
+                uid_validity, idata->uid_validity, uidnext, idata->uidnext,
+                count, msn_end));
+    if (hdata->status == IMAP_FATAL)
+      imap_close_connection (hdata);
+    else if (rc == IMAP_CMD_OK)
+      imap_exec (hdata, "CLOSE", IMAP_CMD_FAIL_OK);
+    return NULL;
+  }
+
+  hdata->state = IMAP_SELECTED;
+
+  return hdata;
+}
+
+/* Returns a helper connection to the pool.  CLOSE doesn't expunge a
+ * mailbox opened with EXAMINE. */
+static void fetch_helper_close (IMAP_DATA *hdata)
+{
+  if (hdata->state == IMAP_DISCONNECTED)
+    return;
+
+  if (hdata->status == IMAP_FATAL)
+  {
+    imap_close_connection (hdata);
+    return;
+  }
+
+  if (imap_exec (hdata, "CLOSE", IMAP_CMD_FAIL_OK) < 0)
+  {
+    imap_close_connection (hdata);
+    return;
+  }
+  hdata->state = IMAP_AUTHENTICATED;
+}
+
+/* Sends the FETCH for the next chunk of a slice.
+ * Returns 0 if a command was sent, -1 if the slice is finished. */
+static int fetch_slice_next (FETCH_SLICE *slice, IMAP_DATA *idata,
+                             BUFFER *b, const char *hdrreq)
+{
+  char *cmd;
+  int rc;
+
+  if (slice->msn_begin > slice->msn_end ||
+      !imap_fetch_msn_seqset (b, idata, 0, slice->msn_begin, slice->msn_end,
+                              &slice->fetch_msn_end))
+    return -1;
+
+  safe_asprintf (&cmd, "FETCH %s (UID FLAGS INTERNALDATE RFC822.SIZE %s)",
+                 mutt_b2s (b), hdrreq);
+  rc = imap_cmd_start (slice->idata, cmd);
+  FREE (&cmd);
+
+  return rc < 0 ? -1 : 0;
+}
+
+/* Drops the headers of messages first..last from the msn_index, when a
+ * split download's results can't be used. */
+static void fetch_slices_discard (IMAP_DATA *idata, unsigned int first,
+                                  unsigned int last)
+{
+  CONTEXT *ctx = idata->ctx;
+  HEADER *h;
+  unsigned int msn;
+
+  for (msn = first; msn <= last; msn++)
+  {
+    if (!(h = idata->msn_index[msn - 1]))
+      continue;
+    int_hash_delete (idata->uid_hash, HEADER_DATA(h)->uid, h, NULL);
+    ctx->size -= h->content->length;
+    imap_free_header_data ((IMAP_HEADER_DATA**)&h->data);
+    mutt_free_header (&h);
+    idata->msn_index[msn - 1] = NULL;
+  }
+}
+
+/* Downloads the headers of messages msn_begin..msn_end, none of which
+ * may be in the msn_index yet, splitting the range between idata and up
+ * to $imap_fetch_connections helper connections.  The connections are
+ * read as their responses arrive, and the headers are appended to the
+ * context in message number (and so UID) order at the end.
+ *
+ * Messages that could not be fetched are left as holes in the msn_index
+ * for the caller to fill in.
+ *
+ * Returns 0 on success, 1 if the download was not split and -1 on
+ * abort or an error on idata itself.
+ */
+static int read_headers_fetch_parallel (IMAP_DATA *idata,
+                                        unsigned int msn_begin,
+                                        unsigned int msn_end,
+                                        const char *hdrreq, FILE *fp,
+                                        progress_t *progress,
+                                        unsigned int *maxuid)
+{
+  CONTEXT *ctx = idata->ctx;
+  FETCH_SLICE *slices = NULL;
+  CONNECTION **conns = NULL;
+  FETCH_SLICE *slice;
+  BUFFER *b = NULL;
+  IMAP_HEADER h;
+  HEADER *hdr;
+  unsigned int msn, count, share, fetched = 0, lastuid;
+  int nslices, active, ready, i, rc, mfhrc, retval = -1, noselect = 0;
+
+  count = msn_end - msn_begin + 1;
+  nslices = MIN (ImapFetchConnections, IMAP_FETCH_CONNECTIONS_MAX) + 1;
+  if (count / IMAP_FETCH_SLICE_MIN < nslices)
+    nslices = count / IMAP_FETCH_SLICE_MIN;
+  if (nslices < 2)
+    return 1;
+
+  slices = safe_calloc (nslices, sizeof (FETCH_SLICE));
+  conns = safe_calloc (nslices, sizeof (CONNECTION *));
+
+  slices[0].idata = idata;
+  for (i = 1; i < nslices; i++)
+    if (!(slices[i].idata = fetch_helper_open (idata, msn_end)))
+      break;
+  nslices = i;
+  if (nslices < 2)
+  {
+    retval = 1;
+    goto bail;
+  }
+
+  dprint (2, (debugfile, "imap_read_headers: fetching %u headers over %d "
+              "connections\n", count, nslices));
+
+  b = mutt_buffer_pool_get ();
+  share = count / nslices;
+  active = 0;
+  for (i = 0; i < nslices; i++)
+  {
+    slice = &slices[i];
+    slice->msn_first = slice->msn_begin = msn_begin + i * share;
+    slice->msn_end = (i == nslices - 1) ? msn_end : slice->msn_begin + share - 1;
+    if (fetch_slice_next (slice, idata, b, hdrreq) == 0)
+    {
+      slice->running = 1;
+      active++;
+    }
+    else if (!i)
+      goto fail;
+  }
+
+  while (active)
+  {
+    if (SigInt && query_abort_header_download (idata))
+      goto fail;
+
+    /* a connection closed under us is stepped right away to
+     * report the error */
+    ready = -1;
+    for (i = 0; i < nslices; i++)
+    {
+      conns[i] = slices[i].running ? slices[i].idata->conn : NULL;
+      if (conns[i] && conns[i]->fd < 0)
+        ready = i;
+    }
+    /* only idata is left after select() failed, so just block on it */
+    if (ready < 0 && noselect)
+      ready = 0;
+    if (ready < 0 && (ready = mutt_socket_select (conns, nslices, 60)) < 0)
+    {
+      if (ready == -1)
+        continue;
+
+      /* Fall back to the serial download: drop the helpers, leaving
+       * their shares to the caller, and stop idata after its current
+       * FETCH. */
+      dprint (1, (debugfile, "imap_read_headers: select() failed, errno=%d %s\n",
+                  errno, strerror (errno)));
+      noselect = 1;
+      for (i = 1; i < nslices; i++)
+        if (slices[i].running)
+        {
+          imap_close_connection (slices[i].idata);
+          slices[i].running = 0;
+          active--;
+        }
+      slices[0].msn_end = slices[0].fetch_msn_end;
+      continue;
+    }
+    slice = &slices[ready];
+
+    /* Each step handles a single response line, so that a connection
+     * that is ahead doesn't hold up the others. */
+    rewind (fp);
+    memset (&h, 0, sizeof (h));
+    h.data = safe_calloc (1, sizeof (IMAP_HEADER_DATA));
+    mfhrc = 0;
+
+    rc = imap_cmd_step (slice->idata);
+    if (rc == IMAP_CMD_CONTINUE &&
+        (mfhrc = msg_fetch_header (slice->idata, &h, slice->idata->buf, fp)) == 0 &&
+        read_headers_new_header (idata, &h, fp, slice->msn_begin,
+                                 slice->fetch_msn_end, maxuid))
+    {
+      fetched++;
+      if (!ctx->quiet)
+        mutt_progress_update (progress, msn_begin + fetched - 1, -1);
+    }
+    imap_free_header_data (&h.data);
+
+    if (rc == IMAP_CMD_CONTINUE && mfhrc >= -1)
+      continue;
+
+    if (rc == IMAP_CMD_OK)
+    {
+      slice->msn_begin = slice->fetch_msn_end + 1;
+      if (fetch_slice_next (slice, idata, b, hdrreq) == 0)
+        continue;
+      if (slice->msn_begin > slice->msn_end)
+      {
+        slice->running = 0;
+        active--;
+        continue;
+      }
+    }
+
+    /* An error on idata fails the whole download, like it would
+     * without helpers.  A helper's unfetched share is left to idata. */
+    if (slice->idata == idata)
+      goto fail;
+
+    dprint (1, (debugfile, "imap_read_headers: helper connection failed at "
+                "message %u\n", slice->msn_begin));
+    imap_close_connection (slice->idata);
+    slice->running = 0;
+    active--;
+  }
+
+  /* The helpers numbered the messages independently.  UIDs must increase
+   * with the message number, so if they don't the views have diverged
+   * (e.g. through an expunge) and the helpers' results can't be used. */
+  lastuid = 0;
+  for (msn = msn_begin; msn <= msn_end; msn++)
+  {
+    if (!(hdr = idata->msn_index[msn - 1]))
+      continue;
+    if (HEADER_DATA(hdr)->uid <= lastuid)
+    {
+      dprint (1, (debugfile, "imap_read_headers: helper connections disagree "
+                  "about message %u, discarding their headers\n", msn));
+      fetch_slices_discard (idata, slices[1].msn_first, msn_end);
+      break;
+    }
+    lastuid = HEADER_DATA(hdr)->uid;
+  }
+
+  for (msn = msn_begin; msn <= msn_end; msn++)
+  {
+    if (!(hdr = idata->msn_index[msn - 1]))
+      continue;
+    hdr->index = ctx->msgcount;
+    ctx->hdrs[ctx->msgcount++] = hdr;
+  }
+
+  retval = 0;
+  goto bail;
+
+fail:
+  fetch_slices_discard (idata, msn_begin, msn_end);
+
+bail:
+  for (i = 1; i < nslices; i++)
+    if (slices[i].idata)
+      fetch_helper_close (slices[i].idata);
+  mutt_buffer_pool_release (&b);
+  FREE (&conns);
+  FREE (&slices);
+
+  return retval;
+}
+
 /* Retrieve new messages from the server
  */
 static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
@@ -833,8 +1275,9 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
                                    unsigned int *maxuid, int initial_download)
 {
   CONTEXT* ctx;
-  int idx, msgno, rc, mfhrc = 0, retval = -1;
-  unsigned int fetch_msn_end = 0;
+  HEADER *hdr;
+  int idx, msgno, rc, mfhrc = 0, retval = -1, split = 0, split_idx = 0;
+  unsigned int fetch_msn_end = 0, split_msn_begin = msn_begin, msn;
   progress_t progress;
   char *hdrreq = NULL, *cmd;
   BUFFER *tempfile = NULL;
@@ -844,7 +1287,6 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
   static const char * const want_headers = "DATE FROM SENDER SUBJECT TO CC MESSAGE-ID REFERENCES CONTENT-TYPE CONTENT-DESCRIPTION IN-REPLY-TO REPLY-TO LINES LIST-POST X-LABEL";
 
   ctx = idata->ctx;
-  idx = ctx->msgcount;
 
   hdr_list = mutt_buffer_pool_get ();
   mutt_buffer_strcpy (hdr_list, want_headers);
@@ -897,6 +1339,31 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
     mutt_progress_init (&progress, _("Fetching message headers..."),
                         MUTT_PROGRESS_MSG, ReadInc, msn_end);
 
+  /* Split a large initial download between several connections.
+   * Only a contiguous range of messages missing from the header cache
+   * is split; the serial loop below picks up anything left over. */
+  if (initial_download && ImapFetchConnections > 0)
+  {
+    for (msn = msn_begin; msn <= msn_end; msn++)
+      if (idata->msn_index[msn - 1])
+        break;
+    if (msn > msn_end)
+    {
+      split_idx = ctx->msgcount;
+      rc = read_headers_fetch_parallel (idata, msn_begin, msn_end, hdrreq, fp,
+                                        &progress, maxuid);
+      if (rc < 0)
+        goto bail;
+      if (rc == 0)
+      {
+        split = 1;
+        evalhc = 1;
+        read_headers_grow_for_new_mail (idata, &msn_end);
+      }
+    }
+  }
+
+  idx = ctx->msgcount;
   b = mutt_buffer_pool_get ();
 
   /* NOTE:
@@ -942,71 +1409,16 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
         if (rc != IMAP_CMD_CONTINUE)
           break;
 
-        if ((mfhrc = msg_fetch_header (ctx, &h, idata->buf, fp)) < 0)
+        if ((mfhrc = msg_fetch_header (idata, &h, idata->buf, fp)) < 0)
           continue;
 
-        if (!ftello (fp))
-        {
-          dprint (2, (debugfile, "msg_fetch_header: ignoring fetch response with no body\n"));
+        if (!(hdr = read_headers_new_header (idata, &h, fp, 1, fetch_msn_end,
+                                             maxuid)))
           continue;
-        }
-
-        /* make sure we don't get remnants from older larger message headers */
-        fputs ("\n\n", fp);
-
-        if (h.data->msn < 1 || h.data->msn > fetch_msn_end)
-        {
-          dprint (1, (debugfile, "imap_read_headers: skipping FETCH response for "
-                      "unknown message number %d\n", h.data->msn));
-          continue;
-        }
-
-        /* May receive FLAGS updates in a separate untagged response (#2935) */
-        if (idata->msn_index[h.data->msn - 1])
-        {
-          dprint (2, (debugfile, "imap_read_headers: skipping FETCH response for "
-                      "duplicate message %d\n", h.data->msn));
-          continue;
-        }
-
-        ctx->hdrs[idx] = mutt_new_header ();
-
-        idata->max_msn = MAX (idata->max_msn, h.data->msn);
-        idata->msn_index[h.data->msn - 1] = ctx->hdrs[idx];
-        int_hash_insert (idata->uid_hash, h.data->uid, ctx->hdrs[idx]);
-
-        ctx->hdrs[idx]->index = idx;
-        /* messages which have not been expunged are ACTIVE (borrowed from mh
-         * folders) */
-        ctx->hdrs[idx]->active = 1;
-        ctx->hdrs[idx]->changed = 0;
-        ctx->hdrs[idx]->read = h.data->read;
-        ctx->hdrs[idx]->old = h.data->old;
-        ctx->hdrs[idx]->deleted = h.data->deleted;
-        ctx->hdrs[idx]->flagged = h.data->flagged;
-        ctx->hdrs[idx]->replied = h.data->replied;
-        ctx->hdrs[idx]->received = h.received;
-        ctx->hdrs[idx]->data = (void *) (h.data);
-
-        if (*maxuid < h.data->uid)
-          *maxuid = h.data->uid;
-
-        rewind (fp);
-        /* NOTE: if Date: header is missing, mutt_read_rfc822_header depends
-         *   on h.received being set */
-        ctx->hdrs[idx]->env = mutt_read_rfc822_header (fp, ctx->hdrs[idx],
-                                                       0, 0);
-        /* content built as a side-effect of mutt_read_rfc822_header */
-        ctx->hdrs[idx]->content->length = h.content_length;
-        ctx->size += h.content_length;
-
-#if USE_HCACHE
-        imap_hcache_put (idata, ctx->hdrs[idx]);
-#endif /* USE_HCACHE */
 
+        hdr->index = idx;
+        ctx->hdrs[idx] = hdr;
         ctx->msgcount++;
-
-        h.data = NULL;
         idx++;
       }
       while (mfhrc == -1);
@@ -1018,15 +1430,7 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
     }
 
     /* In case we get new mail while fetching the headers. */
-    if (idata->reopen & IMAP_NEWMAIL_PENDING)
-    {
-      msn_end = idata->newMailCount;
-      while (msn_end > ctx->hdrmax)
-        mx_alloc_memory (ctx);
-      imap_alloc_msn_index (idata, msn_end);
-      idata->reopen &= ~IMAP_NEWMAIL_PENDING;
-      idata->newMailCount = 0;
-    }
+    read_headers_grow_for_new_mail (idata, &msn_end);
 
     /* Note: RFC3501 section 7.4.1 and RFC7162 section 3.2.10.2 say we
      * must not get any EXPUNGE/VANISHED responses in the middle of a
@@ -1041,6 +1445,20 @@ static int read_headers_fetch_new (IMAP_DATA *idata, unsigned int msn_begin,
     msn_begin = fetch_msn_end + 1;
   }
 
+  /* The serial loop appended whatever the split download left behind
+   * after the split download's headers.  Put them back in message
+   * number order. */
+  if (split)
+  {
+    idx = split_idx;
+    for (msn = split_msn_begin; msn <= msn_end; msn++)
+      if ((hdr = idata->msn_index[msn - 1]))
+      {
+        hdr->index = idx;
+        ctx->hdrs[idx++] = hdr;
+      }
+  }
+
   retval = 0;
 
 bail:
@@ -1847,15 +2265,12 @@ char* imap_set_flags (IMAP_DATA* idata, HEADER* h, char* s, int *server_changes)
  *      0 on success
  *     -1 if the string is not a fetch response
  *     -2 if the string is a corrupt fetch response */
-static int msg_fetch_header (CONTEXT* ctx, IMAP_HEADER* h, char* buf, FILE* fp)
+static int msg_fetch_header (IMAP_DATA* idata, IMAP_HEADER* h, char* buf, FILE* fp)
 {
-  IMAP_DATA* idata;
   unsigned int bytes;
   int rc = -1; /* default now is that string isn't FETCH response*/
   int parse_rc;
 
-  idata = (IMAP_DATA*) ctx->data;
-
   if (buf[0] != '*')
     return rc;
 
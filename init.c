@@ -43,6 +43,10 @@
 #include "init.h"
 #include "mailbox.h"
 
+#ifdef USE_SIDEBAR
+#include "sidebar.h"
+#endif
+
 #include <ctype.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -436,6 +440,7 @@ void mutt_free_opts (void)
   mutt_free_rx_list (&SubscribedLists);
   mutt_free_rx_list (&UnSubscribedLists);
   mutt_free_rx_list (&NoSpamList);
+  mutt_reset_spam_matcher ();
 }
 
 static void add_to_list (LIST **list, const char *str)
@@ -717,6 +722,8 @@ static mbchar_table *parse_mbchar_table (const char *s)
 
 static int parse_unignore (BUFFER *buf, BUFFER *s, union pointer_long_t udata, BUFFER *err)
 {
+  mutt_reset_ignore_cache ();
+
   do
   {
     mutt_extract_token (buf, s, 0);
@@ -734,6 +741,8 @@ static int parse_unignore (BUFFER *buf, BUFFER *s, union pointer_long_t udata, B
 
 static int parse_ignore (BUFFER *buf, BUFFER *s, union pointer_long_t udata, BUFFER *err)
 {
+  mutt_reset_ignore_cache ();
+
   do
   {
     mutt_extract_token (buf, s, 0);
@@ -941,6 +950,9 @@ static int parse_spam_list (BUFFER *buf, BUFFER *s, union pointer_long_t udata,
   /* Extract the first token, a regexp */
   mutt_extract_token (buf, s, 0);
 
+  /* the lists are about to change under the compiled matcher */
+  mutt_reset_spam_matcher ();
+
   /* data should be either MUTT_SPAM or MUTT_NOSPAM. MUTT_SPAM is for spam commands. */
   if (data == MUTT_SPAM)
   {
@@ -1971,7 +1983,10 @@ static void mutt_restore_default (struct option_t *p)
     mutt_reflow_windows ();
 #ifdef USE_SIDEBAR
   if (p->flags & R_SIDEBAR)
+  {
+    mutt_sb_invalidate ();
     mutt_set_current_menu_redraw (REDRAW_SIDEBAR);
+  }
 #endif
   if (p->flags & R_MENU)
     mutt_set_current_menu_redraw_full ();
@@ -2861,7 +2876,10 @@ static int parse_set (BUFFER *tmp, BUFFER *s, union pointer_long_t udata, BUFFER
         mutt_reflow_windows ();
 #ifdef USE_SIDEBAR
       if (MuttVars[idx].flags & R_SIDEBAR)
+      {
+        mutt_sb_invalidate ();
         mutt_set_current_menu_redraw (REDRAW_SIDEBAR);
+      }
 #endif
       if (MuttVars[idx].flags & R_MENU)
         mutt_set_current_menu_redraw_full ();
@@ -497,6 +497,17 @@ struct option_t MuttVars[] = {
   ** .pp
   ** Also see $$fast_reply.
   */
+  { "autoview_jobs",	DT_NUM,  R_NONE, {.p=&AutoviewJobs}, {.l=1} },
+  /*
+  ** .pp
+  ** This variable controls how many ``$auto_view'' commands for the parts
+  ** of a multipart message may run at the same time.  When it is greater
+  ** than 1, the commands for the following parts are started while
+  ** earlier parts are still being displayed, so that messages with several
+  ** large autoviewed parts are ready sooner.  The output still appears in
+  ** the order of the parts.  The default of 1 runs each command only when
+  ** its part is reached.
+  */
   { "background_edit",  DT_BOOL, R_NONE, {.l=OPTBACKGROUNDEDIT}, {.l=0} },
   /*
   ** .pp
@@ -1683,6 +1694,15 @@ struct option_t MuttVars[] = {
   ** In general a good compression efficiency can be achieved, which
   ** speeds up reading large mailboxes also on fairly good connections.
   */
+  { "imap_deflate_buffer_size",	DT_LNUM, R_NONE, {.p=&ImapDeflateBufferSize}, {.l=65536} },
+  /*
+  ** .pp
+  ** The size in bytes of the buffers used to compress and decompress
+  ** data when $$imap_deflate is in effect.  Larger buffers mean fewer,
+  ** larger reads and writes on the underlying connection.  Values
+  ** below 8192 are treated as 8192.  Changes only affect connections
+  ** opened afterwards.
+  */
 #endif
   { "imap_delim_chars",		DT_STR, R_NONE, {.p=&ImapDelimChars}, {.p="/."} },
   /*
@@ -1701,6 +1721,22 @@ struct option_t MuttVars[] = {
   ** of this many headers, instead of a single FETCH for all new
   ** headers.
   */
+  { "imap_fetch_connections",	DT_NUM, R_NONE, {.p=&ImapFetchConnections}, {.l=0} },
+  /*
+  ** .pp
+  ** When set to a value greater than 0, Mutt opens up to this many
+  ** additional read-only connections to the server when downloading
+  ** the headers of a mailbox for the first time.  The range of messages
+  ** is split between the connections, which fetch their share at the
+  ** same time.  This can make opening a very large mailbox over a
+  ** high-latency link much faster, at the cost of extra server sessions.
+  ** The extra connections are kept open afterwards and reused like any
+  ** other connection.
+  ** .pp
+  ** Messages already present in the header cache are not fetched this
+  ** way.  If the mailbox changes while the connections are being set up,
+  ** Mutt falls back to a normal download.
+  */
   { "imap_headers",	DT_STR, R_INDEX, {.p=&ImapHeaders}, {.p=0} },
   /*
   ** .pp
@@ -1921,6 +1957,8 @@ struct option_t MuttVars[] = {
   **            stashed the message: list name or recipient name
   **            if not sent to a list
   ** .dt %P .dd progress indicator for the built-in pager (how much of the file has been displayed)
+  ** .dt %Q .dd number of the search match last jumped to in the built-in pager and the total,
+  **            e.g. ``3/17'', while search matches are highlighted
   ** .dt %r .dd comma separated list of ``To:'' recipients
   ** .dt %R .dd comma separated list of ``Cc:'' recipients
   ** .dt %s .dd subject of the message
@@ -2405,7 +2443,7 @@ struct option_t MuttVars[] = {
   ** results. If positive, this many lines will be given before a match,
   ** if 0, the match will be top-aligned.
   */
-  { "pager_format",	DT_STR,	 R_PAGER, {.p=&PagerFmt}, {.p="-%Z- %C/%m: %-20.20n   %s%*  -- (%P)"} },
+  { "pager_format",	DT_STR,	 R_PAGER, {.p=&PagerFmt}, {.p="-%Z- %C/%m: %-20.20n   %s%*  -- (%P%?Q? [%Q]?)"} },
   /*
   ** .pp
   ** This variable controls the format of the one-line message ``status''
@@ -2444,6 +2482,17 @@ struct option_t MuttVars[] = {
   ** when you are at the end of a message and invoke the \fC<next-page>\fP
   ** function.
   */
+  { "pager_stream",	DT_BOOL, R_NONE, {.l=OPTPAGERSTREAM}, {.l=0} },
+  /*
+  ** .pp
+  ** When \fIset\fP, the internal pager displays a message while it is
+  ** still being decoded, converted and run through $$auto_view
+  ** commands, so that the first screen of a long message is shown
+  ** without waiting for its last part.  The rest appears as it becomes
+  ** available.  Messages which are signed or encrypted, and messages
+  ** shown through $$display_filter, are always decoded in full first.
+  ** Also see $$autoview_jobs.
+  */
   { "pattern_format", DT_STR, R_NONE, {.p=&PatternFormat}, {.p="%2n %-15e  %d"} },
   /*
   ** .pp
@@ -4043,6 +4092,18 @@ struct option_t MuttVars[] = {
   ** set smtp_authenticators="digest-md5:cram-md5"
   ** .te
   */
+  { "smtp_idle_timeout",	DT_NUM, R_NONE, {.p=&SmtpIdleTimeout}, {.l=0} },
+  /*
+  ** .pp
+  ** When set to a value greater than 0, Mutt keeps the connection to
+  ** the SMTP server open after sending a message, and reuses it for the
+  ** next message sent within this many seconds.  This saves the
+  ** connection setup and authentication when sending, bouncing or
+  ** resending several messages in a row.  An idle connection is closed
+  ** when it is found to be too old, when the server closes it, or when
+  ** Mutt exits.
+  ** See $$smtp_url to configure mutt to send mail via SMTP.
+  */
   { "smtp_oauth_refresh_command", DT_STR, R_NONE, {.p=&SmtpOauthRefreshCmd}, {.p=0} },
   /*
   ** .pp
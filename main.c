@@ -1394,6 +1394,9 @@ cleanup_and_exit:
 #ifdef USE_IMAP
   imap_logout_all ();
 #endif
+#ifdef USE_SMTP
+  mutt_smtp_logout ();
+#endif
 #ifdef USE_SASL
   mutt_sasl_done ();
 #endif
@@ -1404,6 +1407,7 @@ cleanup_and_exit:
   mutt_commands_cleanup ();
   crypt_cleanup ();
   mutt_signal_cleanup ();
+  mutt_iconv_cache_flush ();
   mutt_free_opts ();
   mutt_free_windows ();
   mutt_buffer_pool_free ();
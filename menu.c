@@ -230,6 +230,9 @@ void menu_redraw_full (MUTTMENU *menu)
   /* clear() doesn't optimize screen redraws */
   move (0, 0);
   clrtobot ();
+#ifdef USE_SIDEBAR
+  mutt_sb_invalidate ();
+#endif
 
   if (option (OPTHELP))
   {
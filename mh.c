@@ -2216,13 +2216,83 @@ static int maildir_update_flags (CONTEXT *ctx, HEADER *o, HEADER *n)
  * either subdirectory differently, as mail could be copied directly into
  * the cur directory from another agent.
  */
+#ifdef USE_INOTIFY
+/* Queues the messages named by the monitor's events, "new/..." or
+ * "cur/...", much as maildir_parse_dir() queues a whole subdirectory.
+ * The canonical names of files that no longer exist are put in `gone'. */
+static void maildir_parse_events (CONTEXT *ctx, struct maildir ***last,
+                                  LIST *events, int *count, HASH *gone)
+{
+  BUFFER *buf = NULL, *canon = NULL;
+  HASH *seen;
+  LIST *ev;
+  struct maildir *entry;
+  struct stat st;
+  const char *name;
+  HEADER *h;
+
+  buf = mutt_buffer_pool_get ();
+  canon = mutt_buffer_pool_get ();
+  seen = hash_create (64, MUTT_HASH_STRDUP_KEYS);
+
+  /* a file may come and go more than once, only its last state matters */
+  for (ev = events; ev; ev = ev->next)
+  {
+    name = strrchr (ev->data, '/') + 1;
+    if (*name == '.')
+      continue;
+
+    maildir_canon_filename (canon, ev->data);
+    if (hash_find (seen, ev->data))
+      continue;
+    hash_insert (seen, ev->data, ev);
+
+    mutt_buffer_printf (buf, "%s/%s", ctx->path, ev->data);
+    if (stat (mutt_b2s (buf), &st) == -1)
+    {
+      if (!hash_find (gone, mutt_b2s (canon)))
+        hash_insert (gone, mutt_b2s (canon), ev);
+      continue;
+    }
+
+    /* a flag change renames the file, so several existing names can't
+     * share a canonical name, but check anyway */
+    if (hash_find (seen, mutt_b2s (canon)))
+      continue;
+    hash_insert (seen, mutt_b2s (canon), ev);
+
+    dprint (2, (debugfile, "%s:%d: queueing %s from monitor event\n",
+                __FILE__, __LINE__, ev->data));
+
+    h = mutt_new_header ();
+    h->old = (mutt_strncmp ("cur/", ev->data, 4) == 0);
+    maildir_parse_flags (h, name);
+    h->path = safe_strdup (ev->data);
+    (*count)++;
+
+    entry = safe_calloc (sizeof (struct maildir), 1);
+    entry->h = h;
+#ifdef HAVE_DIRENT_D_INO
+    entry->inode = st.st_ino;
+#endif /* HAVE_DIRENT_D_INO */
+    **last = entry;
+    *last = &entry->next;
+  }
+
+  hash_destroy (&seen, NULL);
+  mutt_buffer_pool_release (&buf);
+  mutt_buffer_pool_release (&canon);
+}
+#endif
+
 static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
 {
   struct stat st_new;		/* status of the "new" subdirectory */
   struct stat st_cur;		/* status of the "cur" subdirectory */
   BUFFER *buf = NULL;
   int changed = 0;		/* bitmask representing which subdirectories
-				   have changed.  0x1 = new, 0x2 = cur */
+				   have changed.  0x1 = new, 0x2 = cur,
+				   0x4 = only the files in monitor events */
   int occult = 0;		/* messages were removed from the mailbox */
   int have_new = 0;		/* messages were added to the mailbox */
   int flags_changed = 0;        /* message flags were changed in the mailbox */
@@ -2233,6 +2303,11 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
   HASH *fnames;			/* hash table for quickly looking up the base filename
 				   for a maildir message */
   struct mh_data *data = mh_data (ctx);
+#ifdef USE_INOTIFY
+  LIST *events = NULL;
+  HASH *gone = NULL;		/* canonical names of removed files */
+  int events_rc;
+#endif
 
   /* XXX seems like this check belongs in mx_check_mailbox()
    * rather than here.
@@ -2240,10 +2315,24 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
   if (!option (OPTCHECKNEW))
     return 0;
 
+#ifdef USE_INOTIFY
+  /* The monitor's events belong to Context; other mailboxes, such as a
+   * maildir $postponed, are checked by mtime alone.  The events are
+   * taken before the stat() calls below, so a file created in between
+   * is either seen by them or left queued for the next check. */
+  if (ctx == Context)
+    events_rc = mutt_monitor_take_events (&events);
+  else
+    events_rc = MUTT_MONITOR_EVENTS_NONE;
+#endif
+
   buf = mutt_buffer_pool_get ();
   mutt_buffer_printf (buf, "%s/new", ctx->path);
   if (stat (mutt_b2s (buf), &st_new) == -1)
   {
+#ifdef USE_INOTIFY
+    mutt_free_list (&events);
+#endif
     mutt_buffer_pool_release (&buf);
     return -1;
   }
@@ -2251,6 +2340,9 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
   mutt_buffer_printf (buf, "%s/cur", ctx->path);
   if (stat (mutt_b2s (buf), &st_cur) == -1)
   {
+#ifdef USE_INOTIFY
+    mutt_free_list (&events);
+#endif
     mutt_buffer_pool_release (&buf);
     return -1;
   }
@@ -2261,6 +2353,20 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
   if (mutt_stat_timespec_compare (&st_cur, MUTT_STAT_MTIME, &data->mtime_cur) > 0)
     changed |= 2;
 
+#ifdef USE_INOTIFY
+  /* With both subdirectories watched since the last check, the monitor
+   * knows exactly which files changed, so only those are looked at. */
+  if (events_rc == MUTT_MONITOR_EVENTS_OK)
+  {
+    changed = events ? 4 : 0;
+    MonitorContextChanged = 0;
+    mutt_get_stat_timespec (&data->mtime_cur, &st_cur, MUTT_STAT_MTIME);
+    mutt_get_stat_timespec (&ctx->mtime, &st_new, MUTT_STAT_MTIME);
+  }
+  else if (events_rc == MUTT_MONITOR_EVENTS_LOST)
+    changed = 3;
+#endif
+
   if (!changed)
   {
     mutt_buffer_pool_release (&buf);
@@ -2274,7 +2380,9 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
    * noticed during the SAME group of mtime stat updates.  To work around
    * the problem, don't update the stat times for a monitor caused check. */
 #ifdef USE_INOTIFY
-  if (MonitorContextChanged)
+  if (events_rc == MUTT_MONITOR_EVENTS_OK)
+    ;
+  else if (MonitorContextChanged)
     MonitorContextChanged = 0;
   else
 #endif
@@ -2292,6 +2400,14 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
     maildir_parse_dir (ctx, &last, "new", &count, NULL);
   if (changed & 2)
     maildir_parse_dir (ctx, &last, "cur", &count, NULL);
+#ifdef USE_INOTIFY
+  if (changed & 4)
+  {
+    gone = hash_create (64, MUTT_HASH_STRDUP_KEYS);
+    maildir_parse_events (ctx, &last, events, &count, gone);
+    mutt_free_list (&events);
+  }
+#endif
 
   /* we create a hash table keyed off the canonical (sans flags) filename
    * of each message we scanned.  This is used in the loop over the
@@ -2346,7 +2462,11 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
      * message has disappeared out from underneath us.
      */
     else if (((changed & 1) && (!strncmp (ctx->hdrs[i]->path, "new/", 4))) ||
-	     ((changed & 2) && (!strncmp (ctx->hdrs[i]->path, "cur/", 4))))
+	     ((changed & 2) && (!strncmp (ctx->hdrs[i]->path, "cur/", 4)))
+#ifdef USE_INOTIFY
+             || (gone && hash_find (gone, mutt_b2s (buf)))
+#endif
+             )
     {
       /* This message disappeared, so we need to simulate a "reopen"
        * event.  We know it disappeared because we just scanned the
@@ -2366,6 +2486,9 @@ static int maildir_check_mailbox (CONTEXT * ctx, int *index_hint)
 
   /* destroy the file name hash */
   hash_destroy (&fnames, NULL);
+#ifdef USE_INOTIFY
+  hash_destroy (&gone, NULL);
+#endif
 
   /* If we didn't just get new mail, update the tables. */
   if (occult)
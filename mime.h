@@ -68,6 +68,29 @@ extern const char B64Chars[];
 #define hexval(c) Index_hex[(unsigned int)(c)]
 #define base64val(c) Index_64[(unsigned int)(c)]
 
+/* state for the block base64 codec in base64.c */
+typedef struct
+{
+  unsigned char carry[3];	/* bytes of an incomplete group */
+  int ncarry;
+  int linelen;
+} B64_ENCODER;
+
+typedef struct
+{
+  unsigned int bits;
+  int nbits;			/* sextets collected in bits */
+  int done;			/* padding seen */
+} B64_DECODER;
+
+/* output space needed by mutt_b64_encode_block() for len input bytes */
+#define B64_ENCODE_SIZE(len) \
+  ((((len) / 3 + 2) * 4) + ((len) / 3 + 2) / 18 + 2)
+
+size_t mutt_b64_encode_block (B64_ENCODER *, char *, const unsigned char *, size_t);
+size_t mutt_b64_encode_finish (B64_ENCODER *, char *);
+size_t mutt_b64_decode_block (B64_DECODER *, char *, const char *, size_t);
+
 #define is_multipart(x)                                                 \
   ((x)->type == TYPEMULTIPART  ||                                       \
   ((x)->type == TYPEMESSAGE &&                                          \
@@ -34,6 +34,9 @@
 #include "monitor.h"
 #include "mx.h"
 #include "mutt_curses.h"
+#ifdef USE_SOCKET
+#include "mutt_socket.h"
+#endif
 
 #include <errno.h>
 #include <sys/stat.h>
@@ -56,6 +59,22 @@ static size_t PollFdsLen = 0;
 static struct pollfd *PollFds;
 
 static int MonitorContextDescriptor = -1;
+/* the open maildir's cur subdirectory, which buffy doesn't watch */
+static int MonitorContextCurDescriptor = -1;
+
+/* Names ("new/..." or "cur/...") of the files created, moved or deleted
+ * in the open maildir since the last mutt_monitor_take_events(). */
+static LIST *ContextEvents = NULL;
+static LIST **ContextEventsTail = &ContextEvents;
+static int ContextEventCount = 0;
+static int ContextEventState = MUTT_MONITOR_EVENTS_NONE;
+
+/* events for other mailboxes were read outside mutt_monitor_poll() and
+ * are still to be reported by it */
+static int MonitorFilesPending = 0;
+
+/* more names than this and a rescan is cheaper anyway */
+#define CONTEXT_EVENTS_MAX 16384
 
 typedef struct monitorinfo_t
 {
@@ -71,6 +90,9 @@ MONITORINFO;
 
 #define INOTIFY_MASK_DIR  (IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE | IN_ISDIR)
 #define INOTIFY_MASK_FILE IN_CLOSE_WRITE
+/* the open maildir's new and cur also report files going away */
+#define INOTIFY_MASK_CONTEXT_DIR (INOTIFY_MASK_DIR | IN_CREATE | IN_DELETE | \
+                                  IN_MOVED_FROM)
 
 static void mutt_poll_fd_add(int fd, short events)
 {
@@ -140,9 +162,76 @@ static void monitor_check_free ()
     close (INotifyFd);
     INotifyFd = -1;
     MonitorFilesChanged = 0;
+    MonitorFilesPending = 0;
+    MonitorContextCurDescriptor = -1;
   }
 }
 
+static void monitor_clear_context_events (void)
+{
+  mutt_free_list (&ContextEvents);
+  ContextEventsTail = &ContextEvents;
+  ContextEventCount = 0;
+}
+
+static void monitor_add_context_event (const char *subdir,
+                                       const struct inotify_event *event)
+{
+  LIST *item;
+
+  if (!event->len || (event->mask & IN_ISDIR) ||
+      ContextEventState == MUTT_MONITOR_EVENTS_LOST)
+    return;
+
+  if (ContextEventCount >= CONTEXT_EVENTS_MAX)
+  {
+    dprint (2, (debugfile, "monitor: too many events for the open mailbox\n"));
+    monitor_clear_context_events ();
+    ContextEventState = MUTT_MONITOR_EVENTS_LOST;
+    return;
+  }
+
+  item = mutt_new_list ();
+  item->data = safe_malloc (strlen (subdir) + strlen (event->name) + 2);
+  sprintf (item->data, "%s/%s", subdir, event->name);	/* __SPRINTF_CHECKED__ */
+  *ContextEventsTail = item;
+  ContextEventsTail = &item->next;
+  ContextEventCount++;
+}
+
+static void monitor_add_context_cur (const char *path)
+{
+  BUFFER *cur;
+
+  if (MonitorContextCurDescriptor != -1)
+    return;
+
+  cur = mutt_buffer_pool_get ();
+  mutt_buffer_printf (cur, "%s/cur", path);
+  if ((MonitorContextCurDescriptor = inotify_add_watch (INotifyFd, mutt_b2s (cur),
+                                                        INOTIFY_MASK_CONTEXT_DIR)) == -1)
+    dprint (2, (debugfile, "monitor: inotify_add_watch failed for '%s', errno=%d %s\n", mutt_b2s (cur), errno, strerror(errno)));
+  else
+    dprint (3, (debugfile, "monitor: inotify_add_watch descriptor=%d for '%s'\n", MonitorContextCurDescriptor, mutt_b2s (cur)));
+  mutt_buffer_pool_release (&cur);
+
+  monitor_clear_context_events ();
+  ContextEventState = MUTT_MONITOR_EVENTS_NONE;
+}
+
+static void monitor_remove_context_cur (void)
+{
+  if (MonitorContextCurDescriptor != -1)
+  {
+    if (INotifyFd != -1)
+      inotify_rm_watch (INotifyFd, MonitorContextCurDescriptor);
+    dprint (3, (debugfile, "monitor: inotify_rm_watch descriptor=%d\n", MonitorContextCurDescriptor));
+    MonitorContextCurDescriptor = -1;
+  }
+  monitor_clear_context_events ();
+  ContextEventState = MUTT_MONITOR_EVENTS_NONE;
+}
+
 static MONITOR *monitor_create (MONITORINFO *info, int descriptor)
 {
   MONITOR *monitor = (MONITOR *) safe_calloc (1, sizeof (MONITOR));
@@ -234,6 +323,99 @@ static int monitor_handle_ignore (int descr)
 
 #define EVENT_BUFLEN MAX(4096, sizeof(struct inotify_event) + NAME_MAX + 1)
 
+/* Reads the pending inotify events. */
+static void monitor_read_events (void)
+{
+  char buf[EVENT_BUFLEN]
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  int len;
+  char *ptr;
+  const struct inotify_event *event;
+
+  FOREVER
+  {
+    len = read (INotifyFd, buf, sizeof(buf));
+    if (len == -1)
+    {
+      if (errno != EAGAIN)
+        dprint (2, (debugfile, "monitor: read inotify events failed, errno=%d %s\n",
+                    errno, strerror(errno)));
+      break;
+    }
+
+    for (ptr = buf; ptr < buf + len;
+         ptr += sizeof(struct inotify_event) + event->len)
+    {
+      event = (const struct inotify_event *) ptr;
+      dprint (5, (debugfile, "monitor:  + detail: descriptor=%d mask=0x%x\n",
+                  event->wd, event->mask));
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        dprint (2, (debugfile, "monitor: inotify queue overflow\n"));
+        monitor_clear_context_events ();
+        ContextEventState = MUTT_MONITOR_EVENTS_LOST;
+        MonitorContextChanged = 1;
+        MonitorFilesPending = 1;
+      }
+      else if (event->mask & IN_IGNORED)
+      {
+        if (event->wd == MonitorContextCurDescriptor)
+          MonitorContextCurDescriptor = -1;
+        else
+        {
+          monitor_handle_ignore (event->wd);
+          MonitorFilesPending = 1;
+        }
+      }
+      else if (event->wd == MonitorContextDescriptor)
+      {
+        MonitorContextChanged = 1;
+        if (MonitorContextCurDescriptor != -1)
+          monitor_add_context_event ("new", event);
+      }
+      else if (event->wd == MonitorContextCurDescriptor)
+      {
+        MonitorContextChanged = 1;
+        monitor_add_context_event ("cur", event);
+      }
+      else
+        MonitorFilesPending = 1;
+    }
+  }
+}
+
+/* mutt_monitor_take_events: hands the names of the files changed in the
+ * open maildir since the last call to the caller, who frees them.
+ *
+ * return values:
+ *      MUTT_MONITOR_EVENTS_OK     *events lists every change (maybe none)
+ *      MUTT_MONITOR_EVENTS_LOST   changes were missed, rescan everything
+ *      MUTT_MONITOR_EVENTS_NONE   nothing is known, rely on mtimes
+ */
+int mutt_monitor_take_events (LIST **events)
+{
+  int rc;
+
+  *events = NULL;
+
+  if (INotifyFd == -1 || MonitorContextDescriptor == -1 ||
+      MonitorContextCurDescriptor == -1)
+    return MUTT_MONITOR_EVENTS_NONE;
+
+  monitor_read_events ();
+
+  rc = ContextEventState;
+  if (rc == MUTT_MONITOR_EVENTS_OK)
+  {
+    *events = ContextEvents;
+    ContextEvents = NULL;
+  }
+  monitor_clear_context_events ();
+  ContextEventState = MUTT_MONITOR_EVENTS_OK;
+
+  return rc;
+}
+
 /* mutt_monitor_poll: Waits for I/O ready file descriptors or signals.
  *
  * return values:
@@ -242,21 +424,35 @@ static int monitor_handle_ignore (int descr)
  *      -1   error (see errno)
  *       0   (1) input ready from STDIN, or (2) monitoring inactive -> no poll()
  * MonitorFilesChanged also reflects changes to monitored files.
+ * Changes to other mailboxes seen by mutt_monitor_take_events() are
+ * reported right away, as the events are gone from INotifyFd.
  *
- * Only STDIN and INotify file handles currently expected/supported.
- * More would ask for common infrastructur (sockets?).
+ * Only STDIN and INotify file handles are in PollFds.  Connections with
+ * a dispatch hook are waited on too and handled by the socket layer;
+ * changes reported by them count as monitor changes.
  */
 int mutt_monitor_poll (void)
 {
-  int rc = 0, fds, i, inputReady;
-  char buf[EVENT_BUFLEN]
-    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  int rc = 0, fds, i, inputReady, connChanged = 0;
 
   MonitorFilesChanged = 0;
 
+  if (MonitorFilesPending)
+  {
+    MonitorFilesPending = 0;
+    MonitorFilesChanged = 1;
+    dprint (3, (debugfile, "monitor: file change(s) detected earlier\n"));
+    return -2;
+  }
+
   if (INotifyFd != -1)
   {
-    fds = poll (PollFds, PollFdsLen, MuttGetchTimeout);
+#ifdef USE_SOCKET
+    fds = mutt_socket_wait_input (PollFds, PollFdsCount, MuttGetchTimeout,
+                                  &connChanged);
+#else
+    fds = poll (PollFds, PollFdsCount, MuttGetchTimeout);
+#endif
 
     if (fds == -1)
     {
@@ -282,40 +478,19 @@ int mutt_monitor_poll (void)
           {
             MonitorFilesChanged = 1;
             dprint (3, (debugfile, "monitor: file change(s) detected\n"));
-            int len;
-            char *ptr = buf;
-            const struct inotify_event *event;
-
-            FOREVER
-            {
-              len = read (INotifyFd, buf, sizeof(buf));
-              if (len == -1)
-              {
-                if (errno != EAGAIN)
-                  dprint (2, (debugfile, "monitor: read inotify events failed, errno=%d %s\n",
-                              errno, strerror(errno)));
-                break;
-              }
-
-              while (ptr < buf + len)
-              {
-                event = (const struct inotify_event *) ptr;
-                dprint (5, (debugfile, "monitor:  + detail: descriptor=%d mask=0x%x\n",
-                            event->wd, event->mask));
-                if (event->mask & IN_IGNORED)
-                  monitor_handle_ignore (event->wd);
-                else if (event->wd == MonitorContextDescriptor)
-                  MonitorContextChanged = 1;
-                ptr += sizeof(struct inotify_event) + event->len;
-              }
-            }
+            monitor_read_events ();
+            MonitorFilesPending = 0;
           }
         }
       }
       if (!inputReady)
-        rc = MonitorFilesChanged ? -2 : -3;
+        rc = (MonitorFilesChanged || connChanged) ? -2 : -3;
     }
   }
+#ifdef USE_SOCKET
+  else
+    rc = mutt_socket_wait_stdin (MuttGetchTimeout);
+#endif
 
   return rc;
 }
@@ -411,12 +586,24 @@ int mutt_monitor_add (BUFFY *buffy)
   if (descr != RESOLVERES_OK_NOTEXISTING)
   {
     if (!buffy && (descr == RESOLVERES_OK_EXISTING))
+    {
       MonitorContextDescriptor = info.monitor->descr;
+      if (info.magic == MUTT_MAILDIR)
+      {
+        /* widen the watch shared with buffy; the descriptor stays */
+        if (inotify_add_watch (INotifyFd, info.path, INOTIFY_MASK_CONTEXT_DIR) == -1)
+          dprint (2, (debugfile, "monitor: inotify_add_watch failed for '%s', errno=%d %s\n", info.path, errno, strerror(errno)));
+        monitor_add_context_cur (Context->realpath);
+      }
+    }
     rc = descr == RESOLVERES_OK_EXISTING ? 0 : -1;
     goto cleanup;
   }
 
-  mask = info.isdir ? INOTIFY_MASK_DIR : INOTIFY_MASK_FILE;
+  if (!buffy && info.magic == MUTT_MAILDIR)
+    mask = INOTIFY_MASK_CONTEXT_DIR;
+  else
+    mask = info.isdir ? INOTIFY_MASK_DIR : INOTIFY_MASK_FILE;
   if ((INotifyFd == -1 && monitor_init () == -1)
       || (descr = inotify_add_watch (INotifyFd, info.path, mask)) == -1)
   {
@@ -426,10 +613,13 @@ int mutt_monitor_add (BUFFY *buffy)
   }
 
   dprint (3, (debugfile, "monitor: inotify_add_watch descriptor=%d for '%s'\n", descr, info.path));
+  monitor_create (&info, descr);
   if (!buffy)
+  {
     MonitorContextDescriptor = descr;
-
-  monitor_create (&info, descr);
+    if (info.magic == MUTT_MAILDIR)
+      monitor_add_context_cur (Context->realpath);
+  }
 
 cleanup:
   monitor_info_free (&info);
@@ -455,6 +645,7 @@ int mutt_monitor_remove (BUFFY *buffy)
   {
     MonitorContextDescriptor = -1;
     MonitorContextChanged = 0;
+    monitor_remove_context_cur ();
   }
 
   if (monitor_resolve (&info, buffy) != RESOLVERES_OK_EXISTING)
@@ -478,6 +669,10 @@ int mutt_monitor_remove (BUFFY *buffy)
     {
       if (mutt_find_mailbox (Context->realpath))
       {
+        /* back to the mask buffy asked for */
+        if (info.magic == MUTT_MAILDIR &&
+            inotify_add_watch (INotifyFd, info.path, INOTIFY_MASK_DIR) == -1)
+          dprint (2, (debugfile, "monitor: inotify_add_watch failed for '%s', errno=%d %s\n", info.path, errno, strerror(errno)));
         rc = 1;
         goto cleanup;
       }
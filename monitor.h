@@ -28,4 +28,9 @@ int mutt_monitor_remove (BUFFY *b);
 #endif
 int mutt_monitor_poll (void);
 
+#define MUTT_MONITOR_EVENTS_NONE   0
+#define MUTT_MONITOR_EVENTS_OK     1
+#define MUTT_MONITOR_EVENTS_LOST  -1
+int mutt_monitor_take_events (LIST **events);
+
 #endif /* MONITOR_H */
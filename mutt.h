@@ -138,6 +138,9 @@ typedef struct
 /* flags for _mutt_system() */
 #define MUTT_DETACH_PROCESS	1	/* detach subprocess from group */
 
+/* flags for _mutt_create_filter_fd() */
+#define MUTT_FILTER_NEW_GROUP	1	/* run the command in its own process group */
+
 /* flags for mutt_get_stat_timespec */
 typedef enum
 {
@@ -507,6 +510,7 @@ enum
   OPTMIMETYPEQUERYFIRST,
   OPTNARROWTREE,
   OPTPAGERSTOP,
+  OPTPAGERSTREAM,
   OPTPIPEDECODE,
   OPTPIPEDECODEWEED,
   OPTPIPESPLIT,
@@ -687,6 +691,8 @@ void mutt_free_rx_list (RX_LIST **);
 void mutt_free_replace_list (REPLACE_LIST **);
 LIST *mutt_copy_list (LIST *);
 int mutt_matches_ignore (const char *, LIST *);
+int mutt_ignore_header (const char *);
+void mutt_reset_ignore_cache (void);
 
 /* add an element to a list */
 LIST *mutt_add_list (LIST *, const char *);
@@ -780,6 +786,11 @@ typedef struct content
   unsigned int from : 1;   /* has a line beginning with "From "? */
   unsigned int dot : 1;    /* has a line consisting of a single dot? */
   unsigned int cr : 1;     /* has CR, even when in a CRLF pair */
+
+  /* what the counts were taken from, see mutt_update_encoding() */
+  time_t mtime;
+  LOFF_T size;
+  char *charsets;          /* charset settings used for the conversion */
 } CONTENT;
 
 typedef struct body
@@ -147,6 +147,11 @@ typedef struct color_line
   regoff_t cached_rm_so;
   regoff_t cached_rm_eo;
 
+  char *literal;      /* text every match of rx contains, or NULL */
+  size_t literal_len;
+
+  unsigned int anchored : 1; /* matches start with literal */
+  unsigned int icase : 1;    /* rx was compiled with REG_ICASE */
   unsigned int stop_matching : 1; /* used by the pager for body patterns,
                                      to prevent the color from being retried
                                      once it fails. */
@@ -48,6 +48,7 @@
 #endif
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
 
 /* support for multiple socket connections */
 static CONNECTION *Connections = NULL;
@@ -174,6 +175,163 @@ int mutt_socket_poll (CONNECTION* conn, time_t wait_secs)
   return -1;
 }
 
+/* mutt_socket_select: wait until one of the nconns connections in conns
+ *   has data to read.  NULL and closed entries are skipped.
+ *   Returns: index into conns of a readable connection,
+ *            -1 if none became readable within wait_secs or SigInt is set,
+ *            -2 if select() failed (see errno) */
+int mutt_socket_select (CONNECTION **conns, int nconns, time_t wait_secs)
+{
+  fd_set rfds;
+  struct timeval tv;
+  time_t now, deadline;
+  int i, maxfd, rv;
+
+  deadline = time (NULL) + wait_secs;
+
+  FOREVER
+  {
+    maxfd = -1;
+    FD_ZERO (&rfds);
+
+    for (i = 0; i < nconns; i++)
+    {
+      if (!conns[i] || conns[i]->fd < 0)
+        continue;
+
+      /* data buffered by us, or inside the TLS/zlib layers, is
+       * invisible to select() */
+      if (mutt_socket_poll (conns[i], 0) != 0)
+        return i;
+
+      FD_SET (conns[i]->fd, &rfds);
+      maxfd = MAX (maxfd, conns[i]->fd);
+    }
+
+    now = time (NULL);
+    if (maxfd < 0 || now >= deadline)
+      return -1;
+
+    tv.tv_sec = deadline - now;
+    tv.tv_usec = 0;
+
+    rv = select (maxfd + 1, &rfds, NULL, NULL, &tv);
+    if (rv < 0 && errno != EINTR)
+      return -2;
+
+    if (SigInt)
+      return -1;
+  }
+}
+
+/* mutt_socket_wait_input: poll() the caller's fds together with every
+ * open connection that has a conn_dispatch hook, for up to timeout
+ * milliseconds (forever if negative).  Readable connections are
+ * dispatched before returning, so that e.g. IDLE notifications from
+ * several servers are consumed as they arrive.  revents is filled in
+ * for the caller's fds.
+ *
+ * Returns the number of the caller's fds that are ready, or -1 on error
+ * (see errno).  *changed is set if any dispatch reported changes. */
+int mutt_socket_wait_input (struct pollfd *fds, int nfds, int timeout, int *changed)
+{
+  static struct pollfd *pfds = NULL;
+  static CONNECTION **pconns = NULL;
+  static int pfdslen = 0;
+  CONNECTION *conn;
+  int i, n, nconns = 0, rc;
+
+  *changed = 0;
+
+  for (conn = Connections; conn; conn = conn->next)
+    if (conn->conn_dispatch && conn->fd >= 0)
+      nconns++;
+
+  if (nfds + nconns > pfdslen)
+  {
+    pfdslen = nfds + nconns + 4;
+    safe_realloc (&pfds, pfdslen * sizeof (struct pollfd));
+    safe_realloc (&pconns, pfdslen * sizeof (CONNECTION *));
+  }
+
+  memcpy (pfds, fds, nfds * sizeof (struct pollfd));
+  n = nfds;
+  for (conn = Connections; conn && n < nfds + nconns; conn = conn->next)
+  {
+    if (!conn->conn_dispatch || conn->fd < 0)
+      continue;
+
+    /* data already buffered above the fd won't wake poll() */
+    if (mutt_socket_poll (conn, 0) > 0)
+      timeout = 0;
+
+    pconns[n] = conn;
+    pfds[n].fd = conn->fd;
+    pfds[n].events = POLLIN;
+    pfds[n].revents = 0;
+    n++;
+  }
+
+  if (poll (pfds, n, timeout) < 0)
+    return -1;
+
+  rc = 0;
+  for (i = 0; i < nfds; i++)
+  {
+    fds[i].revents = pfds[i].revents;
+    if (fds[i].revents)
+      rc++;
+  }
+
+  for (; i < n; i++)
+  {
+    conn = pconns[i];
+    /* a previous dispatch may have closed or unhooked it */
+    if (!conn->conn_dispatch || conn->fd < 0)
+      continue;
+    if (!pfds[i].revents && mutt_socket_poll (conn, 0) <= 0)
+      continue;
+
+    dprint (4, (debugfile, "mutt_socket_wait_input: dispatching %s\n",
+                conn->account.host));
+    if (conn->conn_dispatch (conn) != 0)
+      *changed = 1;
+  }
+
+  return rc;
+}
+
+/* mutt_socket_wait_stdin: wait for keyboard input, dispatching watched
+ * connections in the meantime.  Return values follow mutt_monitor_poll():
+ *      -3   timeout
+ *      -2   a connection reported changes, no STDIN input
+ *      -1   error (see errno)
+ *       0   input ready from STDIN, or no watched connections -> no poll()
+ */
+int mutt_socket_wait_stdin (int timeout)
+{
+  struct pollfd pfd;
+  CONNECTION *conn;
+  int changed;
+
+  for (conn = Connections; conn; conn = conn->next)
+    if (conn->conn_dispatch && conn->fd >= 0)
+      break;
+  if (!conn)
+    return 0;
+
+  pfd.fd = 0;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  if (mutt_socket_wait_input (&pfd, 1, timeout, &changed) < 0)
+    return -1;
+  if (pfd.revents)
+    return 0;
+
+  return changed ? -2 : -3;
+}
+
 /* simple read buffering to speed things up. */
 int mutt_socket_readchar (CONNECTION *conn, char *c)
 {
@@ -59,13 +59,23 @@ typedef struct _connection
   int (*conn_open) (struct _connection *conn);
   int (*conn_close) (struct _connection *conn);
   int (*conn_poll) (struct _connection *conn, time_t wait_secs);
+
+  /* if set, mutt_socket_wait_input() watches this connection while
+   * waiting for keyboard input, and calls this to consume whatever
+   * arrived.  Returns >0 if the owner has changes to report. */
+  int (*conn_dispatch) (struct _connection *conn);
 } CONNECTION;
 
+struct pollfd;
+
 int mutt_socket_open (CONNECTION* conn);
 int mutt_socket_close (CONNECTION* conn);
 int mutt_socket_has_buffered_input (CONNECTION *conn);
 void mutt_socket_clear_buffered_input (CONNECTION *conn);
 int mutt_socket_poll (CONNECTION* conn, time_t wait_secs);
+int mutt_socket_select (CONNECTION **conns, int nconns, time_t wait_secs);
+int mutt_socket_wait_input (struct pollfd *fds, int nfds, int timeout, int *changed);
+int mutt_socket_wait_stdin (int timeout);
 int mutt_socket_readchar (CONNECTION *conn, char *c);
 #define mutt_socket_readln(A,B,C) mutt_socket_readln_d(A,B,C,MUTT_SOCK_LOG_CMD)
 int mutt_socket_readln_d (char *buf, size_t buflen, CONNECTION *conn, int dbg);
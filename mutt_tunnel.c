@@ -137,7 +137,8 @@ static int tunnel_socket_open (CONNECTION *conn)
   tunnel->writefd = pout[1];
   tunnel->pid = pid;
 
-  conn->fd = 42; /* stupid hack */
+  /* reads and select() use conn->fd, writes go through tunnel->writefd */
+  conn->fd = tunnel->readfd;
 
   return 0;
 }
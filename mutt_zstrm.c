@@ -36,6 +36,8 @@ typedef struct
     unsigned int pos;
     unsigned int conn_eof : 1;
     unsigned int stream_eof : 1;
+    unsigned int pending : 1;   /* write: deflated data not flushed yet */
+    unsigned long flushes;      /* write: number of flushes done */
   } read, write;
 
   /* underlying stream */
@@ -55,6 +57,67 @@ static void mutt_zstrm_free (void* op, void* ptr)
   FREE (&ptr);
 }
 
+/* push the deflated data in the write buffer to the underlying stream */
+static int zstrm_write_out (zstrmctx* zctx)
+{
+  char *wbufp = zctx->write.buf;
+  unsigned int pos = zctx->write.len - zctx->write.z.avail_out;
+  int rc;
+
+  while (pos > 0)
+  {
+    rc = zctx->next_conn.conn_write (&zctx->next_conn, wbufp, pos);
+    dprint (4, (debugfile, "zstrm_write: next stream wrote: %d bytes\n", rc));
+    if (rc < 0)
+      return -1;  /* we can't recover from write failure */
+
+    wbufp += rc;
+    pos -= rc;
+  }
+
+  zctx->write.z.avail_out = (uInt) zctx->write.len;
+  zctx->write.z.next_out = (Bytef*) zctx->write.buf;
+
+  return 0;
+}
+
+/* feed the pending input to deflate, writing out the output buffer
+ * whenever it fills up.  Unless flush is Z_NO_FLUSH, everything
+ * produced is written out as well. */
+static int zstrm_deflate (zstrmctx* zctx, int flush)
+{
+  int zrc;
+
+  do
+  {
+    if (zctx->write.z.avail_out == 0 && zstrm_write_out (zctx) < 0)
+      return -1;
+
+    zrc = deflate (&zctx->write.z, flush);
+    /* Z_BUF_ERROR just means there was nothing left to do */
+    if (zrc != Z_OK && zrc != Z_BUF_ERROR)
+    {
+      /* compression went wrong, but this is basically impossible
+       * according to the docs */
+      dprint (1, (debugfile, "zstrm_deflate: deflate returned %d\n", zrc));
+      return -1;
+    }
+  } while (zctx->write.z.avail_in > 0 || zctx->write.z.avail_out == 0);
+
+  if (flush != Z_NO_FLUSH)
+    return zstrm_write_out (zctx);
+
+  return 0;
+}
+
+static int zstrm_flush (zstrmctx* zctx)
+{
+  dprint (4, (debugfile, "zstrm_flush: flushing pending writes\n"));
+  zctx->write.pending = 0;
+  zctx->write.flushes++;
+  return zstrm_deflate (zctx, Z_PARTIAL_FLUSH);
+}
+
 static int mutt_zstrm_open (CONNECTION* conn)
 {
   /* cannot open a zlib connection, must wrap an existing one */
@@ -67,11 +130,12 @@ static int mutt_zstrm_close (CONNECTION* conn)
   int rc = zctx->next_conn.conn_close (&zctx->next_conn);
 
   dprint (4, (debugfile, "zstrm_close: read %llu->%llu (%.1fx) "
-	"wrote %llu<-%llu (%.1fx)\n",
+	"wrote %llu<-%llu (%.1fx) in %lu flushes\n",
 	zctx->read.z.total_in, zctx->read.z.total_out,
 	(float)zctx->read.z.total_out / (float)zctx->read.z.total_in,
 	zctx->write.z.total_in, zctx->write.z.total_out,
-	(float)zctx->write.z.total_in / (float)zctx->write.z.total_out));
+	(float)zctx->write.z.total_in / (float)zctx->write.z.total_out,
+	zctx->write.flushes));
 
   conn->sockdata   = zctx->next_conn.sockdata;
   conn->conn_open  = zctx->next_conn.conn_open;
@@ -105,6 +169,10 @@ retry:
    * might block) */
   if (zctx->read.pos == 0 && !zctx->read.conn_eof)
   {
+    /* the peer can't answer what it hasn't received */
+    if (zctx->write.pending && zstrm_flush (zctx) < 0)
+      return -1;
+
     rc = zctx->next_conn.conn_read (&zctx->next_conn,
 	zctx->read.buf, zctx->read.len);
     dprint (4, (debugfile, "zstrm_read: consuming data from next "
@@ -173,6 +241,9 @@ static int mutt_zstrm_poll (CONNECTION* conn, time_t wait_secs)
 {
   zstrmctx* zctx = conn->sockdata;
 
+  if (zctx->write.pending && zstrm_flush (zctx) < 0)
+    return -1;
+
   dprint (4, (debugfile, "zstrm_poll: %s\n",
 	zctx->read.z.avail_out == 0 || zctx->read.pos > 0 ?
 	"last read wrote full buffer" : "falling back on next stream"));
@@ -186,53 +257,16 @@ static int mutt_zstrm_write (CONNECTION* conn, const char* buf, size_t count)
 {
   zstrmctx* zctx = conn->sockdata;
   int rc;
-  int zrc;
-  char *wbufp;
 
   zctx->write.z.avail_in = (uInt) count;
   zctx->write.z.next_in = (Bytef*) buf;
-  zctx->write.z.avail_out = (uInt) zctx->write.len;
-  zctx->write.z.next_out = (Bytef*) zctx->write.buf;
-
-  do
-  {
-    zrc = deflate (&zctx->write.z, Z_PARTIAL_FLUSH);
-    if (zrc == Z_OK)
-    {
-      /* push out produced data to the underlying stream */
-      zctx->write.pos = zctx->write.len - zctx->write.z.avail_out;
-      wbufp = zctx->write.buf;
-      dprint (4, (debugfile, "zstrm_write: deflate consumed %d/%d bytes\n",
-	  count - zctx->write.z.avail_in, count));
-      while (zctx->write.pos > 0)
-      {
-	rc = zctx->next_conn.conn_write (&zctx->next_conn,
-	    wbufp, zctx->write.pos);
-	dprint (4, (debugfile, "zstrm_write: next stream wrote: %d bytes\n",
-	    rc));
-	if (rc < 0)
-	  return -1;  /* we can't recover from write failure */
-
-	wbufp += rc;
-	zctx->write.pos -= rc;
-      }
 
-      /* see if there's more for us to do, retry if the output buffer
-       * was full (there may be something in zlib buffers), and retry
-       * when there is still available input data */
-      if (zctx->write.z.avail_out != 0 && zctx->write.z.avail_in == 0)
-	break;
-
-      zctx->write.z.avail_out = (uInt) zctx->write.len;
-      zctx->write.z.next_out = (Bytef*) zctx->write.buf;
-    }
-    else
-    {
-      /* compression went wrong, but this is basically impossible
-       * according to the docs */
-      return -1;
-    }
-  } while (1);
+  /* Pipelined commands arrive as several writes.  Only compress them
+   * here; the flush happens once, when we next read from or poll the
+   * connection, or when the output buffer fills up. */
+  if (zstrm_deflate (zctx, Z_NO_FLUSH) < 0)
+    return -1;
+  zctx->write.pending = 1;
 
   rc = (int) count;
   return rc <= 0 ? 1 : rc;  /* avoid wrong behaviour due to overflow */
@@ -261,10 +295,10 @@ void mutt_zstrm_wrap_conn (CONNECTION* conn)
   conn->conn_poll  = mutt_zstrm_poll;
 
   /* allocate/setup (de)compression buffers */
-  zctx->read.len  = HUGE_STRING;
+  zctx->read.len  = MAX (ImapDeflateBufferSize, HUGE_STRING);
   zctx->read.buf  = safe_malloc (zctx->read.len);
   zctx->read.pos  = 0;
-  zctx->write.len = HUGE_STRING;
+  zctx->write.len = zctx->read.len;
   zctx->write.buf = safe_malloc (zctx->write.len);
   zctx->write.pos = 0;
 
@@ -278,6 +312,7 @@ void mutt_zstrm_wrap_conn (CONNECTION* conn)
   zctx->write.z.zfree  = mutt_zstrm_free;
   zctx->write.z.opaque = NULL;
   zctx->write.z.avail_out = zctx->write.len;
+  zctx->write.z.next_out = (Bytef*) zctx->write.buf;
   deflateInit2 (&zctx->write.z, Z_DEFAULT_COMPRESSION,
       Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
 }
@@ -170,6 +170,15 @@ int mutt_copy_body (FILE *fp, BODY **tgt, BODY *src)
 
 
 
+void mutt_free_content (CONTENT **p)
+{
+  if (!*p)
+    return;
+
+  FREE (&(*p)->charsets);
+  FREE (p);		/* __FREE_CHECKED__ */
+}
+
 void mutt_free_body (BODY **p)
 {
   BODY *a = *p, *b;
@@ -192,7 +201,7 @@ void mutt_free_body (BODY **p)
     FREE (&b->filename);
     FREE (&b->d_filename);
     FREE (&b->charset);
-    FREE (&b->content);
+    mutt_free_content (&b->content);
     FREE (&b->xtype);
     FREE (&b->subtype);
     FREE (&b->description);
@@ -403,6 +412,87 @@ int mutt_matches_ignore (const char *s, LIST *t)
   return 0;
 }
 
+/*
+ * Weeding decisions by header name, as every header line of every
+ * message copied or parsed with weeding goes through both lists.  The
+ * ignore and unignore commands reset the cache, as does it filling up.
+ */
+
+#define IGNORE_CACHE_SIZE 512
+
+static HASH *IgnoreCache = NULL;
+static int IgnoreCacheCount = 0;
+/* the data stored for a name, as hash_find() can't return NULL */
+static char IgnoreCacheWeed, IgnoreCacheKeep;
+
+void mutt_reset_ignore_cache (void)
+{
+  hash_destroy (&IgnoreCache, NULL);
+  IgnoreCacheCount = 0;
+}
+
+/* Matches `key', the first `keylen' bytes of a line, against `t' as
+ * mutt_matches_ignore() would.  Sets *partial if the answer could depend
+ * on what follows the key in the line. */
+static int ignore_list_matches (const char *key, size_t keylen, LIST *t,
+                                int *partial)
+{
+  size_t len;
+
+  for (; t; t = t->next)
+  {
+    if (*t->data == '*')
+      return 1;
+    len = mutt_strlen (t->data);
+    if (len <= keylen)
+    {
+      if (!ascii_strncasecmp (key, t->data, len))
+        return 1;
+    }
+    else if (!ascii_strncasecmp (key, t->data, keylen))
+      *partial = 1;
+  }
+
+  return 0;
+}
+
+/* Returns 1 if the header line `s' is on the ignore list and not on the
+ * unignore list. */
+int mutt_ignore_header (const char *s)
+{
+  char key[SHORT_STRING];
+  size_t keylen;
+  int partial = 0, weed;
+  void *cached;
+
+  keylen = strcspn (s, ":");
+  if (s[keylen] == ':')
+    keylen++;
+  if (keylen >= sizeof (key))
+    return mutt_matches_ignore (s, Ignore) && !mutt_matches_ignore (s, UnIgnore);
+
+  memcpy (key, s, keylen);
+  key[keylen] = 0;
+
+  if (IgnoreCache && (cached = hash_find (IgnoreCache, key)))
+    return cached == &IgnoreCacheWeed;
+
+  weed = ignore_list_matches (key, keylen, Ignore, &partial) &&
+    !ignore_list_matches (key, keylen, UnIgnore, &partial);
+  if (partial)
+    return mutt_matches_ignore (s, Ignore) && !mutt_matches_ignore (s, UnIgnore);
+
+  if (IgnoreCacheCount >= IGNORE_CACHE_SIZE)
+    mutt_reset_ignore_cache ();
+  if (!IgnoreCache)
+    IgnoreCache = hash_create (IGNORE_CACHE_SIZE,
+                               MUTT_HASH_STRCASECMP | MUTT_HASH_STRDUP_KEYS);
+  hash_insert (IgnoreCache, key, weed ? &IgnoreCacheWeed : &IgnoreCacheKeep);
+  IgnoreCacheCount++;
+
+  return weed;
+}
+
 
 /* Splits src into parts delimited by delimiter.
  * Invokes mapfunc on each part and joins the result back into src.
@@ -2321,6 +2411,73 @@ int mutt_match_rx_list (const char *s, RX_LIST *l)
   return 0;
 }
 
+/* Matches `s' against a single 'spam' pattern, expanding its template
+ * into `text' on a match as for mutt_match_spam_list(). */
+static int match_spam_rule (const char *s, REPLACE_LIST *l, char *text, int textsize)
+{
+  static regmatch_t *pmatch = NULL;
+  static int nmatch = 0;
+  int tlen = 0;
+  char *p;
+
+  /* If this pattern needs more matches, expand pmatch. */
+  if (l->nmatch > nmatch)
+  {
+    safe_realloc (&pmatch, l->nmatch * sizeof(regmatch_t));
+    nmatch = l->nmatch;
+  }
+
+  /* Does this pattern match? */
+  if (regexec (l->rx->rx, s, (size_t) l->nmatch, (regmatch_t *) pmatch, (int) 0) == 0)
+  {
+    dprint (5, (debugfile, "mutt_match_spam_list: %s matches %s\n", s, l->rx->pattern));
+    dprint (5, (debugfile, "mutt_match_spam_list: %d subs\n", (int)l->rx->rx->re_nsub));
+
+    /* Copy template into text, with substitutions. */
+    for (p = l->template; *p && tlen < textsize - 1;)
+    {
+      /* backreference to pattern match substring, eg. %1, %2, etc) */
+      if (*p == '%')
+      {
+        char *e; /* used as pointer to end of integer backreference in strtol() call */
+        int n;
+
+        ++p; /* skip over % char */
+        n = strtol(p, &e, 10);
+        /* Ensure that the integer conversion succeeded (e!=p) and bounds check.  The upper bound check
+         * should not strictly be necessary since add_to_spam_list() finds the largest value, and
+         * the static array above is always large enough based on that value. */
+        if (e != p && n >= 0 && n <= l->nmatch && pmatch[n].rm_so != -1)
+        {
+          /* copy as much of the substring match as will fit in the output buffer, saving space for
+           * the terminating nul char */
+          int idx;
+          for (idx = pmatch[n].rm_so; (idx < pmatch[n].rm_eo) && (tlen < textsize - 1); ++idx)
+            text[tlen++] = s[idx];
+        }
+        p = e; /* skip over the parsed integer */
+      }
+      else
+      {
+        text[tlen++] = *p++;
+      }
+    }
+    /* tlen should always be less than textsize except when textsize<=0
+     * because the bounds checks in the above code leave room for the
+     * terminal nul char.   This should avoid returning an unterminated
+     * string to the caller.  When textsize<=0 we make no assumption about
+     * the validity of the text pointer. */
+    if (tlen < textsize)
+    {
+      text[tlen] = '\0';
+      dprint (5, (debugfile, "mutt_match_spam_list: \"%s\"\n", text));
+    }
+    return 1;
+  }
+
+  return 0;
+}
+
 /* Match a string against the patterns defined by the 'spam' command and output
  * the expanded format into `text` when there is a match.  If textsize<=0, the
  * match is performed but the format is not expanded and no assumptions are made
@@ -2330,72 +2487,262 @@ int mutt_match_rx_list (const char *s, RX_LIST *l)
  * 0. */
 int mutt_match_spam_list (const char *s, REPLACE_LIST *l, char *text, int textsize)
 {
-  static regmatch_t *pmatch = NULL;
-  static int nmatch = 0;
-  int tlen = 0;
-  char *p;
-
   if (!s) return 0;
 
   for (; l; l = l->next)
+    if (match_spam_rule (s, l, text, textsize))
+      return 1;
+
+  return 0;
+}
+
+/* Skips a bracket expression starting at `p', returning a pointer to its
+ * closing ']', or NULL if it is malformed. */
+static const char *rx_skip_bracket (const char *p)
+{
+  const char *q;
+
+  p++;
+  if (*p == '^')
+    p++;
+  if (*p == ']')
+    p++;
+  while (*p && *p != ']')
   {
-    /* If this pattern needs more matches, expand pmatch. */
-    if (l->nmatch > nmatch)
+    if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
     {
-      safe_realloc (&pmatch, l->nmatch * sizeof(regmatch_t));
-      nmatch = l->nmatch;
+      for (q = p + 2; *q && !(*q == p[1] && q[1] == ']'); q++)
+        ;
+      if (!*q)
+        return NULL;
+      p = q + 2;
     }
+    else
+      p++;
+  }
 
-    /* Does this pattern match? */
-    if (regexec (l->rx->rx, s, (size_t) l->nmatch, (regmatch_t *) pmatch, (int) 0) == 0)
+  return *p ? p : NULL;
+}
+
+/* Finds a literal that any line matching the extended regular expression
+ * `pat' must contain, so callers can skip regexec() on lines without it.
+ * Only text outside groups and not made optional by a quantifier counts,
+ * and alternation gives up entirely.  Sets *anchored if the line must
+ * start with the literal.  Returns NULL if there is no such literal. */
+char *mutt_regex_literal (const char *pat, int *anchored)
+{
+  char cur[STRING], best[STRING];
+  size_t curlen = 0, bestlen = 0;
+  int depth = 0, first, lit;
+  const char *p = pat;
+
+  *anchored = 0;
+  if (strchr (pat, '|'))
+    return NULL;
+
+  first = (*p == '^');
+  if (first)
+    p++;
+
+  for (;; p++)
+  {
+    lit = -1;
+
+    switch (*p)
     {
-      dprint (5, (debugfile, "mutt_match_spam_list: %s matches %s\n", s, l->rx->pattern));
-      dprint (5, (debugfile, "mutt_match_spam_list: %d subs\n", (int)l->rx->rx->re_nsub));
+      case '(':
+        depth++;
+        break;
+      case ')':
+        if (--depth < 0)
+          return NULL;
+        break;
+      case '[':
+        if (!(p = rx_skip_bracket (p)))
+          return NULL;
+        break;
+      case '{':
+        if (!(p = strchr (p, '}')))
+          return NULL;
+        /* fall through */
+      case '*':
+      case '?':
+        /* the quantifier makes the last literal optional */
+        if (curlen)
+          curlen--;
+        break;
+      case '\\':
+        /* only escaped metacharacters are literal; GNU operators such
+         * as \< \> \b \w and \` match no text */
+        if (p[1] && strchr (".[]()*+?{}|^$\\", p[1]))
+          lit = *++p;
+        else if (p[1])
+          p++;
+        break;
+      case '\0':
+      case '+':
+      case '.':
+      case '^':
+      case '$':
+        break;
+      default:
+        if (!(*p & 0x80) && isprint ((unsigned char) *p))
+          lit = *p;
+        break;
+    }
 
-      /* Copy template into text, with substitutions. */
-      for (p = l->template; *p && tlen < textsize - 1;)
-      {
-	/* backreference to pattern match substring, eg. %1, %2, etc) */
-	if (*p == '%')
-	{
-	  char *e; /* used as pointer to end of integer backreference in strtol() call */
-	  int n;
-
-	  ++p; /* skip over % char */
-	  n = strtol(p, &e, 10);
-	  /* Ensure that the integer conversion succeeded (e!=p) and bounds check.  The upper bound check
-	   * should not strictly be necessary since add_to_spam_list() finds the largest value, and
-	   * the static array above is always large enough based on that value. */
-	  if (e != p && n >= 0 && n <= l->nmatch && pmatch[n].rm_so != -1)
-          {
-	    /* copy as much of the substring match as will fit in the output buffer, saving space for
-	     * the terminating nul char */
-	    int idx;
-	    for (idx = pmatch[n].rm_so; (idx < pmatch[n].rm_eo) && (tlen < textsize - 1); ++idx)
-	      text[tlen++] = s[idx];
-	  }
-	  p = e; /* skip over the parsed integer */
-	}
-	else
-	{
-	  text[tlen++] = *p++;
-	}
-      }
-      /* tlen should always be less than textsize except when textsize<=0
-       * because the bounds checks in the above code leave room for the
-       * terminal nul char.   This should avoid returning an unterminated
-       * string to the caller.  When textsize<=0 we make no assumption about
-       * the validity of the text pointer. */
-      if (tlen < textsize)
-      {
-	text[tlen] = '\0';
-	dprint (5, (debugfile, "mutt_match_spam_list: \"%s\"\n", text));
-      }
-      return 1;
+    if (lit != -1 && depth == 0 && curlen < sizeof (cur) - 1)
+    {
+      cur[curlen++] = lit;
+      continue;
     }
+
+    /* the current run of literals ends here */
+    if (first && curlen)
+    {
+      *anchored = 1;
+      bestlen = curlen;
+      memcpy (best, cur, curlen);
+      break;
+    }
+    first = 0;
+    if (curlen > bestlen)
+    {
+      bestlen = curlen;
+      memcpy (best, cur, curlen);
+    }
+    curlen = 0;
+
+    if (!*p)
+      break;
   }
 
-  return 0;
+  if (!bestlen)
+    return NULL;
+  best[bestlen] = 0;
+  return safe_strdup (best);
+}
+
+/*
+ * mutt_match_spam() runs the spam and nospam lists against every header
+ * line of every message read, so each pattern is given a literal that a
+ * line must contain before regexec() is tried.  For patterns anchored
+ * with '^' this is the text the line must start with, usually the header
+ * name; otherwise it is the longest literal run the pattern requires.
+ * The rules point into SpamList and NoSpamList, so they are rebuilt
+ * after either list changes.
+ */
+
+typedef struct spam_rule
+{
+  REGEXP *rx;
+  REPLACE_LIST *spam;	/* NULL for a nospam pattern */
+  char *literal;	/* NULL if no literal could be extracted */
+  size_t len;
+  int anchored;
+} SPAM_RULE;
+
+static SPAM_RULE *SpamRules = NULL;
+static int SpamRulesCount = 0;
+static int NoSpamRulesStart = 0;	/* spam rules come first */
+static int SpamRulesValid = 0;
+
+void mutt_reset_spam_matcher (void)
+{
+  int i;
+
+  for (i = 0; i < SpamRulesCount; i++)
+    FREE (&SpamRules[i].literal);
+  FREE (&SpamRules);
+  SpamRulesCount = 0;
+  NoSpamRulesStart = 0;
+  SpamRulesValid = 0;
+}
+
+static void spam_rule_init (SPAM_RULE *rule, REGEXP *rx, REPLACE_LIST *spam)
+{
+  rule->rx = rx;
+  rule->spam = spam;
+  rule->literal = mutt_regex_literal (rx->pattern, &rule->anchored);
+  rule->len = mutt_strlen (rule->literal);
+  dprint (5, (debugfile, "spam_rule_init: %s -> %s%s\n", rx->pattern,
+              rule->anchored ? "^" : "", NONULL (rule->literal)));
+}
+
+static void build_spam_matcher (void)
+{
+  REPLACE_LIST *sl;
+  RX_LIST *nl;
+  int n = 0;
+
+  mutt_reset_spam_matcher ();
+
+  for (sl = SpamList; sl; sl = sl->next)
+    n++;
+  for (nl = NoSpamList; nl; nl = nl->next)
+    n++;
+  if (n)
+    SpamRules = safe_calloc (n, sizeof (SPAM_RULE));
+
+  for (sl = SpamList; sl; sl = sl->next)
+    spam_rule_init (&SpamRules[SpamRulesCount++], sl->rx, sl);
+  NoSpamRulesStart = SpamRulesCount;
+  for (nl = NoSpamList; nl; nl = nl->next)
+    spam_rule_init (&SpamRules[SpamRulesCount++], nl->rx, NULL);
+
+  SpamRulesValid = 1;
+}
+
+/* Both lists are compiled with REG_ICASE.  Outside ASCII a case-insensitive
+ * match can pair different bytes, so 8-bit lines skip the prefilter. */
+static int spam_rule_candidate (const SPAM_RULE *rule, const char *s, int ascii)
+{
+  if (!rule->literal || !ascii)
+    return 1;
+  if (rule->anchored)
+    return !ascii_strncasecmp (s, rule->literal, rule->len);
+  return mutt_stristr (s, rule->literal) != NULL;
+}
+
+/* Matches a header line against the 'spam' patterns, first match winning,
+ * and then the 'nospam' patterns.  Returns 1 and the expanded template in
+ * `text' if a spam pattern matched and no nospam pattern did. */
+int mutt_match_spam (const char *s, char *text, int textsize)
+{
+  const unsigned char *p;
+  int i, ascii = 1;
+
+  if (!s)
+    return 0;
+
+  if (!SpamRulesValid)
+    build_spam_matcher ();
+  if (!NoSpamRulesStart)
+    return 0;
+
+  for (p = (const unsigned char *) s; *p; p++)
+    if (*p & 0x80)
+    {
+      ascii = 0;
+      break;
+    }
+
+  for (i = 0; i < NoSpamRulesStart; i++)
+    if (spam_rule_candidate (&SpamRules[i], s, ascii) &&
+        match_spam_rule (s, SpamRules[i].spam, text, textsize))
+      break;
+  if (i == NoSpamRulesStart)
+    return 0;
+
+  for (i = NoSpamRulesStart; i < SpamRulesCount; i++)
+    if (spam_rule_candidate (&SpamRules[i], s, ascii) &&
+        regexec (SpamRules[i].rx->rx, s, (size_t) 0, (regmatch_t *) 0, (int) 0) == 0)
+    {
+      dprint (5, (debugfile, "mutt_match_spam: %s matches %s\n", s, SpamRules[i].rx->pattern));
+      return 0;
+    }
+
+  return 1;
 }
 
 void mutt_encode_path (BUFFER *dest, const char *src)
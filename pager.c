@@ -46,6 +46,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 #define ISHEADER(x) ((x) == MT_COLOR_HEADER || (x) == MT_COLOR_HDEFAULT)
 
@@ -119,11 +121,15 @@ struct line_t
   short type;
   short chunks;
   short search_cnt;
+  unsigned char quote_len;             /* length of the $quote_regexp match at
+                                        * the start of the line, 0 if unknown */
   unsigned int continuation : 1;
   unsigned int is_cont_hdr  : 1; /* continuation of header line */
   unsigned int show_patterns_done : 1; /* body patterns and quote type computed,
                                         * as part of showing the line */
-  struct syntax_t *syntax;
+  int cont_start;                      /* continuation: the line it continues */
+  COLOR_ATTR color;                    /* header color, also of continuations */
+  struct syntax_t *syntax;             /* body pattern matches, if chunks */
   struct syntax_t *search;
   struct q_class_t *quote;
 };
@@ -149,23 +155,331 @@ static struct resize {
   int line;
   int SearchCompiled;
   int SearchBack;
+  int SearchMatchCur;
 } *Resize = NULL;
 #endif
 
+/* The lines of a message are laid out in blocks of LINE_BLOCK lines,
+ * and only LINE_BLOCKS_KEPT blocks are held at a time.  A block that was
+ * let go is laid out again when one of its lines is needed, starting
+ * from its first line with the state kept here.  Blocks holding header
+ * lines are never let go, as a later header line may recolor them.
+ */
+#define LINE_BLOCK 128
+#define LINE_BLOCKS_KEPT 64
+
+struct line_block_t
+{
+  struct line_t first;          /* its first line, while let go */
+  struct line_t prev;           /* the line before it */
+  int sig_lines;                /* signature lines before it */
+  int hard_lines;               /* lines before it that aren't continuations */
+  unsigned int used;            /* lineClock when last used */
+  unsigned int pinned : 1;      /* holds header lines */
+  struct line_t *lines;         /* NULL if let go */
+};
+
+typedef struct
+{
+  int flags;
+  pager_t *extra;
+  int indexlen;
+  int indicator;                /* the indicator line of the PI */
+  int oldtopline;
+  int lines;
+  int lastLine;
+  int curline;
+  int topline;
+  int force_redraw;
+  int has_types;
+  int hideQuoted;
+  int q_level;
+  struct q_class_t *QuoteList;
+  HASH *QuoteHash;		/* quote classes by prefix */
+  LOFF_T last_pos;
+  LOFF_T last_offset;
+  mutt_window_t *index_status_window;
+  mutt_window_t *index_window;
+  mutt_window_t *pager_status_window;
+  mutt_window_t *pager_window;
+  MUTTMENU *index;		/* the Pager Index (PI) */
+  regex_t SearchRE;
+  int SearchCompiled;
+  int SearchFlag;
+  int SearchBack;
+  LOFF_T *SearchMatches;	/* offsets of the lines matching SearchRE */
+  int SearchMatchCount;
+  int SearchMatchMax;
+  int SearchMatchCur;		/* the match last jumped to, counting from 1 */
+  const char *banner;
+  const char *helpstr;
+  char *searchbuf;
+  struct line_block_t *lineBlocks;	/* the lines laid out, by LINE_BLOCK */
+  int lineBlockCount;
+  int lineBlockMax;
+  int keptBlocks[LINE_BLOCKS_KEPT];	/* the blocks held laid out */
+  int keptCount;
+  unsigned int lineClock;	/* counts uses of blocks, for keptBlocks */
+  FILE *fp;
+  struct stat sb;
+  pid_t stream_pid;		/* still writing fp, see pager_stream_update() */
+  int stream_fd;
+  int stream_rc;		/* the result it reported, -1 before */
+} pager_redraw_data_t;
+
 #define NumSigLines 4
 
-static int check_sig (const char *s, struct line_t *info, int n)
+static int display_line (pager_redraw_data_t *, int, int);
+
+static void init_lines (struct line_t *lines, int count)
+{
+  memset (lines, 0, count * sizeof (struct line_t));
+  for (; count > 0; count--, lines++)
+  {
+    lines->type = -1;
+    lines->search_cnt = -1;
+  }
+}
+
+static void free_lines (struct line_t *lines, int count)
+{
+  for (; count > 0; count--, lines++)
+  {
+    FREE (&lines->syntax);
+    FREE (&lines->search);
+  }
+}
+
+static int block_has_headers (struct line_block_t *blk)
+{
+  int i;
+
+  for (i = 0; i < LINE_BLOCK; i++)
+    if (ISHEADER (blk->lines[i].type) || blk->lines[i].is_cont_hdr)
+      return 1;
+  return 0;
+}
+
+/* Allocates the lines of block b, letting go of the least recently
+ * used block if too many are held.
+ */
+static struct line_t *keep_block (pager_redraw_data_t *rd, int b)
+{
+  struct line_block_t *blk;
+  int i, oldest;
+
+  while (rd->keptCount == LINE_BLOCKS_KEPT)
+  {
+    oldest = 0;
+    for (i = 1; i < rd->keptCount; i++)
+      if (rd->lineBlocks[rd->keptBlocks[i]].used <
+          rd->lineBlocks[rd->keptBlocks[oldest]].used)
+        oldest = i;
+    blk = &rd->lineBlocks[rd->keptBlocks[oldest]];
+    rd->keptBlocks[oldest] = rd->keptBlocks[--rd->keptCount];
+
+    if (block_has_headers (blk))
+    {
+      blk->pinned = 1;
+      continue;
+    }
+
+    blk->first = blk->lines[0];
+    blk->first.chunks = 0;
+    blk->first.search_cnt = -1;
+    blk->first.show_patterns_done = 0;
+    blk->first.syntax = blk->first.search = NULL;
+    blk->first.quote = NULL;
+    free_lines (blk->lines, LINE_BLOCK);
+    FREE (&blk->lines);
+  }
+
+  blk = &rd->lineBlocks[b];
+  blk->lines = safe_malloc (LINE_BLOCK * sizeof (struct line_t));
+  init_lines (blk->lines, LINE_BLOCK);
+  blk->used = ++rd->lineClock;
+  rd->keptBlocks[rd->keptCount++] = b;
+
+  return blk->lines;
+}
+
+static void free_blocks (pager_redraw_data_t *rd)
+{
+  int i;
+
+  for (i = 0; i < rd->lineBlockCount; i++)
+    if (rd->lineBlocks[i].lines)
+    {
+      free_lines (rd->lineBlocks[i].lines, LINE_BLOCK);
+      FREE (&rd->lineBlocks[i].lines);
+    }
+  rd->lineBlockCount = 0;
+  rd->keptCount = 0;
+}
+
+/* Forgets the search matches of the lines held. */
+static void clear_search (pager_redraw_data_t *rd)
+{
+  struct line_t *line;
+  int i, j;
+
+  for (i = 0; i < rd->lineBlockCount; i++)
+    if ((line = rd->lineBlocks[i].lines) != NULL)
+      for (j = 0; j < LINE_BLOCK; j++, line++)
+      {
+        FREE (&line->search);
+        line->search_cnt = -1;
+      }
+}
+
+static struct line_t *pager_line (pager_redraw_data_t *rd, int n);
+
+/* Counts the signature lines just before line n, up to NumSigLines + 1.
+ * Line 0 doesn't count.
+ */
+static int sig_lines_before (pager_redraw_data_t *rd, int n)
 {
   int count = 0;
 
-  while (n > 0 && count <= NumSigLines)
+  while (n > 1 && count <= NumSigLines)
   {
-    if (info[n].type != MT_COLOR_SIGNATURE)
+    if (n % LINE_BLOCK == 0)
+      return count + rd->lineBlocks[n / LINE_BLOCK].sig_lines;
+    if (pager_line (rd, n - 1)->type != MT_COLOR_SIGNATURE)
       break;
     count++;
     n--;
   }
 
+  return count;
+}
+
+/* Adds the block following the last one, noting the state its layout
+ * starts from.
+ */
+static void new_block (pager_redraw_data_t *rd)
+{
+  struct line_block_t *blk;
+  struct line_t *prev;
+  int b = rd->lineBlockCount, i, hard_lines = 0, sig_lines = 0;
+
+  if (b == rd->lineBlockMax)
+    safe_realloc (&rd->lineBlocks,
+                  (rd->lineBlockMax += MAX (rd->lineBlockMax, 16)) *
+                  sizeof (struct line_block_t));
+
+  if (b > 0)
+  {
+    prev = pager_line (rd, b * LINE_BLOCK - 1);
+    if (prev->type == MT_COLOR_SIGNATURE)
+      sig_lines = 1 + sig_lines_before (rd, b * LINE_BLOCK - 1);
+    hard_lines = rd->lineBlocks[b - 1].hard_lines;
+    for (i = 0; i < LINE_BLOCK; i++)
+      if (!rd->lineBlocks[b - 1].lines[i].continuation)
+        hard_lines++;
+  }
+
+  blk = &rd->lineBlocks[b];
+  memset (blk, 0, sizeof (struct line_block_t));
+  if (b > 0)
+  {
+    blk->prev = *prev;
+    blk->prev.syntax = blk->prev.search = NULL;
+    blk->prev.quote = NULL;
+  }
+  blk->sig_lines = sig_lines;
+  blk->hard_lines = hard_lines;
+  rd->lineBlockCount++;
+
+  keep_block (rd, b);
+}
+
+/* Lays out block b again, from the state kept for it. */
+static void layout_block (pager_redraw_data_t *rd, int b)
+{
+  int n, last;
+  LOFF_T last_pos = rd->last_pos;
+  struct line_t *lines;
+
+  lines = keep_block (rd, b);
+  lines[0] = rd->lineBlocks[b].first;
+
+  last = MIN ((b + 1) * LINE_BLOCK, rd->lastLine);
+  for (n = b * LINE_BLOCK; n < last; n++)
+    if (display_line (rd, n, rd->has_types |
+                      (rd->flags & (MUTT_PAGER_NSKIP | MUTT_PAGER_NOWRAP))) < 0)
+      break;
+
+  /* the status line shows how far into the file last_pos is */
+  if (rd->last_pos != last_pos)
+  {
+    rd->last_pos = last_pos;
+    fseeko (rd->fp, last_pos, SEEK_SET);
+  }
+}
+
+/* Returns line n, laying out its block again if it was let go.  The
+ * line stays valid until another block is laid out or added.
+ */
+static struct line_t *pager_line (pager_redraw_data_t *rd, int n)
+{
+  int b = n / LINE_BLOCK;
+
+  while (b >= rd->lineBlockCount)
+    new_block (rd);
+  if (!rd->lineBlocks[b].lines)
+    layout_block (rd, b);
+  rd->lineBlocks[b].used = ++rd->lineClock;
+
+  return &rd->lineBlocks[b].lines[n % LINE_BLOCK];
+}
+
+/* Like pager_line(), but returns NULL instead of laying out a block that
+ * was let go.
+ */
+static struct line_t *pager_line_kept (pager_redraw_data_t *rd, int n)
+{
+  int b = n / LINE_BLOCK;
+
+  if (b < rd->lineBlockCount && !rd->lineBlocks[b].lines)
+    return NULL;
+  return pager_line (rd, n);
+}
+
+/* The line before n, also at the start of a block that is being laid
+ * out again.
+ */
+static struct line_t *pager_prev_line (pager_redraw_data_t *rd, int n)
+{
+  if (n % LINE_BLOCK == 0)
+    return &rd->lineBlocks[n / LINE_BLOCK].prev;
+  return pager_line (rd, n - 1);
+}
+
+/* Returns the number of lines up to line n that aren't continuations. */
+static int pager_hard_lines (pager_redraw_data_t *rd, int n)
+{
+  int i, count;
+
+  count = rd->lineBlocks[n / LINE_BLOCK].hard_lines;
+  for (i = n - n % LINE_BLOCK; i <= n; i++)
+    if (!pager_line (rd, i)->continuation)
+      count++;
+  return count;
+}
+
+/* Lets go of all lines, and starts again from the top. */
+static void reset_lines (pager_redraw_data_t *rd)
+{
+  free_blocks (rd);
+  rd->lastLine = 0;
+  pager_line (rd, 0);
+}
+
+static int check_sig (const char *s, pager_redraw_data_t *rd, int n)
+{
+  int count = sig_lines_before (rd, n);
+
   if (count == 0)
     return (-1);
 
@@ -199,14 +513,15 @@ comp_syntax_t (const void *m1, const void *m2)
 }
 
 static void
-resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
+resolve_color (pager_redraw_data_t *rd, int n, int cnt, int flags, int special,
                ansi_attr *a, int wrap_cols)
 {
   COLOR_ATTR def_color = {0};		/* color without syntax highlight */
   COLOR_ATTR color = {0};		/* final color */
   static COLOR_ATTR last_color = {0};	/* last color set */
-  int search = 0, m;
+  int search = 0;
   struct syntax_t *matching_chunk;
+  struct line_t *line, *start;
 
   /* force attrset() */
   if (!cnt)
@@ -215,7 +530,8 @@ resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
     last_color.attrs = -1;
   }
 
-  if (lineInfo[n].continuation)
+  line = pager_line (rd, n);
+  if (line->continuation)
   {
     if (!cnt && option (OPTMARKERS) && (wrap_cols > 1))
     {
@@ -223,21 +539,21 @@ resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
       addch ('+');
       last_color = ColorDefs[MT_COLOR_MARKERS];
     }
-    m = (lineInfo[n].syntax)[0].first;
-    cnt += (lineInfo[n].syntax)[0].last;
+    start = pager_line (rd, line->cont_start);
+    cnt += (int) (line->offset - start->offset);
   }
   else
-    m = n;
+    start = line;
   if (!(flags & MUTT_SHOWCOLOR))
     def_color = ColorDefs[MT_COLOR_NORMAL];
-  else if (lineInfo[m].type == MT_COLOR_HEADER)
-    def_color = (lineInfo[m].syntax)[0].color;
+  else if (start->type == MT_COLOR_HEADER)
+    def_color = start->color;
   else
-    def_color = ColorDefs[lineInfo[m].type];
+    def_color = ColorDefs[start->type];
 
-  if ((flags & MUTT_SHOWCOLOR) && lineInfo[m].type == MT_COLOR_QUOTED)
+  if ((flags & MUTT_SHOWCOLOR) && start->type == MT_COLOR_QUOTED)
   {
-    struct q_class_t *class = lineInfo[m].quote;
+    struct q_class_t *class = start->quote;
 
     if (class)
     {
@@ -252,9 +568,9 @@ resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
   }
 
   color = def_color;
-  if ((flags & MUTT_SHOWCOLOR) && lineInfo[m].chunks)
+  if ((flags & MUTT_SHOWCOLOR) && start->chunks)
   {
-    matching_chunk = bsearch (&cnt, lineInfo[m].syntax, lineInfo[m].chunks,
+    matching_chunk = bsearch (&cnt, start->syntax, start->chunks,
                               sizeof(struct syntax_t), comp_syntax_t);
     if (matching_chunk &&
         (cnt >= matching_chunk->first) &&
@@ -262,9 +578,9 @@ resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
       color = matching_chunk->color;
   }
 
-  if ((flags & MUTT_SEARCH) && lineInfo[m].search_cnt)
+  if ((flags & MUTT_SEARCH) && start->search_cnt)
   {
-    matching_chunk = bsearch (&cnt, lineInfo[m].search, lineInfo[m].search_cnt,
+    matching_chunk = bsearch (&cnt, start->search, start->search_cnt,
                               sizeof(struct syntax_t), comp_syntax_t);
     if (matching_chunk &&
         (cnt >= matching_chunk->first) &&
@@ -337,22 +653,16 @@ resolve_color (struct line_t *lineInfo, int n, int cnt, int flags, int special,
 }
 
 static void
-append_line (struct line_t *lineInfo, int n, int cnt)
+append_line (struct line_t *line, struct line_t *next, int n)
 {
-  int m;
-
-  lineInfo[n+1].type = lineInfo[n].type;
-  (lineInfo[n+1].syntax)[0].color = (lineInfo[n].syntax)[0].color;
-  lineInfo[n+1].continuation = 1;
-  lineInfo[n+1].show_patterns_done = lineInfo[n].show_patterns_done;
-
-  /* find the real start of the line */
-  for (m = n; m >= 0; m--)
-    if (lineInfo[m].continuation == 0) break;
-
-  (lineInfo[n+1].syntax)[0].first = m;
-  (lineInfo[n+1].syntax)[0].last = (lineInfo[n].continuation) ?
-    cnt + (lineInfo[n].syntax)[0].last : cnt;
+  next->type = line->type;
+  next->color = line->color;
+  next->continuation = 1;
+  next->show_patterns_done = line->show_patterns_done;
+
+  /* the real start of the line.  The column within it follows from
+   * the offsets. */
+  next->cont_start = line->continuation ? line->cont_start : n;
 }
 
 static void
@@ -400,6 +710,22 @@ shift_class_colors (struct q_class_t *QuoteList, struct q_class_t *new_class,
   (*q_level)++;
 }
 
+/* Allocates a class for the quote prefix qptr and adds it to QuoteHash,
+ * which maps each prefix seen so far to its class. */
+static struct q_class_t *
+new_quote_class (HASH *QuoteHash, const char *qptr, int length)
+{
+  struct q_class_t *class;
+
+  class = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
+  class->prefix = (char *) safe_calloc (1, length + 1);
+  strncpy (class->prefix, qptr, length);
+  class->length = length;
+  hash_insert (QuoteHash, class->prefix, class);
+
+  return class;
+}
+
 static void
 cleanup_quote (struct q_class_t **QuoteList)
 {
@@ -420,11 +746,12 @@ cleanup_quote (struct q_class_t **QuoteList)
 }
 
 static struct q_class_t *
-classify_quote (struct q_class_t **QuoteList, const char *qptr,
+classify_quote (struct q_class_t **QuoteList, HASH *QuoteHash, const char *qptr,
 		int length, int *force_redraw, int *q_level)
 {
   struct q_class_t *q_list = *QuoteList;
   struct q_class_t *class = NULL, *tmp = NULL, *ptr, *save;
+  char key[LONG_STRING];
   char *tail_qptr;
   int offset, tail_lng;
   int index = -1;
@@ -442,6 +769,16 @@ classify_quote (struct q_class_t **QuoteList, const char *qptr,
     return (*QuoteList);
   }
 
+  /* Most quoted lines repeat a prefix that already has a class, and
+   * finding it again doesn't change the tree, so skip the walk below. */
+  if (length < sizeof (key))
+  {
+    memcpy (key, qptr, length);
+    key[length] = 0;
+    if ((class = hash_find (QuoteHash, key)) != NULL)
+      return class;
+  }
+
   /* Did I mention how much I like emulating Lisp in C? */
 
   /* classify quoting prefix */
@@ -460,10 +797,7 @@ classify_quote (struct q_class_t **QuoteList, const char *qptr,
 	if (tmp == NULL)
 	{
 	  /* add a node above q_list */
-	  tmp = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-	  tmp->prefix = (char *) safe_calloc (1, length + 1);
-	  strncpy (tmp->prefix, qptr, length);
-	  tmp->length = length;
+	  tmp = new_quote_class (QuoteHash, qptr, length);
 
 	  /* replace q_list by tmp in the top level list */
 	  if (q_list->next)
@@ -570,11 +904,7 @@ classify_quote (struct q_class_t **QuoteList, const char *qptr,
 	      if (tmp == NULL)
 	      {
 		/* add a node above q_list */
-		tmp = (struct q_class_t *)
-                  safe_calloc (1, sizeof (struct q_class_t));
-		tmp->prefix = (char *) safe_calloc (1, length + 1);
-		strncpy (tmp->prefix, qptr, length);
-		tmp->length = length;
+		tmp = new_quote_class (QuoteHash, qptr, length);
 
 		/* replace q_list by tmp */
 		if (q_list->next)
@@ -673,10 +1003,7 @@ classify_quote (struct q_class_t **QuoteList, const char *qptr,
 	/* still not found so far: add it as a sibling to the current node */
 	if (class == NULL)
 	{
-	  tmp = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-	  tmp->prefix = (char *) safe_calloc (1, length + 1);
-	  strncpy (tmp->prefix, qptr, length);
-	  tmp->length = length;
+	  tmp = new_quote_class (QuoteHash, qptr, length);
 
 	  if (ptr->down)
 	  {
@@ -710,10 +1037,7 @@ classify_quote (struct q_class_t **QuoteList, const char *qptr,
   if (class == NULL)
   {
     /* not found so far: add it as a top level class */
-    class = (struct q_class_t *) safe_calloc (1, sizeof (struct q_class_t));
-    class->prefix = (char *) safe_calloc (1, length + 1);
-    strncpy (class->prefix, qptr, length);
-    class->length = length;
+    class = new_quote_class (QuoteHash, qptr, length);
     new_class_color (class, q_level);
 
     if (*QuoteList)
@@ -774,12 +1098,42 @@ mutt_is_quote_line (char *buf, regmatch_t *pmatch)
   return is_quote;
 }
 
+/* Returns 0 if color_line can't match anywhere in `s', judging by the
+ * literal add_pattern() found in its regexp.  Case-insensitive literals
+ * are only checked on ASCII lines, as REG_ICASE may fold other
+ * characters onto them. */
+static int color_line_candidate (const COLOR_LINE *color_line, const char *s,
+                                 int ascii)
+{
+  if (!color_line->literal)
+    return 1;
+  if (!color_line->icase)
+  {
+    if (color_line->anchored)
+      return !mutt_strncmp (s, color_line->literal, color_line->literal_len);
+    return strstr (s, color_line->literal) != NULL;
+  }
+  if (!ascii)
+    return 1;
+  if (color_line->anchored)
+    return !ascii_strncasecmp (s, color_line->literal, color_line->literal_len);
+  return mutt_stristr (s, color_line->literal) != NULL;
+}
+
+static int is_ascii_line (const char *s)
+{
+  for (; *s; s++)
+    if (*s & 0x80)
+      return 0;
+  return 1;
+}
+
 static void
-match_body_patterns (char *buf, struct line_t *lineInfo, int n)
+match_body_patterns (char *buf, struct line_t *line)
 {
   COLOR_LINE *color_line, *color_list;
   size_t buflen;
-  int has_nl = 0, i, offset = 0, found, has_reg_match;
+  int has_nl = 0, i, offset = 0, found, has_reg_match, ascii;
   regmatch_t pmatch[1];
   regoff_t rm_so, rm_eo;
   short line_allocated_chunks;
@@ -792,19 +1146,21 @@ match_body_patterns (char *buf, struct line_t *lineInfo, int n)
     buf[buflen - 1] = 0;
   }
 
-  /* note: the lineInfo[n].syntax comes with one pre-allocated
-   *       during initialization. */
-  line_allocated_chunks = 1;
-  lineInfo[n].chunks = 0;
+  /* the chunks are allocated as matches are found */
+  FREE (&line->syntax);
+  line_allocated_chunks = 0;
+  line->chunks = 0;
 
-  if (lineInfo[n].type == MT_COLOR_HDEFAULT)
+  if (line->type == MT_COLOR_HDEFAULT)
     color_list = ColorHdrList;
   else
     color_list = ColorBodyList;
 
+  /* rules whose literal is missing from the line are never tried */
+  ascii = is_ascii_line (buf);
   for (color_line = color_list; color_line; color_line = color_line->next)
   {
-    color_line->stop_matching = 0;
+    color_line->stop_matching = !color_line_candidate (color_line, buf, ascii);
     color_line->cached = 0;
   }
 
@@ -846,25 +1202,25 @@ match_body_patterns (char *buf, struct line_t *lineInfo, int n)
         {
           /* Abort if we fill up chunks.
            * Yes, this really happened. See #3888 */
-          if (lineInfo[n].chunks == SHRT_MAX)
+          if (line->chunks == SHRT_MAX)
             break;
-          lineInfo[n].chunks++;
-          if (lineInfo[n].chunks > line_allocated_chunks)
+          line->chunks++;
+          if (line->chunks > line_allocated_chunks)
           {
-            line_allocated_chunks = lineInfo[n].chunks;
-            safe_realloc (&(lineInfo[n].syntax),
+            line_allocated_chunks = line->chunks;
+            safe_realloc (&line->syntax,
                           line_allocated_chunks * sizeof (struct syntax_t));
           }
         }
-        i = lineInfo[n].chunks - 1;
+        i = line->chunks - 1;
         if (!found ||
-            rm_so < (lineInfo[n].syntax)[i].first ||
-            (rm_so == (lineInfo[n].syntax)[i].first &&
-             rm_eo > (lineInfo[n].syntax)[i].last))
+            rm_so < line->syntax[i].first ||
+            (rm_so == line->syntax[i].first &&
+             rm_eo > line->syntax[i].last))
         {
-          (lineInfo[n].syntax)[i].color = color_line->color;
-          (lineInfo[n].syntax)[i].first = rm_so;
-          (lineInfo[n].syntax)[i].last = rm_eo;
+          line->syntax[i].color = color_line->color;
+          line->syntax[i].first = rm_so;
+          line->syntax[i].last = rm_eo;
         }
         found = 1;
       }
@@ -882,13 +1238,13 @@ match_body_patterns (char *buf, struct line_t *lineInfo, int n)
     if (found)
     {
       /* Skip empty matches */
-      if ((lineInfo[n].syntax)[i].first == (lineInfo[n].syntax)[i].last)
+      if (line->syntax[i].first == line->syntax[i].last)
       {
-        lineInfo[n].chunks--;
-        offset = (lineInfo[n].syntax)[i].last + 1;
+        line->chunks--;
+        offset = line->syntax[i].last + 1;
       }
       else
-        offset = (lineInfo[n].syntax)[i].last;
+        offset = line->syntax[i].last;
 
       /* Remove cached matches that aren't later in the buffer */
       for (color_line = color_list; color_line; color_line = color_line->next)
@@ -902,20 +1258,23 @@ match_body_patterns (char *buf, struct line_t *lineInfo, int n)
 }
 
 static void
-resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
-               struct q_class_t **QuoteList, int *q_level, int *force_redraw,
+resolve_types (char *buf, char *raw, pager_redraw_data_t *rd, int n,
                int q_classify)
 {
   COLOR_LINE *color_line;
   regmatch_t pmatch[1];
+  struct line_t *line, *prev, *next;
   int i;
 
-  if (n == 0 || ISHEADER (lineInfo[n-1].type) ||
+  line = pager_line (rd, n);
+  prev = pager_prev_line (rd, n);
+
+  if (n == 0 || ISHEADER (prev->type) ||
       (check_protected_header_marker (raw) == 0))
   {
     if (buf[0] == '\n') /* end of header */
     {
-      lineInfo[n].type = MT_COLOR_NORMAL;
+      line->type = MT_COLOR_NORMAL;
       getyx(stdscr, brailleLine, brailleCol);
     }
     else
@@ -924,16 +1283,16 @@ resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
        * line's color as default. */
       if (n > 0 && (buf[0] == ' ' || buf[0] == '\t'))
       {
-	lineInfo[n].type = lineInfo[n-1].type; /* wrapped line */
+	line->type = prev->type; /* wrapped line */
         if (!option (OPTHEADERCOLORPARTIAL))
         {
-          (lineInfo[n].syntax)[0].color = (lineInfo[n-1].syntax)[0].color;
-          lineInfo[n].is_cont_hdr = 1;
+          line->color = prev->color;
+          line->is_cont_hdr = 1;
         }
       }
       else
       {
-	lineInfo[n].type = MT_COLOR_HDEFAULT;
+	line->type = MT_COLOR_HDEFAULT;
       }
 
       /* When this option is unset, we color the entire header the
@@ -942,28 +1301,33 @@ resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
        */
       if (!option (OPTHEADERCOLORPARTIAL))
       {
+        int ascii = is_ascii_line (buf);
+
         for (color_line = ColorHdrList; color_line; color_line = color_line->next)
         {
-          if (REGEXEC (color_line->rx, buf) == 0)
+          if (color_line_candidate (color_line, buf, ascii) &&
+              REGEXEC (color_line->rx, buf) == 0)
           {
-            lineInfo[n].type = MT_COLOR_HEADER;
-            lineInfo[n].syntax[0].color = color_line->color;
-            if (lineInfo[n].is_cont_hdr)
+            line->type = MT_COLOR_HEADER;
+            line->color = color_line->color;
+            if (line->is_cont_hdr)
             {
-              /* adjust the previous continuation lines to reflect the color of this continuation line */
+              /* adjust the previous continuation lines to reflect the color
+               * of this continuation line.  Their blocks hold header lines,
+               * so they are still laid out. */
               int j;
-              for (j = n - 1; j >= 0 && lineInfo[j].is_cont_hdr; --j)
+              for (j = n - 1; j >= 0 && pager_line (rd, j)->is_cont_hdr; --j)
               {
-                lineInfo[j].type = lineInfo[n].type;
-                lineInfo[j].syntax[0].color = lineInfo[n].syntax[0].color;
+                pager_line (rd, j)->type = line->type;
+                pager_line (rd, j)->color = line->color;
               }
               /* now adjust the first line of this header field */
               if (j >= 0)
               {
-                lineInfo[j].type = lineInfo[n].type;
-                lineInfo[j].syntax[0].color = lineInfo[n].syntax[0].color;
+                pager_line (rd, j)->type = line->type;
+                pager_line (rd, j)->color = line->color;
               }
-              *force_redraw = 1; /* the previous lines have already been drawn on the screen */
+              rd->force_redraw = 1; /* the previous lines have already been drawn on the screen */
             }
             break;
           }
@@ -972,41 +1336,46 @@ resolve_types (char *buf, char *raw, struct line_t *lineInfo, int n, int last,
     }
   }
   else if (mutt_strncmp ("\033[0m", raw, 4) == 0)	/* a little hack... */
-    lineInfo[n].type = MT_COLOR_NORMAL;
+    line->type = MT_COLOR_NORMAL;
   else if (check_attachment_marker ((char *) raw) == 0)
-    lineInfo[n].type = MT_COLOR_ATTACHMENT;
+    line->type = MT_COLOR_ATTACHMENT;
   else if (mutt_strcmp ("-- \n", buf) == 0 || mutt_strcmp ("-- \r\n", buf) == 0)
   {
     i = n + 1;
 
-    lineInfo[n].type = MT_COLOR_SIGNATURE;
-    while (i < last && check_sig (buf, lineInfo, i - 1) == 0 &&
-	   (lineInfo[i].type == MT_COLOR_NORMAL ||
-	    lineInfo[i].type == MT_COLOR_QUOTED ||
-	    lineInfo[i].type == MT_COLOR_HEADER))
+    line->type = MT_COLOR_SIGNATURE;
+    while (i < rd->lastLine && check_sig (buf, rd, i) == 0 &&
+           (next = pager_line_kept (rd, i)) != NULL &&
+	   (next->type == MT_COLOR_NORMAL ||
+	    next->type == MT_COLOR_QUOTED ||
+	    next->type == MT_COLOR_HEADER))
     {
       /* oops... */
-      if (lineInfo[i].chunks)
+      if (next->chunks)
       {
-        lineInfo[i].chunks = 0;
-        safe_realloc (&(lineInfo[n].syntax),
-                      sizeof (struct syntax_t));
+        next->chunks = 0;
+        FREE (&next->syntax);
       }
-      lineInfo[i++].type = MT_COLOR_SIGNATURE;
+      next->type = MT_COLOR_SIGNATURE;
+      i++;
     }
   }
-  else if (check_sig (buf, lineInfo, n - 1) == 0)
-    lineInfo[n].type = MT_COLOR_SIGNATURE;
+  else if (check_sig (buf, rd, n) == 0)
+    line->type = MT_COLOR_SIGNATURE;
   else if (mutt_is_quote_line (buf, pmatch))
   {
-    if (q_classify && lineInfo[n].quote == NULL)
-      lineInfo[n].quote = classify_quote (QuoteList, buf + pmatch[0].rm_so,
-                                          pmatch[0].rm_eo - pmatch[0].rm_so,
-                                          force_redraw, q_level);
-    lineInfo[n].type = MT_COLOR_QUOTED;
+    if (q_classify && line->quote == NULL)
+      line->quote = classify_quote (&rd->QuoteList, rd->QuoteHash,
+                                    buf + pmatch[0].rm_so,
+                                    pmatch[0].rm_eo - pmatch[0].rm_so,
+                                    &rd->force_redraw, &rd->q_level);
+    /* saves resolve_show_patterns() from running the regexp again */
+    else if (pmatch[0].rm_so == 0 && pmatch[0].rm_eo <= UCHAR_MAX)
+      line->quote_len = pmatch[0].rm_eo;
+    line->type = MT_COLOR_QUOTED;
   }
   else
-    lineInfo[n].type = MT_COLOR_NORMAL;
+    line->type = MT_COLOR_NORMAL;
 }
 
 static int is_ansi (const char *buf)
@@ -1129,6 +1498,7 @@ static int grok_ansi(unsigned char *buf, int pos, ansi_attr *a)
 void mutt_buffer_strip_formatting (BUFFER *dest, const char *src, int strip_markers)
 {
   const char *s = src;
+  size_t n;
 
   mutt_buffer_clear (dest);
 
@@ -1137,7 +1507,13 @@ void mutt_buffer_strip_formatting (BUFFER *dest, const char *src, int strip_mark
 
   while (*s)
   {
-    if (*s == '\010' && (s > src))
+    /* copy the text up to the next backspace or escape in one go */
+    if ((n = strcspn (s, "\010\033")) > 0)
+    {
+      mutt_buffer_addstr_n (dest, s, n);
+      s += n;
+    }
+    else if (*s == '\010' && (s > src))
     {
       if (*(s+1) == '_')	/* underline */
         s += 2;
@@ -1207,25 +1583,25 @@ fill_buffer (FILE *f, LOFF_T *last_pos, LOFF_T offset, unsigned char **buf,
  * They are separated from resolve_types() to make operations that jump
  * further down (e.g. <bottom> and <search>)) faster.
  */
-static int resolve_show_patterns (FILE *f, LOFF_T *last_pos, struct line_t *lineInfo,
-                                  int n, char *fmt, struct q_class_t **QuoteList,
-                                  int *q_level, int *force_redraw)
+static int resolve_show_patterns (pager_redraw_data_t *rd, int n, char *fmt)
 {
   char *tmp_buf = NULL, *tmp_fmt = NULL;
   size_t tmp_buflen = 0;
-  int tmp_buf_ready = 0, m, rc = -1;;
+  int tmp_buf_ready = 0, rc = -1;;
   regmatch_t pmatch[1];
+  struct line_t *line, *start;
 
   /* If it's a continuation, we need to perform quote and body_pattern
    * matching on the original line.  append_line() conveniently stores
-   * that information in the syntax[0].first field.
+   * that information in the cont_start field.
    */
-  if (lineInfo[n].continuation)
+  line = pager_line (rd, n);
+  if (line->continuation)
   {
-    m = (lineInfo[n].syntax)[0].first;
-    if (lineInfo[m].show_patterns_done == 1)
+    start = pager_line (rd, line->cont_start);
+    if (start->show_patterns_done == 1)
       goto done;
-    if (fill_buffer (f, last_pos, lineInfo[m].offset, (unsigned char **) &tmp_buf,
+    if (fill_buffer (rd->fp, &rd->last_pos, start->offset, (unsigned char **) &tmp_buf,
                      (unsigned char **) &tmp_fmt, &tmp_buflen, &tmp_buf_ready) < 0)
     {
       goto bail;
@@ -1233,33 +1609,39 @@ static int resolve_show_patterns (FILE *f, LOFF_T *last_pos, struct line_t *line
   }
   else
   {
-    m = n;
+    start = line;
     tmp_fmt = fmt;
   }
 
-  if (lineInfo[m].type == MT_COLOR_NORMAL ||
-      lineInfo[m].type == MT_COLOR_QUOTED ||
-      (lineInfo[m].type == MT_COLOR_HDEFAULT && option (OPTHEADERCOLORPARTIAL)))
+  if (start->type == MT_COLOR_NORMAL ||
+      start->type == MT_COLOR_QUOTED ||
+      (start->type == MT_COLOR_HDEFAULT && option (OPTHEADERCOLORPARTIAL)))
   {
-    match_body_patterns (tmp_fmt, lineInfo, m);
+    match_body_patterns (tmp_fmt, start);
   }
 
-  if ((lineInfo[m].type == MT_COLOR_QUOTED) &&
-      (lineInfo[m].quote == NULL))
+  if ((start->type == MT_COLOR_QUOTED) &&
+      (start->quote == NULL))
   {
-    regexec ((regex_t *) QuoteRegexp.rx, tmp_fmt, 1, pmatch, 0);
-    lineInfo[m].quote = classify_quote (QuoteList,
-                                        tmp_fmt + pmatch[0].rm_so,
-                                        pmatch[0].rm_eo - pmatch[0].rm_so,
-                                        force_redraw, q_level);
+    if (start->quote_len)
+    {
+      pmatch[0].rm_so = 0;
+      pmatch[0].rm_eo = start->quote_len;
+    }
+    else
+      regexec ((regex_t *) QuoteRegexp.rx, tmp_fmt, 1, pmatch, 0);
+    start->quote = classify_quote (&rd->QuoteList, rd->QuoteHash,
+                                   tmp_fmt + pmatch[0].rm_so,
+                                   pmatch[0].rm_eo - pmatch[0].rm_so,
+                                   &rd->force_redraw, &rd->q_level);
   }
 
 done:
-  lineInfo[n].show_patterns_done = 1;
+  line->show_patterns_done = 1;
   rc = 0;
 
 bail:
-  if (lineInfo[n].continuation)
+  if (line->continuation)
   {
     FREE (&tmp_buf);
     FREE (&tmp_fmt);
@@ -1268,7 +1650,7 @@ bail:
   return rc;
 }
 
-static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
+static int format_line (pager_redraw_data_t *rd, int n, unsigned char *buf,
 			int flags, ansi_attr *pa, int cnt,
 			int *pspace, int *pvch, int *pcol, int *pspecial,
                         mutt_window_t *pager_window)
@@ -1280,6 +1662,7 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
   wchar_t wc;
   mbstate_t mbstate;
   int wrap_cols;
+  int ascii;
 
   if ((flags & MUTT_PAGER_NOWRAP) ||
       (check_attachment_marker ((char *)buf) == 0))
@@ -1288,7 +1671,7 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
     wrap_cols = mutt_window_wrap_cols (pager_window, Wrap);
 
   if (option (OPTMARKERS) &&
-      (*lineInfo)[n].continuation &&
+      pager_line (rd, n)->continuation &&
       (wrap_cols > 1))
     col = 1;
   else
@@ -1317,25 +1700,36 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
     if (ch >= cnt)
       break;
 
-    k = mbrtowc (&wc, (char *)buf+ch, cnt-ch, &mbstate);
-    if (k == (size_t)(-2) || k == (size_t)(-1))
+    /* Printable ASCII is by far the most common case when laying out
+     * a long message, and needs no conversion. */
+    ascii = (buf[ch] >= 0x20 && buf[ch] < 0x7f && mbsinit (&mbstate));
+    if (ascii)
     {
-      if (k == (size_t)(-1))
-        memset(&mbstate, 0, sizeof(mbstate));
-      dprint (1, (debugfile, "%s:%d: mbrtowc returned %d; errno = %d.\n",
-		  __FILE__, __LINE__, k, errno));
-      if (col + 4 > wrap_cols)
-	break;
-      col += 4;
-      if (pa)
-	printw ("\\%03o", buf[ch]);
+      wc = buf[ch];
       k = 1;
-      continue;
     }
-    if (k == 0)
-      k = 1;
+    else
+    {
+      k = mbrtowc (&wc, (char *)buf+ch, cnt-ch, &mbstate);
+      if (k == (size_t)(-2) || k == (size_t)(-1))
+      {
+        if (k == (size_t)(-1))
+          memset(&mbstate, 0, sizeof(mbstate));
+        dprint (1, (debugfile, "%s:%d: mbrtowc returned %d; errno = %d.\n",
+                    __FILE__, __LINE__, k, errno));
+        if (col + 4 > wrap_cols)
+          break;
+        col += 4;
+        if (pa)
+          printw ("\\%03o", buf[ch]);
+        k = 1;
+        continue;
+      }
+      if (k == 0)
+        k = 1;
+    }
 
-    if (Charset_is_utf8)
+    if (Charset_is_utf8 && !ascii)
     {
       if (wc == 0x200B || wc == 0xFEFF)
       {
@@ -1351,7 +1745,7 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
 
     /* Handle backspace */
     special = 0;
-    if (IsWPrint (wc))
+    if (ascii ? (ch + 1 < cnt && buf[ch + 1] == '\b') : IsWPrint (wc))
     {
       wchar_t wc1;
       mbstate_t mbstate1;
@@ -1386,6 +1780,7 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
 	ch += k + k1;
 	k = k2;
 	mbstate = mbstate1;
+	ascii = 0;
         k1 = mbrtowc (&wc1, (char *)buf+ch+k, cnt-ch-k, &mbstate1);
       }
     }
@@ -1394,15 +1789,15 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
 	((flags & (MUTT_SHOWCOLOR | MUTT_SEARCH | MUTT_PAGER_MARKER)) ||
 	 special || last_special || pa->attr))
     {
-      resolve_color (*lineInfo, n, vch, flags, special, pa, wrap_cols);
+      resolve_color (rd, n, vch, flags, special, pa, wrap_cols);
       last_special = special;
     }
 
-    if (IsWPrint (wc) || (Charset_is_utf8 && wc == 0x00A0))
+    if (ascii || IsWPrint (wc) || (Charset_is_utf8 && wc == 0x00A0))
     {
       if (wc == ' ')
 	space = ch;
-      t = wcwidth (wc);
+      t = ascii ? 1 : wcwidth (wc);
       if (col + t > wrap_cols)
 	break;
       col += t;
@@ -1455,6 +1850,33 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
   return ch;
 }
 
+static void resolve_search (struct line_t *line, char *fmt, regex_t *SearchRE)
+{
+  regmatch_t pmatch[1];
+  int offset = 0;
+
+  line->search_cnt = 0;
+  while (regexec (SearchRE, fmt + offset, 1, pmatch, (offset ? REG_NOTBOL : 0)) == 0)
+  {
+    if (++line->search_cnt > 1)
+      safe_realloc (&line->search,
+                    line->search_cnt * sizeof (struct syntax_t));
+    else
+      line->search = safe_malloc (sizeof (struct syntax_t));
+    pmatch[0].rm_so += offset;
+    pmatch[0].rm_eo += offset;
+    line->search[line->search_cnt - 1].first = pmatch[0].rm_so;
+    line->search[line->search_cnt - 1].last = pmatch[0].rm_eo;
+
+    if (pmatch[0].rm_eo == pmatch[0].rm_so)
+      offset++; /* avoid degenerate cases */
+    else
+      offset = pmatch[0].rm_eo;
+    if (!fmt[offset])
+      break;
+  }
+}
+
 /*
  * Args:
  *	flags	MUTT_SHOWFLAT, show characters (used for displaying help)
@@ -1473,10 +1895,7 @@ static int format_line (struct line_t **lineInfo, int n, unsigned char *buf,
  */
 
 static int
-display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
-	      int *last, int *max, int flags, struct q_class_t **QuoteList,
-	      int *q_level, int *force_redraw, regex_t *SearchRE,
-              mutt_window_t *pager_window)
+display_line (pager_redraw_data_t *rd, int n, int flags)
 {
   unsigned char *buf = NULL, *fmt = NULL;
   size_t buflen = 0;
@@ -1484,137 +1903,141 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
   int ch, vch, col, cnt, b_read;
   int buf_ready = 0, change_last = 0;
   int special;
-  int offset;
   COLOR_ATTR def_color;
   int m;
   int rc = -1;
   ansi_attr a = {0,-1,-1,-1};
-  regmatch_t pmatch[1];
+  struct line_t *line, *next;
 
-  if (n == *last)
+  if (n == rd->lastLine)
   {
-    (*last)++;
+    rd->lastLine++;
     change_last = 1;
   }
 
-  if (*last == *max)
+  /* Lay out the blocks of this line and the one it continues before
+   * reading it: that reads other lines. */
+  line = pager_line (rd, n);
+  if (line->continuation)
   {
-    safe_realloc (lineInfo, sizeof (struct line_t) * (*max += LINES));
-    for (ch = *last; ch < *max ; ch++)
-    {
-      memset (&((*lineInfo)[ch]), 0, sizeof (struct line_t));
-      (*lineInfo)[ch].type = -1;
-      (*lineInfo)[ch].search_cnt = -1;
-      (*lineInfo)[ch].syntax = safe_malloc (sizeof (struct syntax_t));
-      ((*lineInfo)[ch].syntax)[0].first = ((*lineInfo)[ch].syntax)[0].last = -1;
-    }
+    pager_line (rd, line->cont_start);
+    line = pager_line (rd, n);
+  }
+
+  /* the end of the file, or as far as it is written yet */
+  if (line->offset >= rd->sb.st_size)
+  {
+    if (change_last)
+      rd->lastLine--;
+    goto out;
   }
 
   /* only do color hiliting if we are viewing a message */
   if (flags & (MUTT_SHOWCOLOR | MUTT_TYPES))
   {
-    if ((*lineInfo)[n].type == -1)
+    if (line->type == -1)
     {
       /* determine the line class */
-      if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+      if (fill_buffer (rd->fp, &rd->last_pos, line->offset, &buf, &fmt, &buflen, &buf_ready) < 0)
       {
 	if (change_last)
-	  (*last)--;
+	  rd->lastLine--;
 	goto out;
       }
 
-      resolve_types ((char *) fmt, (char *) buf, *lineInfo, n, *last,
-                     QuoteList, q_level, force_redraw, flags & MUTT_SHOWCOLOR);
+      resolve_types ((char *) fmt, (char *) buf, rd, n, flags & MUTT_SHOWCOLOR);
 
       /* avoid race condition for continuation lines when scrolling up */
-      for (m = n + 1; m < *last && (*lineInfo)[m].offset && (*lineInfo)[m].continuation; m++)
-	(*lineInfo)[m].type = (*lineInfo)[n].type;
+      for (m = n + 1; m < rd->lastLine && (next = pager_line_kept (rd, m)) &&
+             next->offset && next->continuation; m++)
+	next->type = line->type;
     }
 
     /* this also prevents searching through the hidden lines */
-    if ((flags & MUTT_HIDE) && (*lineInfo)[n].type == MT_COLOR_QUOTED)
+    if ((flags & MUTT_HIDE) && line->type == MT_COLOR_QUOTED)
       flags = 0; /* MUTT_NOSHOW */
   }
 
   if ((flags & MUTT_SHOWCOLOR) &&
-      !(*lineInfo)[n].show_patterns_done)
+      !line->show_patterns_done)
   {
-    if (!(*lineInfo)[n].continuation)
+    if (!line->continuation)
     {
-      if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen,
+      if (fill_buffer (rd->fp, &rd->last_pos, line->offset, &buf, &fmt, &buflen,
                        &buf_ready) < 0)
       {
         if (change_last)
-          (*last)--;
+          rd->lastLine--;
         goto out;
       }
     }
 
-    if (resolve_show_patterns (f, last_pos, *lineInfo, n, (char *)fmt,
-                               QuoteList, q_level, force_redraw) < 0)
+    if (resolve_show_patterns (rd, n, (char *)fmt) < 0)
     {
       if (change_last)
-        (*last)--;
+        rd->lastLine--;
       goto out;
     }
   }
 
-  if ((flags & MUTT_SEARCH) && !(*lineInfo)[n].continuation && (*lineInfo)[n].search_cnt == -1)
+  m = line->continuation ? line->cont_start : n;
+  if ((flags & MUTT_SEARCH) && pager_line (rd, m)->search_cnt == -1)
   {
-    if (fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+    if (m == n)
     {
-      if (change_last)
-	(*last)--;
-      goto out;
+      if (fill_buffer (rd->fp, &rd->last_pos, line->offset, &buf, &fmt, &buflen, &buf_ready) < 0)
+      {
+        if (change_last)
+          rd->lastLine--;
+        goto out;
+      }
+      resolve_search (line, (char *) fmt, &rd->SearchRE);
     }
-
-    offset = 0;
-    (*lineInfo)[n].search_cnt = 0;
-    while (regexec (SearchRE, (char *) fmt + offset, 1, pmatch, (offset ? REG_NOTBOL : 0)) == 0)
+    else
     {
-      if (++((*lineInfo)[n].search_cnt) > 1)
-	safe_realloc (&((*lineInfo)[n].search),
-		      ((*lineInfo)[n].search_cnt) * sizeof (struct syntax_t));
-      else
-	(*lineInfo)[n].search = safe_malloc (sizeof (struct syntax_t));
-      pmatch[0].rm_so += offset;
-      pmatch[0].rm_eo += offset;
-      ((*lineInfo)[n].search)[(*lineInfo)[n].search_cnt - 1].first = pmatch[0].rm_so;
-      ((*lineInfo)[n].search)[(*lineInfo)[n].search_cnt - 1].last = pmatch[0].rm_eo;
-
-      if (pmatch[0].rm_eo == pmatch[0].rm_so)
-	offset++; /* avoid degenerate cases */
-      else
-	offset = pmatch[0].rm_eo;
-      if (!fmt[offset])
-	break;
+      /* A search jump may have laid out the line this one continues
+       * without searching it.  Its matches are needed to highlight
+       * this part of it. */
+      unsigned char *tmp_buf = NULL, *tmp_fmt = NULL;
+      size_t tmp_buflen = 0;
+      int tmp_buf_ready = 0;
+
+      if (fill_buffer (rd->fp, &rd->last_pos, pager_line (rd, m)->offset, &tmp_buf,
+                       &tmp_fmt, &tmp_buflen, &tmp_buf_ready) >= 0)
+        resolve_search (pager_line (rd, m), (char *) tmp_fmt, &rd->SearchRE);
+      FREE (&tmp_buf);
+      FREE (&tmp_fmt);
     }
   }
 
-  if (!(flags & MUTT_SHOW) && (*lineInfo)[n+1].offset > 0)
+  /* The next line is only laid out when this one is new, or when its
+   * block is being laid out again.  A block that was let go after
+   * being laid out isn't needed for that. */
+  if (!(flags & MUTT_SHOW) && !change_last &&
+      (!(next = pager_line_kept (rd, n + 1)) || next->offset > 0))
   {
     /* we've already scanned this line, so just exit */
     rc = 0;
     goto out;
   }
-  if ((flags & MUTT_SHOWCOLOR) && *force_redraw && (*lineInfo)[n+1].offset > 0)
+  if ((flags & MUTT_SHOWCOLOR) && rd->force_redraw && !change_last)
   {
     /* no need to try to display this line... */
     rc = 1;
     goto out; /* fake display */
   }
 
-  if ((b_read = fill_buffer (f, last_pos, (*lineInfo)[n].offset, &buf, &fmt,
+  if ((b_read = fill_buffer (rd->fp, &rd->last_pos, line->offset, &buf, &fmt,
 			     &buflen, &buf_ready)) < 0)
   {
     if (change_last)
-      (*last)--;
+      rd->lastLine--;
     goto out;
   }
 
   /* now chose a good place to break the line */
-  cnt = format_line (lineInfo, n, buf, flags, 0, b_read, &ch, &vch, &col, &special,
-                     pager_window);
+  cnt = format_line (rd, n, buf, flags, 0, b_read, &ch, &vch, &col, &special,
+                     rd->pager_window);
   buf_ptr = buf + cnt;
 
   /* move the break point only if smart_wrap is set */
@@ -1649,9 +2072,13 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
   if (*buf_ptr == '\n')
     buf_ptr++;
 
-  if ((int) (buf_ptr - buf) < b_read && !(*lineInfo)[n+1].continuation)
-    append_line (*lineInfo, n, (int) (buf_ptr - buf));
-  (*lineInfo)[n+1].offset = (*lineInfo)[n].offset + (long) (buf_ptr - buf);
+  if ((next = pager_line_kept (rd, n + 1)) != NULL)
+  {
+    line = pager_line (rd, n);
+    if ((int) (buf_ptr - buf) < b_read && !next->continuation)
+      append_line (line, next, n);
+    next->offset = line->offset + (long) (buf_ptr - buf);
+  }
 
   /* if we don't need to display the line we are done */
   if (!(flags & MUTT_SHOW))
@@ -1661,8 +2088,8 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
   }
 
   /* display the line */
-  format_line (lineInfo, n, buf, flags, &a, cnt, &ch, &vch, &col, &special,
-               pager_window);
+  format_line (rd, n, buf, flags, &a, cnt, &ch, &vch, &col, &special,
+               rd->pager_window);
 
   /* avoid a bug in ncurses... */
 #ifndef USE_SLANG_CURSES
@@ -1676,9 +2103,9 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
   /* end the last color pattern (needed by S-Lang) */
   if (special ||
       a.attr ||
-      (col != pager_window->cols && (flags & (MUTT_SHOWCOLOR | MUTT_SEARCH))))
+      (col != rd->pager_window->cols && (flags & (MUTT_SHOWCOLOR | MUTT_SEARCH))))
   {
-    resolve_color (*lineInfo, n, vch, flags, 0, &a, 0);
+    resolve_color (rd, n, vch, flags, 0, &a, 0);
   }
 
   /*
@@ -1688,17 +2115,19 @@ display_line (FILE *f, LOFF_T *last_pos, struct line_t **lineInfo, int n,
    */
   if (flags & MUTT_SHOWCOLOR)
   {
-    m = ((*lineInfo)[n].continuation) ? ((*lineInfo)[n].syntax)[0].first : n;
-    if ((*lineInfo)[m].type == MT_COLOR_HEADER)
-      def_color = ((*lineInfo)[m].syntax)[0].color;
+    line = pager_line (rd, n);
+    if (line->continuation)
+      line = pager_line (rd, line->cont_start);
+    if (line->type == MT_COLOR_HEADER)
+      def_color = line->color;
     else
-      def_color = ColorDefs[ (*lineInfo)[m].type ];
+      def_color = ColorDefs[line->type];
 
     ATTRSET(def_color);
   }
 
-  if (col < pager_window->cols)
-    mutt_window_clrtoeol (pager_window);
+  if (col < rd->pager_window->cols)
+    mutt_window_clrtoeol (rd->pager_window);
 
   /*
    * reset the color back to normal.  This *must* come after the
@@ -1721,12 +2150,12 @@ out:
 }
 
 static int
-upNLines (int nlines, struct line_t *info, int cur, int hiding)
+upNLines (int nlines, pager_redraw_data_t *rd, int cur, int hiding)
 {
   while (cur > 0 && nlines > 0)
   {
     cur--;
-    if (!hiding || info[cur].type != MT_COLOR_QUOTED)
+    if (!hiding || pager_line (rd, cur)->type != MT_COLOR_QUOTED)
       nlines--;
   }
 
@@ -1753,41 +2182,327 @@ void mutt_clear_pager_position (void)
   OldHdr = NULL;
 }
 
-typedef struct
+/* A new search pattern scans the file once, in large blocks, and keeps
+ * the offsets of the matching lines, in file order, in SearchMatches.
+ * The message is only laid out as far as a search jumps; display_line()
+ * still highlights the matches of the lines it shows.
+ */
+
+#define SEARCH_BLOCK (64 * 1024)
+
+/* If the search pattern is a plain string, returns its length, else 0.
+ * For a case-insensitive search only ASCII strings qualify.
+ */
+static size_t search_literal_len (const char *pat, int icase)
 {
-  int flags;
-  pager_t *extra;
-  int indexlen;
-  int indicator;                /* the indicator line of the PI */
-  int oldtopline;
-  int lines;
-  int maxLine;
-  int lastLine;
-  int curline;
-  int topline;
-  int force_redraw;
-  int has_types;
-  int hideQuoted;
-  int q_level;
-  struct q_class_t *QuoteList;
-  LOFF_T last_pos;
-  LOFF_T last_offset;
-  mutt_window_t *index_status_window;
-  mutt_window_t *index_window;
-  mutt_window_t *pager_status_window;
-  mutt_window_t *pager_window;
-  MUTTMENU *index;		/* the Pager Index (PI) */
-  regex_t SearchRE;
-  int SearchCompiled;
-  int SearchFlag;
-  int SearchBack;
-  const char *banner;
-  const char *helpstr;
-  char *searchbuf;
-  struct line_t *lineInfo;
-  FILE *fp;
-  struct stat sb;
-} pager_redraw_data_t;
+  const char *p;
+
+  for (p = pat; *p; p++)
+    if (strchr ("\\^$.[]|()*+?{}", *p) ||
+        (icase && (unsigned char) *p >= 0x80))
+      return 0;
+
+  return p - pat;
+}
+
+static char *search_next_byte (char *s, char *end, int c)
+{
+  char *p;
+
+  if ((p = memchr (s, c, end - s)) == NULL)
+    return end;
+  return p;
+}
+
+static int search_line_matches (regex_t *rx, char *line, char *eol,
+                                BUFFER *stripped)
+{
+  char c = *eol;
+  int rc;
+
+  *eol = 0;
+  if (line[strcspn (line, "\010\033")])
+  {
+    mutt_buffer_strip_formatting (stripped, line, 1);
+    rc = regexec (rx, mutt_b2s (stripped), 0, NULL, 0);
+  }
+  else
+    rc = regexec (rx, line, 0, NULL, 0);
+  *eol = c;
+
+  return rc == 0;
+}
+
+/* Indexes the matches from file offset from on, which is 0 for a new
+ * pattern. */
+static void pager_search_index (pager_redraw_data_t *rd, LOFF_T from)
+{
+  const char *lit = rd->searchbuf;
+  char *block, *end, *p, *q, *s, *eol;
+  char *lo = NULL, *up = NULL, *bs = NULL, *esc = NULL;
+  size_t size = SEARCH_BLOCK, have = 0, want, n, len;
+  LOFF_T base = from;
+  int icase, eof = 0;
+  BUFFER *stripped;
+
+  if (!from)
+  {
+    rd->SearchMatchCount = 0;
+    rd->SearchMatchCur = 0;
+  }
+
+  icase = mutt_which_case (lit) & REG_ICASE;
+  len = search_literal_len (lit, icase);
+
+  block = safe_malloc (size + 1);
+  stripped = mutt_buffer_pool_get ();
+  fseeko (rd->fp, from, SEEK_SET);
+
+  while (!eof)
+  {
+    if (have == size)
+      safe_realloc (&block, (size *= 2) + 1);
+    want = size - have;
+    /* a file still being written is only read as far as sb.st_size */
+    if ((LOFF_T) want >= rd->sb.st_size - base - (LOFF_T) have)
+    {
+      want = rd->sb.st_size - base - have;
+      eof = 1;
+    }
+    if ((n = fread (block + have, 1, want, rd->fp)) < want)
+      eof = 1;
+    have += n;
+
+    /* scan whole lines only, the rest is kept for the next round */
+    end = block + have;
+    if (!eof)
+    {
+      while (end > block && end[-1] != '\n')
+        end--;
+      if (end == block)
+        continue;
+    }
+
+    lo = up = bs = esc = NULL;
+    for (p = block; p < end; p = eol)
+    {
+      if (len)
+      {
+        /* Skip to the next line holding the string, or formatting which
+         * has to be stripped before it can be matched. */
+        for (s = p; ; s = q + 1)
+        {
+          if (!lo || lo < s)
+            lo = search_next_byte (s, end, icase ? ascii_tolower (*lit) : *lit);
+          if (!up || up < s)
+            up = icase ? search_next_byte (s, end, ascii_toupper (*lit)) : end;
+          if (!bs || bs < s)
+            bs = search_next_byte (s, end, '\010');
+          if (!esc || esc < s)
+            esc = search_next_byte (s, end, '\033');
+
+          q = MIN (MIN (lo, up), MIN (bs, esc));
+          if (q == end || q == bs || q == esc ||
+              ((size_t) (end - q) >= len &&
+               !(icase ? ascii_strncasecmp (q, lit, len) : memcmp (q, lit, len))))
+            break;
+        }
+        if (q == end)
+          break;
+        while (q > p && q[-1] != '\n')
+          q--;
+        p = q;
+      }
+
+      if ((eol = memchr (p, '\n', end - p)) != NULL)
+        eol++;
+      else
+        eol = end;
+
+      if (search_line_matches (&rd->SearchRE, p, eol, stripped))
+      {
+        if (rd->SearchMatchCount == rd->SearchMatchMax)
+          safe_realloc (&rd->SearchMatches,
+                        (rd->SearchMatchMax += MAX (rd->SearchMatchMax, 64)) *
+                        sizeof (LOFF_T));
+        rd->SearchMatches[rd->SearchMatchCount++] = base + (p - block);
+      }
+    }
+
+    memmove (block, end, have - (end - block));
+    have -= end - block;
+    base += end - block;
+  }
+
+  mutt_buffer_pool_release (&stripped);
+  FREE (&block);
+  fseeko (rd->fp, rd->last_pos, SEEK_SET);
+}
+
+/* With $pager_stream the file is still being written by the child that
+ * renders the message, see render_message_start() in commands.c.  Until
+ * it is done, sb.st_size only reaches as far as the complete lines
+ * written so far, and the pager looks for more every PAGER_STREAM_POLL
+ * milliseconds.
+ */
+
+#define PAGER_STREAM_POLL 100
+
+/* Makes what the child wrote since the last call visible, and reaps it
+ * once it is done.  Returns 1 if there is more to show.
+ */
+static int pager_stream_update (pager_redraw_data_t *rd)
+{
+  char buf[STRING];
+  struct stat st;
+  LOFF_T old = rd->sb.st_size, size;
+  size_t chunk;
+  ssize_t n;
+  int done = 0;
+
+  FOREVER
+  {
+    n = read (rd->stream_fd, buf, sizeof (buf));
+    if (n > 0)
+    {
+      rd->stream_rc = buf[n - 1] - '0';
+      continue;
+    }
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      done = 1;
+    break;
+  }
+
+  /* the child writes the whole file before its result */
+  if (fstat (fileno (rd->fp), &st) == 0 && st.st_size > old)
+  {
+    size = st.st_size;
+    while (!done && size > old)
+    {
+      chunk = MIN (size - old, (LOFF_T) sizeof (buf));
+      if (fseeko (rd->fp, size - chunk, SEEK_SET) != 0 ||
+          fread (buf, 1, chunk, rd->fp) != chunk)
+      {
+        size = old;
+        break;
+      }
+      for (n = chunk; n > 0 && buf[n - 1] != '\n'; n--)
+        ;
+      size -= chunk - n;
+      if (n > 0)
+        break;
+    }
+    rd->sb.st_size = size;
+  }
+  /* this also forgets the end of file fill_buffer() may have seen */
+  fseeko (rd->fp, rd->last_pos, SEEK_SET);
+
+  if (rd->SearchCompiled && rd->sb.st_size > old)
+    pager_search_index (rd, old);
+
+  if (done)
+  {
+    close (rd->stream_fd);
+    /* it may have been reaped by mutt_background_process_waitpid() */
+    waitpid (rd->stream_pid, NULL, 0);
+    rd->stream_pid = 0;
+
+    if (rd->stream_rc == 1)
+      mutt_error (_("There was an error displaying all or part of the message"));
+    else if (rd->stream_rc != 0)
+      mutt_error (_("Could not copy message"));
+  }
+
+  return rd->sb.st_size > old;
+}
+
+/* Stops the child when the pager is left before it is done. */
+static void pager_stream_stop (pager_redraw_data_t *rd)
+{
+  /* its process group also holds the commands it runs, once it has
+   * got as far as creating it */
+  if (kill (-rd->stream_pid, SIGTERM) == -1)
+    kill (rd->stream_pid, SIGTERM);
+  close (rd->stream_fd);
+  waitpid (rd->stream_pid, NULL, 0);
+  rd->stream_pid = 0;
+}
+
+/* Lays out the message up to the line starting at file offset pos, and
+ * returns that line's index, or -1 if there is none.
+ */
+static int pager_line_at (pager_redraw_data_t *rd, LOFF_T pos, int flags)
+{
+  struct line_block_t *blk;
+  struct line_t *line;
+  int lo = 0, hi, mid;
+
+  while (pager_line (rd, rd->lastLine)->offset <= pos &&
+         display_line (rd, rd->lastLine, flags) == 0)
+    ;
+
+  /* the block the line would be in, by the offset of its first line */
+  hi = (rd->lastLine - 1) / LINE_BLOCK;
+  while (lo < hi)
+  {
+    mid = (lo + hi + 1) / 2;
+    blk = &rd->lineBlocks[mid];
+    if ((blk->lines ? blk->lines[0].offset : blk->first.offset) <= pos)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  hi = MIN ((lo + 1) * LINE_BLOCK, rd->lastLine) - 1;
+  lo *= LINE_BLOCK;
+  while (lo <= hi)
+  {
+    mid = (lo + hi) / 2;
+    line = pager_line (rd, mid);
+    if (line->offset < pos)
+      lo = mid + 1;
+    else if (line->offset > pos)
+      hi = mid - 1;
+    else
+      return line->continuation ? -1 : mid;
+  }
+  return -1;
+}
+
+/* Finds the first match at or after file offset pos, or with back set,
+ * the last one at or before it, skipping hidden quoted lines.  Returns
+ * its line index and sets SearchMatchCur, or returns -1.
+ */
+static int pager_search_find (pager_redraw_data_t *rd, LOFF_T pos, int back,
+                              int flags)
+{
+  int lo = 0, hi = rd->SearchMatchCount, mid, i;
+
+  /* lo is the first match at or after pos */
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (rd->SearchMatches[mid] < pos)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (back && (lo == rd->SearchMatchCount || rd->SearchMatches[lo] > pos))
+    lo--;
+
+  for (; lo >= 0 && lo < rd->SearchMatchCount; lo += back ? -1 : 1)
+  {
+    if ((i = pager_line_at (rd, rd->SearchMatches[lo], flags)) < 0)
+      continue;
+    if (rd->hideQuoted && pager_line (rd, i)->type == MT_COLOR_QUOTED)
+      continue;
+    rd->SearchMatchCur = lo + 1;
+    return i;
+  }
+  return -1;
+}
 
 static void pager_menu_redraw (MUTTMENU *pager_menu)
 {
@@ -1807,6 +2522,9 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
     /* clear() doesn't optimize screen redraws */
     move (0, 0);
     clrtobot ();
+#ifdef USE_SIDEBAR
+    mutt_sb_invalidate ();
+#endif
 
     if (IsHeader (rd->extra) && Context->vcount + 1 < PagerIndexLines)
       rd->indexlen = Context->vcount + 1;
@@ -1870,6 +2588,10 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
         {
           rd->SearchFlag = MUTT_SEARCH;
           rd->SearchBack = Resize->SearchBack;
+          pager_search_index (rd, 0);
+          /* the file didn't change, so neither did the matches */
+          if (Resize->SearchMatchCur <= rd->SearchMatchCount)
+            rd->SearchMatchCur = Resize->SearchMatchCur;
         }
       }
       rd->lines = Resize->line;
@@ -1919,51 +2641,21 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
   {
     if (!(rd->flags & MUTT_PAGER_RETWINCH))
     {
-      rd->lines = -1;
-      for (i = 0; i <= rd->topline; i++)
-        if (!rd->lineInfo[i].continuation)
-          rd->lines++;
-      for (i = 0; i < rd->maxLine; i++)
-      {
-        rd->lineInfo[i].offset = 0;
-        rd->lineInfo[i].type = -1;
-        rd->lineInfo[i].chunks = 0;
-        rd->lineInfo[i].search_cnt = -1;
-        rd->lineInfo[i].continuation = 0;
-        rd->lineInfo[i].is_cont_hdr = 0;
-        rd->lineInfo[i].show_patterns_done = 0;
-        rd->lineInfo[i].quote = NULL;
-
-        safe_realloc (&(rd->lineInfo[i].syntax),
-                      sizeof (struct syntax_t));
-        if (rd->SearchCompiled && rd->lineInfo[i].search)
-          FREE (&(rd->lineInfo[i].search));
-      }
-
-      rd->lastLine = 0;
+      rd->lines = pager_hard_lines (rd, rd->topline) - 1;
+      reset_lines (rd);
       rd->topline = 0;
     }
     i = -1;
     j = -1;
-    while (display_line (rd->fp, &rd->last_pos, &rd->lineInfo, ++i, &rd->lastLine, &rd->maxLine,
-                         rd->has_types | rd->SearchFlag | (rd->flags & MUTT_PAGER_NOWRAP),
-                         &rd->QuoteList, &rd->q_level, &rd->force_redraw,
-                         &rd->SearchRE, rd->pager_window) == 0)
-      if (!rd->lineInfo[i].continuation && ++j == rd->lines)
+    while (display_line (rd, ++i,
+                         rd->has_types | rd->SearchFlag | (rd->flags & MUTT_PAGER_NOWRAP)) == 0)
+      if (!pager_line (rd, i)->continuation && ++j == rd->lines)
       {
         rd->topline = i;
-        if (!rd->SearchFlag)
-          break;
+        break;
       }
   }
 
-#ifdef USE_SIDEBAR
-  if (pager_menu->redraw & REDRAW_SIDEBAR)
-  {
-    menu_redraw_sidebar (pager_menu);
-  }
-#endif
-
   if ((pager_menu->redraw & REDRAW_BODY) || rd->topline != rd->oldtopline)
   {
     do
@@ -1974,18 +2666,15 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
       rd->force_redraw = 0;
 
       while (rd->lines < rd->pager_window->rows &&
-             rd->lineInfo[rd->curline].offset <= rd->sb.st_size - 1)
+             pager_line (rd, rd->curline)->offset <= rd->sb.st_size - 1)
       {
-        if (display_line (rd->fp, &rd->last_pos, &rd->lineInfo, rd->curline, &rd->lastLine,
-                          &rd->maxLine,
-                          (rd->flags & MUTT_DISPLAYFLAGS) | rd->hideQuoted | rd->SearchFlag | (rd->flags & MUTT_PAGER_NOWRAP),
-                          &rd->QuoteList, &rd->q_level, &rd->force_redraw, &rd->SearchRE,
-                          rd->pager_window) > 0)
+        if (display_line (rd, rd->curline,
+                          (rd->flags & MUTT_DISPLAYFLAGS) | rd->hideQuoted | rd->SearchFlag | (rd->flags & MUTT_PAGER_NOWRAP)) > 0)
           rd->lines++;
         rd->curline++;
         mutt_window_move (rd->pager_window, rd->lines, 0);
       }
-      rd->last_offset = rd->lineInfo[rd->curline].offset;
+      rd->last_offset = pager_line (rd, rd->curline)->offset;
     } while (rd->force_redraw);
 
     SETCOLOR (MT_COLOR_TILDE);
@@ -2008,16 +2697,25 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
   if (pager_menu->redraw & REDRAW_STATUS)
   {
     struct hdr_format_info hfi;
-    char pager_progress_str[4];
+    char pager_progress_str[SHORT_STRING];
+    char pager_search_str[SHORT_STRING];
 
     hfi.ctx = Context;
     hfi.pager_progress = pager_progress_str;
+    hfi.pager_search = pager_search_str;
 
     if (rd->last_pos < rd->sb.st_size - 1)
       snprintf(pager_progress_str, sizeof(pager_progress_str), OFF_T_FMT "%%", (100 * rd->last_offset / rd->sb.st_size));
     else
       strfcpy(pager_progress_str, (rd->topline == 0) ? "all" : "end", sizeof(pager_progress_str));
 
+    /* which of the search matches was jumped to last */
+    if (rd->SearchFlag && rd->SearchMatchCur)
+      snprintf (pager_search_str, sizeof (pager_search_str), "%d/%d",
+                rd->SearchMatchCur, rd->SearchMatchCount);
+    else
+      pager_search_str[0] = 0;
+
     /* print out the pager status bar */
     mutt_window_move (rd->pager_status_window, 0, 0);
     SETCOLOR (MT_COLOR_STATUS);
@@ -2033,7 +2731,11 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
     else
     {
       char bn[STRING];
-      snprintf (bn, sizeof (bn), "%s (%s)", rd->banner, pager_progress_str);
+      if (pager_search_str[0])
+        snprintf (bn, sizeof (bn), "%s (%s [%s])", rd->banner,
+                  pager_progress_str, pager_search_str);
+      else
+        snprintf (bn, sizeof (bn), "%s (%s)", rd->banner, pager_progress_str);
       mutt_paddstr (rd->pager_status_window->cols, bn);
     }
     NORMAL_COLOR;
@@ -2062,6 +2764,14 @@ static void pager_menu_redraw (MUTTMENU *pager_menu)
     NORMAL_COLOR;
   }
 
+#ifdef USE_SIDEBAR
+  /* Drawn after the status lines, which may update mailbox counts. */
+  if (pager_menu->redraw & REDRAW_SIDEBAR)
+  {
+    menu_redraw_sidebar (pager_menu);
+  }
+#endif
+
   pager_menu->redraw = 0;
 }
 
@@ -2079,6 +2789,8 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   int i, ch = 0, rc = -1;
   int err, first = 1;
   int r = -1, wrapped = 0, searchctx = 0;
+  LOFF_T pos;
+  event_t event;
 
   MUTTMENU *pager_menu = NULL;
   int old_PagerIndexLines;		/* some people want to resize it
@@ -2097,10 +2809,18 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   rd.indicator = rd.indexlen / 3;
   rd.searchbuf = searchbuf;
   rd.has_types = (IsHeader(extra) || (flags & MUTT_SHOWCOLOR)) ? MUTT_TYPES : 0; /* main message or rfc822 attachment */
+  if (extra && extra->stream_pid > 0)
+  {
+    rd.stream_pid = extra->stream_pid;
+    rd.stream_fd = extra->stream_fd;
+    rd.stream_rc = -1;
+  }
 
   if ((rd.fp = fopen (fname, "r")) == NULL)
   {
     mutt_perror (fname);
+    if (rd.stream_pid)
+      pager_stream_stop (&rd);
     return (-1);
   }
 
@@ -2108,10 +2828,18 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   {
     mutt_perror (fname);
     safe_fclose (&rd.fp);
+    if (rd.stream_pid)
+      pager_stream_stop (&rd);
     return (-1);
   }
   unlink (fname);
 
+  if (rd.stream_pid)
+  {
+    rd.sb.st_size = 0;
+    pager_stream_update (&rd);
+  }
+
   /* Initialize variables */
 
   if (IsHeader (extra) && !extra->hdr->read)
@@ -2120,15 +2848,8 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 //    mutt_set_flag (Context, extra->hdr, MUTT_READ, 1);
   }
 
-  rd.lineInfo = safe_malloc (sizeof (struct line_t) * (rd.maxLine = LINES));
-  for (i = 0 ; i < rd.maxLine ; i++)
-  {
-    memset (&rd.lineInfo[i], 0, sizeof (struct line_t));
-    rd.lineInfo[i].type = -1;
-    rd.lineInfo[i].search_cnt = -1;
-    rd.lineInfo[i].syntax = safe_malloc (sizeof (struct syntax_t));
-    (rd.lineInfo[i].syntax)[0].first = (rd.lineInfo[i].syntax)[0].last = -1;
-  }
+  reset_lines (&rd);
+  rd.QuoteHash = hash_create (64, 0);
 
   helpstr = mutt_buffer_new ();
   mutt_compile_help (buffer, sizeof (buffer), MENU_PAGER, PagerHelp);
@@ -2161,6 +2882,9 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
   {
     mutt_curs_set (0);
 
+    if (rd.stream_pid && pager_stream_update (&rd))
+      pager_menu->redraw |= REDRAW_BODY | REDRAW_STATUS;
+
     pager_menu_redraw (pager_menu);
 
     if (option(OPTBRAILLEFRIENDLY))
@@ -2177,7 +2901,7 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
     mutt_refresh ();
 
     if (IsHeader (extra) && OldHdr == extra->hdr && TopLine != rd.topline
-        && rd.lineInfo[rd.curline].offset < rd.sb.st_size-1)
+        && pager_line (&rd, rd.curline)->offset < rd.sb.st_size-1)
     {
       if (TopLine - rd.topline > rd.lines)
         rd.topline += rd.lines;
@@ -2198,16 +2922,14 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
       if (flags & MUTT_PAGER_RETWINCH)
       {
         /* Store current position. */
-        rd.lines = -1;
-        for (i = 0; i <= rd.topline; i++)
-          if (!rd.lineInfo[i].continuation)
-            rd.lines++;
+        rd.lines = pager_hard_lines (&rd, rd.topline) - 1;
 
 	Resize = safe_malloc (sizeof (struct resize));
 
 	Resize->line = rd.lines;
 	Resize->SearchCompiled = rd.SearchCompiled;
 	Resize->SearchBack = rd.SearchBack;
+	Resize->SearchMatchCur = rd.SearchMatchCur;
 
 	ch = -1;
 	rc = OP_REFORMAT_WINCH;
@@ -2222,6 +2944,17 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
     }
 #endif
 
+    if (rd.stream_pid)
+    {
+      /* look at the file again unless a key comes first */
+      mutt_getch_timeout (PAGER_STREAM_POLL);
+      event = mutt_getch ();
+      mutt_getch_timeout (-1);
+      if (event.ch < 0)
+	continue;
+      mutt_unget_event (event.ch, event.op);
+    }
+
     ch = km_dokey (MENU_PAGER);
     if (ch >= 0)
       mutt_clear_error ();
@@ -2252,10 +2985,12 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 	break;
 
       case OP_NEXT_PAGE:
-	if (rd.lineInfo[rd.curline].offset < rd.sb.st_size-1)
+	if (pager_line (&rd, rd.curline)->offset < rd.sb.st_size-1)
 	{
-	  rd.topline = upNLines (PagerContext, rd.lineInfo, rd.curline, rd.hideQuoted);
+	  rd.topline = upNLines (PagerContext, &rd, rd.curline, rd.hideQuoted);
 	}
+	else if (rd.stream_pid)
+	  mutt_error _("The rest of the message is still being decoded.");
 	else if (option (OPTPAGERSTOP))
 	{
 	  /* emulate "less -q" and don't go on to the next message. */
@@ -2272,19 +3007,19 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
       case OP_PREV_PAGE:
 	if (rd.topline != 0)
 	{
-	  rd.topline = upNLines (rd.pager_window->rows-PagerContext, rd.lineInfo, rd.topline, rd.hideQuoted);
+	  rd.topline = upNLines (rd.pager_window->rows-PagerContext, &rd, rd.topline, rd.hideQuoted);
 	}
 	else
 	  mutt_error _("Top of message is shown.");
 	break;
 
       case OP_NEXT_LINE:
-	if (rd.lineInfo[rd.curline].offset < rd.sb.st_size-1)
+	if (pager_line (&rd, rd.curline)->offset < rd.sb.st_size-1)
 	{
 	  rd.topline++;
 	  if (rd.hideQuoted)
 	  {
-	    while (rd.lineInfo[rd.topline].type == MT_COLOR_QUOTED &&
+	    while (pager_line (&rd, rd.topline)->type == MT_COLOR_QUOTED &&
 		   rd.topline < rd.lastLine)
 	      rd.topline++;
 	  }
@@ -2295,7 +3030,7 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
 
       case OP_PREV_LINE:
 	if (rd.topline)
-	  rd.topline = upNLines (1, rd.lineInfo, rd.topline, rd.hideQuoted);
+	  rd.topline = upNLines (1, &rd, rd.topline, rd.hideQuoted);
 	else
 	  mutt_error _("Top of message is shown.");
 	break;
@@ -2310,16 +3045,18 @@ mutt_pager (const char *banner, const char *fname, int flags, pager_t *extra)
       case OP_HALF_UP:
 	if (rd.topline)
 	  rd.topline = upNLines (rd.pager_window->rows/2 + rd.pager_window->rows%2,
-                                 rd.lineInfo, rd.topline, rd.hideQuoted);
+                                 &rd, rd.topline, rd.hideQuoted);
 	else
 	  mutt_error _("Top of message is shown.");
 	break;
 
       case OP_HALF_DOWN:
-	if (rd.lineInfo[rd.curline].offset < rd.sb.st_size-1)
+	if (pager_line (&rd, rd.curline)->offset < rd.sb.st_size-1)
 	{
-	  rd.topline = upNLines (rd.pager_window->rows/2, rd.lineInfo, rd.curline, rd.hideQuoted);
+	  rd.topline = upNLines (rd.pager_window->rows/2, &rd, rd.curline, rd.hideQuoted);
 	}
+	else if (rd.stream_pid)
+	  mutt_error _("The rest of the message is still being decoded.");
 	else if (option (OPTPAGERSTOP))
 	{
 	  /* emulate "less -q" and don't go on to the next message. */
@@ -2349,14 +3086,13 @@ search_next:
 	      (rd.SearchBack &&ch==OP_SEARCH_OPPOSITE))
 	  {
 	    /* searching forward */
-	    for (i = wrapped ? 0 : rd.topline + searchctx + 1; i < rd.lastLine; i++)
-	    {
-	      if ((!rd.hideQuoted || rd.lineInfo[i].type != MT_COLOR_QUOTED) &&
-                  !rd.lineInfo[i].continuation && rd.lineInfo[i].search_cnt > 0)
-		break;
-	    }
+	    i = rd.topline + searchctx + 1;
+	    if (wrapped)
+	      pos = 0;
+	    else
+	      pos = (i <= rd.lastLine) ? pager_line (&rd, i)->offset : rd.sb.st_size;
 
-	    if (i < rd.lastLine)
+	    if ((i = pager_search_find (&rd, pos, 0, (flags & MUTT_PAGER_NSKIP) | (flags & MUTT_PAGER_NOWRAP) | rd.has_types)) >= 0)
 	      rd.topline = i;
 	    else if (wrapped || !option (OPTWRAPSEARCH))
 	      mutt_error _("Not found.");
@@ -2370,15 +3106,13 @@ search_next:
 	  else
 	  {
 	    /* searching backward */
-	    for (i = wrapped ? rd.lastLine : rd.topline + searchctx - 1; i >= 0; i--)
-	    {
-	      if ((!rd.hideQuoted || (rd.has_types &&
-                                      rd.lineInfo[i].type != MT_COLOR_QUOTED)) &&
-                  !rd.lineInfo[i].continuation && rd.lineInfo[i].search_cnt > 0)
-		break;
-	    }
+	    i = MIN (rd.topline + searchctx - 1, rd.lastLine - 1);
+	    if (wrapped)
+	      pos = rd.sb.st_size;
+	    else
+	      pos = (i >= 0) ? pager_line (&rd, i)->offset : -1;
 
-	    if (i >= 0)
+	    if ((i = pager_search_find (&rd, pos, 1, (flags & MUTT_PAGER_NSKIP) | (flags & MUTT_PAGER_NOWRAP) | rd.has_types)) >= 0)
 	      rd.topline = i;
 	    else if (wrapped || !option (OPTWRAPSEARCH))
 	      mutt_error _("Not found.");
@@ -2390,12 +3124,13 @@ search_next:
 	    }
 	  }
 
-	  if (rd.lineInfo[rd.topline].search_cnt > 0)
+	  if (i >= 0)
 	  {
 	    rd.SearchFlag = MUTT_SEARCH;
 	    /* give some context for search results */
 	    if (rd.topline - searchctx > 0)
 	      rd.topline -= searchctx;
+	    pager_menu->redraw |= REDRAW_STATUS;
 	  }
 
 	  break;
@@ -2441,71 +3176,33 @@ search_next:
 	if (rd.SearchCompiled)
 	{
 	  regfree (&rd.SearchRE);
-	  for (i = 0; i < rd.lastLine; i++)
-	  {
-	    if (rd.lineInfo[i].search)
-	      FREE (&(rd.lineInfo[i].search));
-	    rd.lineInfo[i].search_cnt = -1;
-	  }
+	  clear_search (&rd);
 	}
 
 	if ((err = REGCOMP (&rd.SearchRE, searchbuf, REG_NEWLINE | mutt_which_case (searchbuf))) != 0)
 	{
 	  regerror (err, &rd.SearchRE, buffer, sizeof (buffer));
 	  mutt_error ("%s", buffer);
-	  for (i = 0; i < rd.maxLine ; i++)
-	  {
-	    /* cleanup */
-	    if (rd.lineInfo[i].search)
-	      FREE (&(rd.lineInfo[i].search));
-	    rd.lineInfo[i].search_cnt = -1;
-	  }
+	  clear_search (&rd);
 	  rd.SearchFlag = 0;
 	  rd.SearchCompiled = 0;
+	  rd.SearchMatchCount = 0;
 	}
 	else
 	{
 	  rd.SearchCompiled = 1;
 	  /* update the search pointers */
-	  i = 0;
-	  while (display_line (rd.fp, &rd.last_pos, &rd.lineInfo, i, &rd.lastLine,
-                               &rd.maxLine, MUTT_SEARCH | (flags & MUTT_PAGER_NSKIP) | (flags & MUTT_PAGER_NOWRAP) | rd.has_types,
-                               &rd.QuoteList, &rd.q_level,
-                               &rd.force_redraw, &rd.SearchRE, rd.pager_window) == 0)
-	    i++;
+	  pager_search_index (&rd, 0);
 
-	  if (!rd.SearchBack)
-	  {
-	    /* searching forward */
-	    for (i = rd.topline; i < rd.lastLine; i++)
-	    {
-	      if ((!rd.hideQuoted || rd.lineInfo[i].type != MT_COLOR_QUOTED) &&
-                  !rd.lineInfo[i].continuation && rd.lineInfo[i].search_cnt > 0)
-		break;
-	    }
-
-	    if (i < rd.lastLine) rd.topline = i;
-	  }
-	  else
-	  {
-	    /* searching backward */
-	    for (i = rd.topline; i >= 0; i--)
-	    {
-	      if ((!rd.hideQuoted || rd.lineInfo[i].type != MT_COLOR_QUOTED) &&
-                  !rd.lineInfo[i].continuation && rd.lineInfo[i].search_cnt > 0)
-		break;
-	    }
-
-	    if (i >= 0) rd.topline = i;
-	  }
-
-	  if (rd.lineInfo[rd.topline].search_cnt == 0)
+	  if ((i = pager_search_find (&rd, pager_line (&rd, rd.topline)->offset, rd.SearchBack,
+                                      (flags & MUTT_PAGER_NSKIP) | (flags & MUTT_PAGER_NOWRAP) | rd.has_types)) < 0)
 	  {
 	    rd.SearchFlag = 0;
 	    mutt_error _("Not found.");
 	  }
 	  else
 	  {
+	    rd.topline = i;
 	    rd.SearchFlag = MUTT_SEARCH;
 	    /* give some context for search results */
 	    if (SearchContext > 0 && SearchContext < rd.pager_window->rows)
@@ -2561,8 +3258,8 @@ search_next:
 	if (rd.has_types)
 	{
 	  rd.hideQuoted ^= MUTT_HIDE;
-	  if (rd.hideQuoted && rd.lineInfo[rd.topline].type == MT_COLOR_QUOTED)
-	    rd.topline = upNLines (1, rd.lineInfo, rd.topline, rd.hideQuoted);
+	  if (rd.hideQuoted && pager_line (&rd, rd.topline)->type == MT_COLOR_QUOTED)
+	    rd.topline = upNLines (1, &rd, rd.topline, rd.hideQuoted);
 	  else
 	    pager_menu->redraw = REDRAW_BODY;
 	}
@@ -2582,10 +3279,9 @@ search_next:
           if (PagerSkipQuotedContext > 0)
           {
 	    while ((new_topline < rd.lastLine ||
-		    (0 == (dretval = display_line (rd.fp, &rd.last_pos, &rd.lineInfo,
-			   new_topline, &rd.lastLine, &rd.maxLine, MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP),
-			   &rd.QuoteList, &rd.q_level, &rd.force_redraw, &rd.SearchRE, rd.pager_window))))
-		   && rd.lineInfo[new_topline].type == MT_COLOR_QUOTED)
+		    (0 == (dretval = display_line (&rd, new_topline,
+			   MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP)))))
+		   && pager_line (&rd, new_topline)->type == MT_COLOR_QUOTED)
 	    {
 	      new_topline++;
 	      num_quoted++;
@@ -2602,10 +3298,9 @@ search_next:
           {
 	    num_quoted = 0;
 	    while ((new_topline < rd.lastLine ||
-		    (0 == (dretval = display_line (rd.fp, &rd.last_pos, &rd.lineInfo,
-			   new_topline, &rd.lastLine, &rd.maxLine, MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP),
-			   &rd.QuoteList, &rd.q_level, &rd.force_redraw, &rd.SearchRE, rd.pager_window))))
-		   && rd.lineInfo[new_topline].type != MT_COLOR_QUOTED)
+		    (0 == (dretval = display_line (&rd, new_topline,
+			   MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP)))))
+		   && pager_line (&rd, new_topline)->type != MT_COLOR_QUOTED)
 	      new_topline++;
 
 	    if (dretval < 0)
@@ -2615,10 +3310,9 @@ search_next:
 	    }
 
 	    while ((new_topline < rd.lastLine ||
-		    (0 == (dretval = display_line (rd.fp, &rd.last_pos, &rd.lineInfo,
-			   new_topline, &rd.lastLine, &rd.maxLine, MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP),
-			   &rd.QuoteList, &rd.q_level, &rd.force_redraw, &rd.SearchRE, rd.pager_window))))
-		   && rd.lineInfo[new_topline].type == MT_COLOR_QUOTED)
+		    (0 == (dretval = display_line (&rd, new_topline,
+			   MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP)))))
+		   && pager_line (&rd, new_topline)->type == MT_COLOR_QUOTED)
 	    {
 	      new_topline++;
 	      num_quoted++;
@@ -2641,7 +3335,7 @@ search_next:
 	  int dretval = 0;
 	  int new_topline = rd.topline;
 
-          if (!ISHEADER (rd.lineInfo[new_topline].type))
+          if (!ISHEADER (pager_line (&rd, new_topline)->type))
           {
             /* L10N:
                Displayed if <skip-headers> is invoked in the pager, but we are
@@ -2652,10 +3346,9 @@ search_next:
 	  }
 
 	  while ((new_topline < rd.lastLine ||
-		  (0 == (dretval = display_line (rd.fp, &rd.last_pos, &rd.lineInfo,
-			 new_topline, &rd.lastLine, &rd.maxLine, MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP),
-                         &rd.QuoteList, &rd.q_level, &rd.force_redraw, &rd.SearchRE, rd.pager_window))))
-		 && ISHEADER (rd.lineInfo[new_topline].type))
+		  (0 == (dretval = display_line (&rd, new_topline,
+			 MUTT_TYPES | (flags & MUTT_PAGER_NOWRAP)))))
+		 && ISHEADER (pager_line (&rd, new_topline)->type))
 	    new_topline++;
 
 	  if (dretval < 0)
@@ -2674,16 +3367,13 @@ search_next:
 	break;
 
       case OP_PAGER_BOTTOM: /* move to the end of the file */
-	if (rd.lineInfo[rd.curline].offset < rd.sb.st_size - 1)
+	if (pager_line (&rd, rd.curline)->offset < rd.sb.st_size - 1)
 	{
 	  i = rd.curline;
 	  /* make sure the types are defined to the end of file */
-	  while (display_line (rd.fp, &rd.last_pos, &rd.lineInfo, i, &rd.lastLine,
-                               &rd.maxLine, rd.has_types | (flags & MUTT_PAGER_NOWRAP),
-                               &rd.QuoteList, &rd.q_level, &rd.force_redraw,
-                               &rd.SearchRE, rd.pager_window) == 0)
+	  while (display_line (&rd, i, rd.has_types | (flags & MUTT_PAGER_NOWRAP)) == 0)
 	    i++;
-	  rd.topline = upNLines (rd.pager_window->rows, rd.lineInfo, rd.lastLine, rd.hideQuoted);
+	  rd.topline = upNLines (rd.pager_window->rows, &rd, rd.lastLine, rd.hideQuoted);
 	}
 	else
 	  mutt_error _("Bottom of message is shown.");
@@ -3170,6 +3860,8 @@ search_next:
     }
   }
 
+  if (rd.stream_pid)
+    pager_stream_stop (&rd);
   safe_fclose (&rd.fp);
   if (IsHeader (extra))
   {
@@ -3188,19 +3880,16 @@ search_next:
   }
 
   cleanup_quote (&rd.QuoteList);
+  hash_destroy (&rd.QuoteHash, NULL);
 
-  for (i = 0; i < rd.maxLine ; i++)
-  {
-    FREE (&(rd.lineInfo[i].syntax));
-    if (rd.SearchCompiled && rd.lineInfo[i].search)
-      FREE (&(rd.lineInfo[i].search));
-  }
+  free_blocks (&rd);
   if (rd.SearchCompiled)
   {
     regfree (&rd.SearchRE);
     rd.SearchCompiled = 0;
   }
-  FREE (&rd.lineInfo);
+  FREE (&rd.SearchMatches);
+  FREE (&rd.lineBlocks);
   mutt_pop_current_menu (pager_menu);
   mutt_menuDestroy (&pager_menu);
   if (rd.index)
@@ -43,6 +43,8 @@ typedef struct
   BODY *bdy;	/* current attachment */
   FILE *fp;	/* source stream */
   ATTACH_CONTEXT *actx;	/* attachment information */
+  pid_t stream_pid;	/* still writing the file, see $pager_stream */
+  int stream_fd;	/* read end of its result pipe */
 } pager_t;
 
 int mutt_do_pager (const char *, const char *, int, pager_t *);
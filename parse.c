@@ -1213,300 +1213,385 @@ void mutt_auto_subscribe (const char *mailto)
   mutt_free_envelope (&lpenv);
 }
 
+/* Headers handled by mutt_parse_rfc822_line(), looked up by name through
+ * RFC822HeaderSlots.  rfc822_header_slot() gives each of these names a
+ * slot of its own, so a known header costs a single comparison.  A new
+ * name that collides still works, it just probes further. */
+enum
+{
+  HDR_UNKNOWN = 0,
+  HDR_APPARENTLY_FROM,
+  HDR_APPARENTLY_TO,
+  HDR_AUTOCRYPT,
+  HDR_AUTOCRYPT_GOSSIP,
+  HDR_BCC,
+  HDR_CC,
+  HDR_CONTENT_DESCRIPTION,
+  HDR_CONTENT_DISPOSITION,
+  HDR_CONTENT_LENGTH,
+  HDR_CONTENT_TRANSFER_ENCODING,
+  HDR_CONTENT_TYPE,
+  HDR_DATE,
+  HDR_EXPIRES,
+  HDR_FROM,
+  HDR_IN_REPLY_TO,
+  HDR_LINES,
+  HDR_LIST_POST,
+  HDR_MAIL_FOLLOWUP_TO,
+  HDR_MAIL_REPLY_TO,
+  HDR_MESSAGE_ID,
+  HDR_MIME_VERSION,
+  HDR_RECEIVED,
+  HDR_REFERENCES,
+  HDR_REPLY_TO,
+  HDR_RETURN_PATH,
+  HDR_SENDER,
+  HDR_STATUS,
+  HDR_SUBJECT,
+  HDR_SUPERSEDES,
+  HDR_TO,
+  HDR_X_LABEL,
+  HDR_X_STATUS
+};
+
+static const struct
+{
+  const char *name;
+  int id;
+} RFC822Headers[] =
+{
+  { "Apparently-From",		HDR_APPARENTLY_FROM },
+  { "Apparently-To",		HDR_APPARENTLY_TO },
+  { "Autocrypt",		HDR_AUTOCRYPT },
+  { "Autocrypt-Gossip",		HDR_AUTOCRYPT_GOSSIP },
+  { "Bcc",			HDR_BCC },
+  { "Cc",			HDR_CC },
+  { "Content-Description",	HDR_CONTENT_DESCRIPTION },
+  { "Content-Disposition",	HDR_CONTENT_DISPOSITION },
+  { "Content-Length",		HDR_CONTENT_LENGTH },
+  { "Content-Transfer-Encoding",	HDR_CONTENT_TRANSFER_ENCODING },
+  { "Content-Type",		HDR_CONTENT_TYPE },
+  { "Date",			HDR_DATE },
+  { "Expires",			HDR_EXPIRES },
+  { "From",			HDR_FROM },
+  { "In-Reply-To",		HDR_IN_REPLY_TO },
+  { "Lines",			HDR_LINES },
+  { "List-Post",		HDR_LIST_POST },
+  { "Mail-Followup-To",		HDR_MAIL_FOLLOWUP_TO },
+  { "Mail-Reply-To",		HDR_MAIL_REPLY_TO },
+  { "Message-ID",		HDR_MESSAGE_ID },
+  { "MIME-Version",		HDR_MIME_VERSION },
+  { "Received",			HDR_RECEIVED },
+  { "References",		HDR_REFERENCES },
+  { "Reply-To",			HDR_REPLY_TO },
+  { "Return-Path",		HDR_RETURN_PATH },
+  { "Sender",			HDR_SENDER },
+  { "Status",			HDR_STATUS },
+  { "Subject",			HDR_SUBJECT },
+  { "Supercedes",		HDR_SUPERSEDES },
+  { "Supersedes",		HDR_SUPERSEDES },
+  { "To",			HDR_TO },
+  { "X-Label",			HDR_X_LABEL },
+  { "X-Status",			HDR_X_STATUS },
+  { NULL,			0 }
+};
+
+#define RFC822_HEADER_SLOTS 128
+
+/* index into RFC822Headers plus one, or 0 for an empty slot */
+static unsigned char RFC822HeaderSlots[RFC822_HEADER_SLOTS];
+static int RFC822HeaderSlotsReady = 0;
+
+static unsigned int rfc822_header_slot (const char *name, size_t len)
+{
+  return (len + 5 * ascii_tolower ((unsigned char) name[len / 2])) %
+    RFC822_HEADER_SLOTS;
+}
+
+static void rfc822_header_init (void)
+{
+  unsigned int h;
+  int i;
+
+  for (i = 0; RFC822Headers[i].name; i++)
+  {
+    h = rfc822_header_slot (RFC822Headers[i].name,
+                            strlen (RFC822Headers[i].name));
+    while (RFC822HeaderSlots[h])
+      h = (h + 1) % RFC822_HEADER_SLOTS;
+    RFC822HeaderSlots[h] = i + 1;
+  }
+  RFC822HeaderSlotsReady = 1;
+}
+
+/* Returns the HDR_* id of the header named `name', or HDR_UNKNOWN. */
+static int rfc822_header_id (const char *name)
+{
+  size_t len = strlen (name);
+  unsigned int h;
+  int i;
+
+  if (!len)
+    return HDR_UNKNOWN;
+  if (!RFC822HeaderSlotsReady)
+    rfc822_header_init ();
+
+  for (h = rfc822_header_slot (name, len); (i = RFC822HeaderSlots[h]);
+       h = (h + 1) % RFC822_HEADER_SLOTS)
+  {
+    if (!ascii_strcasecmp (name, RFC822Headers[i - 1].name))
+      return RFC822Headers[i - 1].id;
+  }
+
+  return HDR_UNKNOWN;
+}
+
 int mutt_parse_rfc822_line (ENVELOPE *e, HEADER *hdr, char *line, char *p, short user_hdrs, short weed,
 			    short do_2047, LIST **lastp)
 {
   int matched = 0;
 
-  switch (ascii_tolower (line[0]))
+  switch (rfc822_header_id (line))
   {
-    case 'a':
-      if (ascii_strcasecmp (line+1, "pparently-to") == 0)
+    case HDR_APPARENTLY_TO:
+    case HDR_TO:
+      e->to = rfc822_parse_adrlist (e->to, p);
+      matched = 1;
+      break;
+
+    case HDR_APPARENTLY_FROM:
+    case HDR_FROM:
+      e->from = rfc822_parse_adrlist (e->from, p);
+      matched = 1;
+      break;
+
+#ifdef USE_AUTOCRYPT
+    case HDR_AUTOCRYPT:
+      if (option (OPTAUTOCRYPT))
       {
-        e->to = rfc822_parse_adrlist (e->to, p);
+        e->autocrypt = parse_autocrypt (e->autocrypt, p);
         matched = 1;
       }
-      else if (ascii_strcasecmp (line+1, "pparently-from") == 0)
+      break;
+
+    case HDR_AUTOCRYPT_GOSSIP:
+      if (option (OPTAUTOCRYPT))
       {
-        e->from = rfc822_parse_adrlist (e->from, p);
+        e->autocrypt_gossip = parse_autocrypt (e->autocrypt_gossip, p);
         matched = 1;
       }
-#ifdef USE_AUTOCRYPT
-      else if (ascii_strcasecmp (line+1, "utocrypt") == 0)
-      {
-        if (option (OPTAUTOCRYPT))
-        {
-          e->autocrypt = parse_autocrypt (e->autocrypt, p);
-          matched = 1;
-        }
-      }
-      else if (ascii_strcasecmp (line+1, "utocrypt-gossip") == 0)
-      {
-        if (option (OPTAUTOCRYPT))
-        {
-          e->autocrypt_gossip = parse_autocrypt (e->autocrypt_gossip, p);
-          matched = 1;
-        }
-      }
+      break;
 #endif
+
+    case HDR_BCC:
+      e->bcc = rfc822_parse_adrlist (e->bcc, p);
+      matched = 1;
       break;
 
-    case 'b':
-      if (ascii_strcasecmp (line+1, "cc") == 0)
-      {
-        e->bcc = rfc822_parse_adrlist (e->bcc, p);
-        matched = 1;
-      }
+    case HDR_CC:
+      e->cc = rfc822_parse_adrlist (e->cc, p);
+      matched = 1;
+      break;
+
+    case HDR_CONTENT_TYPE:
+      if (hdr)
+        mutt_parse_content_type (p, hdr->content);
+      matched = 1;
       break;
 
-    case 'c':
-      if (ascii_strcasecmp (line+1, "c") == 0)
+    case HDR_CONTENT_TRANSFER_ENCODING:
+      if (hdr)
+        hdr->content->encoding = mutt_check_encoding (p);
+      matched = 1;
+      break;
+
+    case HDR_CONTENT_LENGTH:
+      if (hdr)
       {
-        e->cc = rfc822_parse_adrlist (e->cc, p);
-        matched = 1;
-      }
-      else if (ascii_strncasecmp (line + 1, "ontent-", 7) == 0)
-      {
-        if (ascii_strcasecmp (line+8, "type") == 0)
-        {
-          if (hdr)
-            mutt_parse_content_type (p, hdr->content);
-          matched = 1;
-        }
-        else if (ascii_strcasecmp (line+8, "transfer-encoding") == 0)
-        {
-          if (hdr)
-            hdr->content->encoding = mutt_check_encoding (p);
-          matched = 1;
-        }
-        else if (ascii_strcasecmp (line+8, "length") == 0)
-        {
-          if (hdr)
-          {
-            if (mutt_atolofft (p, &hdr->content->length, 0) < 0)
-              hdr->content->length = -1;
-          }
-          matched = 1;
-        }
-        else if (ascii_strcasecmp (line+8, "description") == 0)
-        {
-          if (hdr)
-          {
-            mutt_str_replace (&hdr->content->description, p);
-            rfc2047_decode (&hdr->content->description);
-          }
-          matched = 1;
-        }
-        else if (ascii_strcasecmp (line+8, "disposition") == 0)
-        {
-          if (hdr)
-            parse_content_disposition (p, hdr->content);
-          matched = 1;
-        }
+        if (mutt_atolofft (p, &hdr->content->length, 0) < 0)
+          hdr->content->length = -1;
       }
+      matched = 1;
       break;
 
-    case 'd':
-      if (!ascii_strcasecmp ("ate", line + 1))
+    case HDR_CONTENT_DESCRIPTION:
+      if (hdr)
       {
-        mutt_str_replace (&e->date, p);
-        if (hdr)
-          hdr->date_sent = mutt_parse_date (p, hdr);
-        matched = 1;
+        mutt_str_replace (&hdr->content->description, p);
+        rfc2047_decode (&hdr->content->description);
       }
+      matched = 1;
       break;
 
-    case 'e':
-      if (!ascii_strcasecmp ("xpires", line + 1) &&
-          hdr && mutt_parse_date (p, NULL) < time (NULL))
+    case HDR_CONTENT_DISPOSITION:
+      if (hdr)
+        parse_content_disposition (p, hdr->content);
+      matched = 1;
+      break;
+
+    case HDR_DATE:
+      mutt_str_replace (&e->date, p);
+      if (hdr)
+        hdr->date_sent = mutt_parse_date (p, hdr);
+      matched = 1;
+      break;
+
+    case HDR_EXPIRES:
+      if (hdr && mutt_parse_date (p, NULL) < time (NULL))
         hdr->expired = 1;
       break;
 
-    case 'f':
-      if (!ascii_strcasecmp ("rom", line + 1))
-      {
-        e->from = rfc822_parse_adrlist (e->from, p);
-        matched = 1;
-      }
+    case HDR_IN_REPLY_TO:
+      mutt_free_list (&e->in_reply_to);
+      e->in_reply_to = mutt_parse_references (p, 0);
+      matched = 1;
       break;
 
-    case 'i':
-      if (!ascii_strcasecmp (line+1, "n-reply-to"))
+    case HDR_LINES:
+      if (hdr)
       {
-        mutt_free_list (&e->in_reply_to);
-        e->in_reply_to = mutt_parse_references (p, 0);
-        matched = 1;
+        /*
+         * HACK - mutt has, for a very short time, produced negative
+         * Lines header values.  Ignore them.
+         */
+        if (mutt_atoi (p, &hdr->lines, 0) < 0 || hdr->lines < 0)
+          hdr->lines = 0;
       }
+
+      matched = 1;
       break;
 
-    case 'l':
-      if (!ascii_strcasecmp (line + 1, "ines"))
-      {
-        if (hdr)
-        {
-          /*
-           * HACK - mutt has, for a very short time, produced negative
-           * Lines header values.  Ignore them.
-           */
-          if (mutt_atoi (p, &hdr->lines, 0) < 0 || hdr->lines < 0)
-            hdr->lines = 0;
-        }
+    case HDR_LIST_POST:
+      matched = mutt_parse_list_header (&e->list_post, p);
+      if (matched && option (OPTAUTOSUBSCRIBE))
+        mutt_auto_subscribe (e->list_post);
+      break;
 
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "ist-Post"))
-      {
-        matched = mutt_parse_list_header (&e->list_post, p);
-        if (matched && option (OPTAUTOSUBSCRIBE))
-          mutt_auto_subscribe (e->list_post);
-      }
+    case HDR_MIME_VERSION:
+      if (hdr)
+        hdr->mime = 1;
+      matched = 1;
       break;
 
-    case 'm':
-      if (!ascii_strcasecmp (line + 1, "ime-version"))
-      {
-        if (hdr)
-          hdr->mime = 1;
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "essage-id"))
-      {
-        /* We add a new "Message-ID:" when building a message */
-        FREE (&e->message_id);
-        e->message_id = mutt_extract_message_id (p, NULL, 0);
-        if (!e->message_id)
-          e->message_id = mutt_extract_message_id (p, NULL, 1);
-        matched = 1;
-      }
-      else if (!ascii_strncasecmp (line + 1, "ail-", 4))
-      {
-        if (!ascii_strcasecmp (line + 5, "reply-to"))
-        {
-          /* override the Reply-To: field */
-          rfc822_free_address (&e->reply_to);
-          e->reply_to = rfc822_parse_adrlist (e->reply_to, p);
-          matched = 1;
-        }
-        else if (!ascii_strcasecmp (line + 5, "followup-to"))
-        {
-          e->mail_followup_to = rfc822_parse_adrlist (e->mail_followup_to, p);
-          matched = 1;
-        }
-      }
+    case HDR_MESSAGE_ID:
+      /* We add a new "Message-ID:" when building a message */
+      FREE (&e->message_id);
+      e->message_id = mutt_extract_message_id (p, NULL, 0);
+      if (!e->message_id)
+        e->message_id = mutt_extract_message_id (p, NULL, 1);
+      matched = 1;
       break;
 
-    case 'r':
-      if (!ascii_strcasecmp (line + 1, "eferences"))
-      {
-        mutt_free_list (&e->references);
-        e->references = mutt_parse_references (p, 0);
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "eply-to"))
-      {
-        e->reply_to = rfc822_parse_adrlist (e->reply_to, p);
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "eturn-path"))
-      {
-        e->return_path = rfc822_parse_adrlist (e->return_path, p);
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "eceived"))
-      {
-        if (hdr && !hdr->received)
-        {
-          char *d = strrchr (p, ';');
+    case HDR_MAIL_REPLY_TO:
+      /* override the Reply-To: field */
+      rfc822_free_address (&e->reply_to);
+      e->reply_to = rfc822_parse_adrlist (e->reply_to, p);
+      matched = 1;
+      break;
 
-          if (d)
-            hdr->received = mutt_parse_date (d + 1, NULL);
-        }
-      }
+    case HDR_MAIL_FOLLOWUP_TO:
+      e->mail_followup_to = rfc822_parse_adrlist (e->mail_followup_to, p);
+      matched = 1;
       break;
 
-    case 's':
-      if (!ascii_strcasecmp (line + 1, "ubject"))
-      {
-        if (!e->subject)
-          e->subject = safe_strdup (p);
-        matched = 1;
-      }
-      else if (!ascii_strcasecmp (line + 1, "ender"))
+    case HDR_REFERENCES:
+      mutt_free_list (&e->references);
+      e->references = mutt_parse_references (p, 0);
+      matched = 1;
+      break;
+
+    case HDR_REPLY_TO:
+      e->reply_to = rfc822_parse_adrlist (e->reply_to, p);
+      matched = 1;
+      break;
+
+    case HDR_RETURN_PATH:
+      e->return_path = rfc822_parse_adrlist (e->return_path, p);
+      matched = 1;
+      break;
+
+    case HDR_RECEIVED:
+      if (hdr && !hdr->received)
       {
-        e->sender = rfc822_parse_adrlist (e->sender, p);
-        matched = 1;
+        char *d = strrchr (p, ';');
+
+        if (d)
+          hdr->received = mutt_parse_date (d + 1, NULL);
       }
-      else if (!ascii_strcasecmp (line + 1, "tatus"))
+      break;
+
+    case HDR_SUBJECT:
+      if (!e->subject)
+        e->subject = safe_strdup (p);
+      matched = 1;
+      break;
+
+    case HDR_SENDER:
+      e->sender = rfc822_parse_adrlist (e->sender, p);
+      matched = 1;
+      break;
+
+    case HDR_STATUS:
+      if (hdr)
       {
-        if (hdr)
+        while (*p)
         {
-          while (*p)
+          switch (*p)
           {
-            switch (*p)
-            {
-              case 'r':
-                hdr->replied = 1;
-                break;
-              case 'O':
-                hdr->old = 1;
-                break;
-              case 'R':
-                hdr->read = 1;
-                break;
-            }
-            p++;
+            case 'r':
+              hdr->replied = 1;
+              break;
+            case 'O':
+              hdr->old = 1;
+              break;
+            case 'R':
+              hdr->read = 1;
+              break;
           }
+          p++;
         }
-        matched = 1;
-      }
-      else if ((!ascii_strcasecmp ("upersedes", line + 1) ||
-                !ascii_strcasecmp ("upercedes", line + 1)) && hdr)
-      {
-        FREE(&e->supersedes);
-        e->supersedes = safe_strdup (p);
       }
+      matched = 1;
       break;
 
-    case 't':
-      if (ascii_strcasecmp (line+1, "o") == 0)
+    case HDR_SUPERSEDES:
+      if (hdr)
       {
-        e->to = rfc822_parse_adrlist (e->to, p);
-        matched = 1;
+        FREE(&e->supersedes);
+        e->supersedes = safe_strdup (p);
       }
       break;
 
-    case 'x':
-      if (ascii_strcasecmp (line+1, "-status") == 0)
+    case HDR_X_STATUS:
+      if (hdr)
       {
-        if (hdr)
+        while (*p)
         {
-          while (*p)
+          switch (*p)
           {
-            switch (*p)
-            {
-              case 'A':
-                hdr->replied = 1;
-                break;
-              case 'D':
-                hdr->deleted = 1;
-                break;
-              case 'F':
-                hdr->flagged = 1;
-                break;
-              default:
-                break;
-            }
-            p++;
+            case 'A':
+              hdr->replied = 1;
+              break;
+            case 'D':
+              hdr->deleted = 1;
+              break;
+            case 'F':
+              hdr->flagged = 1;
+              break;
+            default:
+              break;
           }
+          p++;
         }
-        matched = 1;
-      }
-      else if (ascii_strcasecmp (line+1, "-label") == 0)
-      {
-        FREE(&e->x_label);
-        e->x_label = safe_strdup(p);
-        matched = 1;
       }
+      matched = 1;
+      break;
+
+    case HDR_X_LABEL:
+      FREE(&e->x_label);
+      e->x_label = safe_strdup(p);
+      matched = 1;
+      break;
 
     default:
       break;
@@ -1523,8 +1608,7 @@ int mutt_parse_rfc822_line (ENVELOPE *e, HEADER *hdr, char *line, char *p, short
     /* restore the original line */
     line[strlen (line)] = ':';
 
-    if (weed && option (OPTWEED) && mutt_matches_ignore (line, Ignore)
-	&& !mutt_matches_ignore (line, UnIgnore))
+    if (weed && option (OPTWEED) && mutt_ignore_header (line))
       goto done;
 
     if (last)
@@ -1618,44 +1702,40 @@ ENVELOPE *mutt_read_rfc822_header (FILE *f, HEADER *hdr, short user_hdrs,
 
     *buf = '\0';
 
-    if (mutt_match_spam_list(line, SpamList, buf, sizeof(buf)))
+    if (mutt_match_spam (line, buf, sizeof (buf)))
     {
-      if (!mutt_match_rx_list(line, NoSpamList))
+      /* if spam tag already exists, figure out how to amend it */
+      if (e->spam && *buf)
       {
+        /* If SpamSep defined, append with separator */
+        if (SpamSep)
+        {
+          mutt_buffer_addstr(e->spam, SpamSep);
+          mutt_buffer_addstr(e->spam, buf);
+        }
 
-	/* if spam tag already exists, figure out how to amend it */
-	if (e->spam && *buf)
-	{
-	  /* If SpamSep defined, append with separator */
-	  if (SpamSep)
-	  {
-	    mutt_buffer_addstr(e->spam, SpamSep);
-	    mutt_buffer_addstr(e->spam, buf);
-	  }
-
-	  /* else overwrite */
-	  else
-	  {
-            mutt_buffer_clear (e->spam);
-	    mutt_buffer_addstr(e->spam, buf);
-	  }
-	}
-
-	/* spam tag is new, and match expr is non-empty; copy */
-	else if (!e->spam && *buf)
-	{
-	  e->spam = mutt_buffer_from (buf);
-	}
+        /* else overwrite */
+        else
+        {
+          mutt_buffer_clear (e->spam);
+          mutt_buffer_addstr(e->spam, buf);
+        }
+      }
 
-	/* match expr is empty; plug in null string if no existing tag */
-	else if (!e->spam)
-	{
-	  e->spam = mutt_buffer_from("");
-	}
+      /* spam tag is new, and match expr is non-empty; copy */
+      else if (!e->spam && *buf)
+      {
+        e->spam = mutt_buffer_from (buf);
+      }
 
-	if (e->spam && e->spam->data)
-          dprint(5, (debugfile, "p822: spam = %s\n", e->spam->data));
+      /* match expr is empty; plug in null string if no existing tag */
+      else if (!e->spam)
+      {
+        e->spam = mutt_buffer_from("");
       }
+
+      if (e->spam && e->spam->data)
+        dprint(5, (debugfile, "p822: spam = %s\n", e->spam->data));
     }
 
     *p = 0;
@@ -71,6 +71,23 @@ static int fetch_message (char *line, void *file)
   return 0;
 }
 
+/* parse the output of "TOP n 0" in f into h.  length is the size of
+ * the message as returned by LIST. */
+static void pop_parse_header (HEADER *h, FILE *f, LOFF_T length)
+{
+  char buf[LONG_STRING];
+
+  rewind (f);
+  h->env = mutt_read_rfc822_header (f, h, 0, 0);
+  h->content->length = length - h->content->offset + 1;
+  rewind (f);
+  while (!feof (f))
+  {
+    h->content->length--;
+    fgets (buf, sizeof (buf), f);
+  }
+}
+
 /*
  * Read header
  * returns:
@@ -129,15 +146,7 @@ static int pop_read_header (POP_DATA *pop_data, HEADER *h)
   {
     case 0:
     {
-      rewind (f);
-      h->env = mutt_read_rfc822_header (f, h, 0, 0);
-      h->content->length = length - h->content->offset + 1;
-      rewind (f);
-      while (!feof (f))
-      {
-	h->content->length--;
-	fgets (buf, sizeof (buf), f);
-      }
+      pop_parse_header (h, f, length);
       break;
     }
     case -2:
@@ -160,12 +169,140 @@ cleanup:
   return ret;
 }
 
+/* message sizes from LIST, indexed by refno */
+typedef struct
+{
+  LOFF_T *sizes;
+  int max;
+} POP_LIST;
+
+/* parse LIST */
+static int fetch_list (char *line, void *data)
+{
+  POP_LIST *list = (POP_LIST *) data;
+  int refno;
+  LOFF_T length;
+
+  if (sscanf (line, "%d " OFF_T_FMT, &refno, &length) == 2 &&
+      refno > 0 && refno <= list->max)
+    list->sizes[refno] = length;
+
+  return 0;
+}
+
+/*
+ * Fetch the headers of ctx->hdrs[want[0..nwant-1]] with TOP, keeping up
+ * to POP_PIPELINE_DEPTH commands in flight.  The sizes come from a
+ * single LIST instead of one per message.  Headers that couldn't be
+ * fetched this way are left without an envelope for pop_read_header().
+ * returns:
+ *  0 on success
+ * -1 - connection lost,
+ * -3 - error writing to tempfile
+ */
+static int pop_prefetch_headers (POP_DATA *pop_data, CONTEXT *ctx,
+                                 const int *want, int nwant,
+                                 progress_t *progress, int old_count)
+{
+  POP_LIST list;
+  BUFFER *tempfile, *cmds;
+  FILE *f = NULL;
+  HEADER *h;
+  int i, sent = 0, done = 0, ret;
+
+  list.max = 0;
+  for (i = 0; i < nwant; i++)
+    list.max = MAX (list.max, ctx->hdrs[want[i]]->refno);
+  list.sizes = safe_calloc (list.max + 1, sizeof (LOFF_T));
+
+  tempfile = mutt_buffer_pool_get ();
+  cmds = mutt_buffer_pool_get ();
+
+  ret = pop_fetch_data (pop_data, "LIST\r\n", NULL, fetch_list, &list);
+  if (ret < 0)
+  {
+    /* let pop_read_header() try */
+    if (ret == -2)
+      ret = 0;
+    goto cleanup;
+  }
+
+  mutt_buffer_mktemp (tempfile);
+  if (!(f = safe_fopen (mutt_b2s (tempfile), "w+")))
+  {
+    mutt_perror (mutt_b2s (tempfile));
+    ret = -3;
+    goto cleanup;
+  }
+
+  for (sent = done = 0; done < nwant; done++)
+  {
+    /* top up the pipeline once half of it has been answered */
+    if (sent < nwant && sent - done <= POP_PIPELINE_DEPTH / 2)
+    {
+      mutt_buffer_clear (cmds);
+      for (; sent < nwant && sent - done < POP_PIPELINE_DEPTH; sent++)
+        mutt_buffer_add_printf (cmds, "TOP %d 0\r\n", ctx->hdrs[want[sent]]->refno);
+      if (mutt_socket_write (pop_data->conn, mutt_b2s (cmds)) < 0)
+      {
+        pop_data->status = POP_DISCONNECTED;
+        ret = -1;
+        goto cleanup;
+      }
+    }
+
+    h = ctx->hdrs[want[done]];
+    ret = pop_read_data (pop_data, "TOP", NULL, fetch_message, f);
+    if (ret == -1)
+      goto cleanup;
+    if (ret == 0 && list.sizes[h->refno])
+      pop_parse_header (h, f, list.sizes[h->refno]);
+    else
+      dprint (1, (debugfile, "pop_prefetch_headers: no header for %d (%d)\n",
+                  h->refno, ret));
+
+    rewind (f);
+    if (ftruncate (fileno (f), 0) != 0)
+    {
+      mutt_perror (mutt_b2s (tempfile));
+      ret = -3;
+      goto cleanup;
+    }
+
+    if (progress)
+      mutt_progress_update (progress, want[done] + 1 - old_count, -1);
+  }
+
+  ret = 0;
+
+cleanup:
+  /* don't leave unread responses behind */
+  if (ret == -3)
+    for (; done + 1 < sent; done++)
+      if (pop_read_data (pop_data, "TOP", NULL, fetch_message, f) == -1)
+      {
+        ret = -1;
+        break;
+      }
+
+  if (f)
+  {
+    safe_fclose (&f);
+    unlink (mutt_b2s (tempfile));
+  }
+  mutt_buffer_pool_release (&tempfile);
+  mutt_buffer_pool_release (&cmds);
+  FREE (&list.sizes);
+  return ret;
+}
+
 /* parse UIDL */
 static int fetch_uidl (char *line, void *data)
 {
   int i, index;
   CONTEXT *ctx = (CONTEXT *)data;
   POP_DATA *pop_data = (POP_DATA *)ctx->data;
+  HEADER *h;
   char *endp;
 
   errno = 0;
@@ -180,26 +317,24 @@ static int fetch_uidl (char *line, void *data)
   if (strlen(line) == 0)
     return -1;
 
-  for (i = 0; i < ctx->msgcount; i++)
-    if (!mutt_strcmp (line, ctx->hdrs[i]->data))
-      break;
-
-  if (i == ctx->msgcount)
+  if (!(h = hash_find (pop_data->uid_hash, line)))
   {
     dprint (1, (debugfile, "pop_fetch_headers: new header %d %s\n", index, line));
 
+    i = ctx->msgcount;
     if (i >= ctx->hdrmax)
       mx_alloc_memory(ctx);
 
     ctx->msgcount++;
-    ctx->hdrs[i] = mutt_new_header ();
-    ctx->hdrs[i]->data = safe_strdup (line);
+    h = ctx->hdrs[i] = mutt_new_header ();
+    h->data = safe_strdup (line);
+    hash_insert (pop_data->uid_hash, h->data, h);
   }
-  else if (ctx->hdrs[i]->index != index - 1)
+  else if (h->index != index - 1)
     pop_data->clear_cache = 1;
 
-  ctx->hdrs[i]->refno = index;
-  ctx->hdrs[i]->index = index - 1;
+  h->refno = index;
+  h->index = index - 1;
 
   return 0;
 }
@@ -208,7 +343,6 @@ static int msg_cache_check (const char *id, body_cache_t *bcache, void *data)
 {
   CONTEXT *ctx;
   POP_DATA *pop_data;
-  int i;
 
   if (!(ctx = (CONTEXT *)data))
     return -1;
@@ -221,10 +355,9 @@ static int msg_cache_check (const char *id, body_cache_t *bcache, void *data)
     return 0;
 #endif
 
-  for (i = 0; i < ctx->msgcount; i++)
-    /* if the id we get is known for a header: done (i.e. keep in cache) */
-    if (ctx->hdrs[i]->data && mutt_strcmp (ctx->hdrs[i]->data, id) == 0)
-      return 0;
+  /* if the id we get is known for a header: done (i.e. keep in cache) */
+  if (hash_find (pop_data->uid_hash, id))
+    return 0;
 
   /* message not found in context -> remove it from cache
    * return the result of bcache, so we stop upon its first error
@@ -282,7 +415,10 @@ static int pop_fetch_headers (CONTEXT *ctx)
     ctx->hdrs[i]->refno = -1;
 
   old_count = ctx->msgcount;
+  pop_hash_uids (pop_data, ctx);
   ret = pop_fetch_data (pop_data, "UIDL\r\n", NULL, fetch_uidl, ctx);
+  /* the headers are replaced by hcache copies below */
+  hash_destroy (&pop_data->uid_hash, NULL);
   new_count = ctx->msgcount;
   ctx->msgcount = old_count;
 
@@ -326,7 +462,29 @@ static int pop_fetch_headers (CONTEXT *ctx)
       mutt_sleep (2);
     }
 
-    for (i = old_count; i < new_count; i++)
+    if (pop_data->cmd_pipelining && pop_data->cmd_top == 1)
+    {
+      int *want, nwant = 0;
+
+      want = safe_malloc ((new_count - old_count) * sizeof (int));
+      for (i = old_count; i < new_count; i++)
+      {
+#if USE_HCACHE
+        if ((data = mutt_hcache_fetch (hc, ctx->hdrs[i]->data, strlen)))
+        {
+          mutt_hcache_free (&data);
+          continue;
+        }
+#endif
+        want[nwant++] = i;
+      }
+      if (nwant)
+        ret = pop_prefetch_headers (pop_data, ctx, want, nwant,
+                                    ctx->quiet ? NULL : &progress, old_count);
+      FREE (&want);
+    }
+
+    for (i = old_count; ret == 0 && i < new_count; i++)
     {
       if (!ctx->quiet)
 	mutt_progress_update (&progress, i + 1 - old_count, -1);
@@ -356,7 +514,9 @@ static int pop_fetch_headers (CONTEXT *ctx)
       }
       else
 #endif
-        if ((ret = pop_read_header (pop_data, ctx->hdrs[i])) < 0)
+        /* unless pop_prefetch_headers() got it already */
+        if (!ctx->hdrs[i]->env &&
+            (ret = pop_read_header (pop_data, ctx->hdrs[i])) < 0)
           break;
 #if USE_HCACHE
         else
@@ -418,7 +578,11 @@ static int pop_fetch_headers (CONTEXT *ctx)
    * the availability of our cache
    */
   if (option (OPTMESSAGECACHECLEAN))
+  {
+    pop_hash_uids (pop_data, ctx);
     mutt_bcache_list (pop_data->bcache, msg_cache_check, (void*)ctx);
+    hash_destroy (&pop_data->uid_hash, NULL);
+  }
 
   mutt_clear_error ();
   return (new_count - old_count);
@@ -33,6 +33,9 @@
 /* maximal length of the server response (RFC1939) */
 #define POP_CMD_RESPONSE 512
 
+/* number of commands sent ahead when the server supports PIPELINING */
+#define POP_PIPELINE_DEPTH 50
+
 enum
 {
   /* Status */
@@ -67,6 +70,7 @@ typedef struct
   unsigned int cmd_user : 2;	/* optional command USER */
   unsigned int cmd_uidl : 2;	/* optional command UIDL */
   unsigned int cmd_top : 2;	/* optional command TOP */
+  unsigned int cmd_pipelining : 1;	/* PIPELINING capability (RFC2449) */
   unsigned int resp_codes : 1;	/* server supports extended response codes */
   unsigned int expire : 1;	/* expire is greater than 0 */
   unsigned int clear_cache : 1;
@@ -76,6 +80,7 @@ typedef struct
   char *auth_list;		/* list of auth mechanisms */
   char *timestamp;
   body_cache_t *bcache;		/* body cache */
+  HASH *uid_hash;		/* UIDL -> HEADER, while matching UIDL output */
   char err_msg[POP_CMD_RESPONSE];
   POP_CACHE cache[POP_CACHE_LEN];
 } POP_DATA;
@@ -100,6 +105,8 @@ int pop_connect (POP_DATA *);
 int pop_open_connection (POP_DATA *);
 int pop_query_d (POP_DATA *, char *, size_t, char *);
 int pop_fetch_data (POP_DATA *, char *, progress_t *, int (*funct) (char *, void *), void *);
+int pop_read_data (POP_DATA *, const char *, progress_t *, int (*funct) (char *, void *), void *);
+void pop_hash_uids (POP_DATA *, CONTEXT *);
 int pop_reconnect (CONTEXT *);
 void pop_logout (CONTEXT *);
 void pop_error (POP_DATA *, char *);
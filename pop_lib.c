@@ -120,6 +120,9 @@ static int fetch_capa (char *line, void *data)
   else if (!ascii_strncasecmp (line, "TOP", 3))
     pop_data->cmd_top = 1;
 
+  else if (!ascii_strncasecmp (line, "PIPELINING", 10))
+    pop_data->cmd_pipelining = 1;
+
   return 0;
 }
 
@@ -166,6 +169,7 @@ static int pop_capabilities (POP_DATA *pop_data, int mode)
     pop_data->cmd_user = 0;
     pop_data->cmd_uidl = 0;
     pop_data->cmd_top = 0;
+    pop_data->cmd_pipelining = 0;
     pop_data->resp_codes = 0;
     pop_data->expire = 1;
     pop_data->login_delay = 0;
@@ -463,18 +467,50 @@ int pop_query_d (POP_DATA *pop_data, char *buf, size_t buflen, char *msg)
  */
 int pop_fetch_data (POP_DATA *pop_data, char *query, progress_t *progressbar,
 		    int (*funct) (char *, void *), void *data)
+{
+  if (pop_data->status != POP_CONNECTED)
+    return -1;
+
+  mutt_socket_write (pop_data->conn, query);
+
+  return pop_read_data (pop_data, query, progressbar, funct, data);
+}
+
+/*
+ * Like pop_fetch_data(), but for a query that has already been sent,
+ * e.g. as part of a pipelined batch.  The query is only used for the
+ * error message.  Responses must be read in the order the queries were
+ * sent.
+ */
+int pop_read_data (POP_DATA *pop_data, const char *query, progress_t *progressbar,
+		   int (*funct) (char *, void *), void *data)
 {
   char buf[LONG_STRING];
+  char cmd[SHORT_STRING];
   char *inbuf;
   char *p;
-  int ret, chunk = 0;
+  int ret = 0, chunk = 0;
   long pos = 0;
   size_t lenbuf = 0;
 
-  strfcpy (buf, query, sizeof (buf));
-  ret = pop_query (pop_data, buf, sizeof (buf));
-  if (ret < 0)
-    return ret;
+  if (pop_data->status != POP_CONNECTED)
+    return -1;
+
+  strfcpy (cmd, query, sizeof (cmd));
+  if ((p = strpbrk (cmd, " \r\n")))
+    *p = '\0';
+  snprintf (pop_data->err_msg, sizeof (pop_data->err_msg), "%s: ", cmd);
+
+  if (mutt_socket_readln (buf, sizeof (buf), pop_data->conn) < 0)
+  {
+    pop_data->status = POP_DISCONNECTED;
+    return -1;
+  }
+  if (mutt_strncmp (buf, "+OK", 3))
+  {
+    pop_error (pop_data, buf);
+    return -2;
+  }
 
   inbuf = safe_malloc (sizeof (buf));
 
@@ -520,12 +556,28 @@ int pop_fetch_data (POP_DATA *pop_data, char *query, progress_t *progressbar,
   return ret;
 }
 
+/* hash the headers of ctx by UIDL into pop_data->uid_hash, so UIDL
+ * output can be matched without a scan per line.  The keys point into
+ * the headers, so the caller frees the table before those change. */
+void pop_hash_uids (POP_DATA *pop_data, CONTEXT *ctx)
+{
+  int i;
+
+  hash_destroy (&pop_data->uid_hash, NULL);
+  pop_data->uid_hash = hash_create (MAX (ctx->msgcount * 2, 128), 0);
+
+  for (i = 0; i < ctx->msgcount; i++)
+    if (ctx->hdrs[i]->data)
+      hash_insert (pop_data->uid_hash, ctx->hdrs[i]->data, ctx->hdrs[i]);
+}
+
 /* find message with this UIDL and set refno */
 static int check_uidl (char *line, void *data)
 {
-  int i;
   unsigned int index;
   CONTEXT *ctx = (CONTEXT *)data;
+  POP_DATA *pop_data = (POP_DATA *)ctx->data;
+  HEADER *h;
   char *endp;
 
   errno = 0;
@@ -536,14 +588,8 @@ static int check_uidl (char *line, void *data)
     endp++;
   memmove(line, endp, strlen(endp) + 1);
 
-  for (i = 0; i < ctx->msgcount; i++)
-  {
-    if (!mutt_strcmp (ctx->hdrs[i]->data, line))
-    {
-      ctx->hdrs[i]->refno = index;
-      break;
-    }
-  }
+  if ((h = hash_find (pop_data->uid_hash, line)))
+    h->refno = index;
 
   return 0;
 }
@@ -575,7 +621,9 @@ int pop_reconnect (CONTEXT *ctx)
       for (i = 0; i < ctx->msgcount; i++)
 	ctx->hdrs[i]->refno = -1;
 
+      pop_hash_uids (pop_data, ctx);
       ret = pop_fetch_data (pop_data, "UIDL\r\n", &progressbar, check_uidl, ctx);
+      hash_destroy (&pop_data->uid_hash, NULL);
       if (ret == -2)
       {
         mutt_error ("%s", pop_data->err_msg);
@@ -34,6 +34,7 @@ struct hdr_format_info
   CONTEXT *ctx;
   HEADER *hdr;
   const char *pager_progress;
+  const char *pager_search;
 };
 
 void mutt_make_string_info (char *, size_t, int, const char *, struct hdr_format_info *, format_flag);
@@ -170,6 +171,7 @@ void mutt_adv_mktemp (BUFFER *);
 void mutt_alias_menu (char *, size_t, ALIAS *);
 void mutt_allow_interrupt (int);
 void mutt_auto_subscribe (const char *);
+void mutt_autoview_kill_jobs (void);
 void mutt_block_signals (void);
 void mutt_block_signals_system (void);
 int mutt_body_handler (BODY *, STATE *);
@@ -224,6 +226,7 @@ void mutt_free_alias (ALIAS **);
 void mutt_free_autocrypthdr (AUTOCRYPTHDR **p);
 #endif
 void mutt_free_body (BODY **);
+void mutt_free_content (CONTENT **);
 void mutt_free_enter_state (ENTER_STATE **);
 void mutt_free_envelope (ENVELOPE **);
 void mutt_free_header (HEADER **);
@@ -352,6 +355,9 @@ int mutt_link_threads (HEADER *, HEADER *, CONTEXT *);
 int mutt_lookup_mime_type (BODY *, const char *);
 int mutt_match_rx_list (const char *, RX_LIST *);
 int mutt_match_spam_list (const char *, REPLACE_LIST *, char *, int);
+int mutt_match_spam (const char *, char *, int);
+char *mutt_regex_literal (const char *, int *);
+void mutt_reset_spam_matcher (void);
 int mutt_messages_in_thread (CONTEXT *, HEADER *, int);
 int mutt_multi_choice (char *prompt, char *letters);
 int mutt_needs_mailcap (BODY *);
@@ -389,6 +395,7 @@ int mutt_search_command (int, int);
 #ifdef USE_SMTP
 int mutt_smtp_send (const ADDRESS *, const ADDRESS *, const ADDRESS *,
                     const ADDRESS *, const char *, int);
+void mutt_smtp_logout (void);
 #endif
 size_t mutt_wstr_trunc (const char *, size_t, size_t, size_t *);
 int mutt_charlen (const char *s, int *);
@@ -415,7 +422,8 @@ int mutt_save_confirm (const char  *, struct stat *);
 int mh_valid_message (const char *);
 
 pid_t mutt_create_filter (const char *, FILE **, FILE **, FILE **);
-pid_t mutt_create_filter_fd (const char *, FILE **, FILE **, FILE **, int, int, int);
+#define mutt_create_filter_fd(a,b,c,d,e,f,g) _mutt_create_filter_fd(a,b,c,d,e,f,g,0)
+pid_t _mutt_create_filter_fd (const char *, FILE **, FILE **, FILE **, int, int, int, int);
 
 ADDRESS *alias_reverse_lookup (ADDRESS *);
 
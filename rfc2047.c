@@ -72,7 +72,7 @@ static size_t convert_string (ICONV_CONST char *f, size_t flen,
   {
     e = errno;
     FREE (&buf);
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     errno = e;
     return (size_t)(-1);
   }
@@ -82,7 +82,7 @@ static size_t convert_string (ICONV_CONST char *f, size_t flen,
 
   safe_realloc (&buf, ob - buf + 1);
   *t = buf;
-  iconv_close (cd);
+  mutt_iconv_close (cd);
 
   return n;
 }
@@ -286,11 +286,11 @@ static size_t try_block (ICONV_CONST char *d, size_t dlen,
 	iconv (cd, 0, 0, &ob, &obl) == (size_t)(-1))
     {
       assert (errno == E2BIG);
-      iconv_close (cd);
+      mutt_iconv_close (cd);
       assert (ib > d);
       return (ib - d == dlen) ? dlen : ib - d + 1;
     }
-    iconv_close (cd);
+    mutt_iconv_close (cd);
   }
   else
   {
@@ -356,7 +356,7 @@ static size_t encode_block (char *s, char *d, size_t dlen,
     n1 = iconv (cd, &ib, &ibl, &ob, &obl);
     n2 = iconv (cd, 0, 0, &ob, &obl);
     assert (n1 != (size_t)(-1) && n2 != (size_t)(-1));
-    iconv_close (cd);
+    mutt_iconv_close (cd);
     return (*encoder) (s, buf1, ob - buf1, tocode);
   }
   else
@@ -854,6 +854,85 @@ out:
   FREE (charset);  /* __FREE_CHECKED__ */
 }
 
+/*
+ * Decoded values of headers with encoded words, since the same subjects
+ * and names turn up in many messages.  The results depend on the
+ * settings recorded below, so changing one of them empties the cache,
+ * as does reaching RFC2047_CACHE_SIZE entries.
+ */
+
+#define RFC2047_CACHE_SIZE 1024
+
+static HASH *DecodeCache = NULL;
+static int DecodeCacheCount = 0;
+static char *DecodeCacheCharset = NULL;
+static char *DecodeCacheAssumed = NULL;
+static int DecodeCacheIgnoreLws = 0;
+/* 7-bit text is left alone by convert_nonmime_string() */
+static int DecodeCacheAsciiSafe = 0;
+
+static void decode_cache_free_value (void *data)
+{
+  char *value = data;
+
+  FREE (&value);
+}
+
+void rfc2047_decode_cache_flush (void)
+{
+  hash_destroy (&DecodeCache, decode_cache_free_value);
+  DecodeCacheCount = 0;
+}
+
+static HASH *decode_cache (void)
+{
+  char buf[STRING];
+
+  if (DecodeCache &&
+      (DecodeCacheCount >= RFC2047_CACHE_SIZE ||
+       mutt_strcmp (DecodeCacheCharset, Charset) ||
+       mutt_strcmp (DecodeCacheAssumed, AssumedCharset) ||
+       DecodeCacheIgnoreLws != option (OPTIGNORELWS)))
+    rfc2047_decode_cache_flush ();
+
+  if (!DecodeCache)
+  {
+    DecodeCache = hash_create (RFC2047_CACHE_SIZE, MUTT_HASH_STRDUP_KEYS);
+    mutt_str_replace (&DecodeCacheCharset, Charset);
+    mutt_str_replace (&DecodeCacheAssumed, AssumedCharset);
+    DecodeCacheIgnoreLws = option (OPTIGNORELWS);
+
+    DecodeCacheAsciiSafe = !AssumedCharset;
+    if (AssumedCharset && Charset && mutt_is_ascii_superset (Charset))
+    {
+      strfcpy (buf, AssumedCharset, sizeof (buf));
+      buf[strcspn (buf, ":")] = 0;
+      DecodeCacheAsciiSafe = *buf && mutt_is_ascii_superset (buf);
+    }
+  }
+
+  return DecodeCache;
+}
+
+/* Classifies a header value in one pass.  Returns 1 if it may contain
+ * an encoded word.  Otherwise returns 0, and sets *eightbit if there
+ * are 8-bit bytes, which $assumed_charset may apply to. */
+static int rfc2047_classify (const char *s, int *eightbit)
+{
+  const unsigned char *p = (const unsigned char *) s;
+  unsigned char high = 0;
+
+  for (; *p; p++)
+  {
+    high |= *p;
+    if (*p == '=' && p[1] == '?')
+      return 1;
+  }
+
+  *eightbit = (high & 0x80) != 0;
+  return 0;
+}
+
 /* try to decode anything that looks like a valid RFC2047 encoded
  * header field, ignoring RFC822 parsing rules
  */
@@ -862,13 +941,29 @@ void rfc2047_decode (char **pd)
   const char *s = *pd;
   const char *word_begin, *word_end;
   char *word_charset = NULL, *accumulated_charset = NULL;
+  char *cached;
   size_t m, n;
-  int found_encoded = 0, rc;
+  int found_encoded = 0, rc, eightbit;
   BUFFER *d, *word, *accumulated_word;
+  HASH *cache;
 
   if (!s || !*s)
     return;
 
+  cache = decode_cache ();
+
+  if (!rfc2047_classify (s, &eightbit))
+  {
+    /* nothing to decode, and conversion wouldn't change it */
+    if (!AssumedCharset || (!eightbit && DecodeCacheAsciiSafe))
+      return;
+  }
+  else if ((cached = hash_find (cache, s)))
+  {
+    mutt_str_replace (pd, cached);
+    return;
+  }
+
   d = mutt_buffer_pool_get ();
   word = mutt_buffer_pool_get ();
   accumulated_word = mutt_buffer_pool_get ();
@@ -950,6 +1045,15 @@ void rfc2047_decode (char **pd)
     convert_and_add_text (d, s, mutt_strlen (s));
   }
 
+  if (found_encoded)
+  {
+    cached = safe_strdup (mutt_b2s (d));
+    if (hash_insert (cache, *pd, cached) != -1)
+      DecodeCacheCount++;
+    else
+      FREE (&cached);
+  }
+
   mutt_str_replace (pd, mutt_b2s (d));
 
   mutt_buffer_pool_release (&d);
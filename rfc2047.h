@@ -29,3 +29,4 @@ void rfc2047_encode_envelope (ENVELOPE *);
 void rfc2047_decode (char **);
 void rfc2047_decode_adrlist (ADDRESS *);
 void rfc2047_decode_envelope (ENVELOPE *);
+void rfc2047_decode_cache_flush (void);
@@ -86,107 +86,114 @@ static void encode_quoted (FGETCONV * fc, FILE *fout, int istext)
 {
   int c, linelen = 0;
   char line[77], savechar;
+  char bufi[HUGE_STRING];
+  size_t n, i;
 
-  while ((c = fgetconv (fc)) != EOF)
+  while ((n = fgetconv_read (bufi, sizeof (bufi), fc)) > 0)
   {
-    /* Wrap the line if needed. */
-    if (linelen == 76 && ((istext && c != '\n') || !istext))
+    for (i = 0; i < n; i++)
     {
-      /* If the last character is "quoted", then be sure to move all three
-       * characters to the next line.  Otherwise, just move the last
-       * character...
-       */
-      if (line[linelen-3] == '=')
+      c = (unsigned char) bufi[i];
+
+      /* Wrap the line if needed. */
+      if (linelen == 76 && ((istext && c != '\n') || !istext))
       {
-        line[linelen-3] = 0;
-        fputs (line, fout);
-        fputs ("=\n", fout);
-        line[linelen] = 0;
-        line[0] = '=';
-        line[1] = line[linelen-2];
-        line[2] = line[linelen-1];
-        linelen = 3;
+        /* If the last character is "quoted", then be sure to move all three
+         * characters to the next line.  Otherwise, just move the last
+         * character...
+         */
+        if (line[linelen-3] == '=')
+        {
+          line[linelen-3] = 0;
+          fputs (line, fout);
+          fputs ("=\n", fout);
+          line[linelen] = 0;
+          line[0] = '=';
+          line[1] = line[linelen-2];
+          line[2] = line[linelen-1];
+          linelen = 3;
+        }
+        else
+        {
+          savechar = line[linelen-1];
+          line[linelen-1] = '=';
+          line[linelen] = 0;
+          fputs (line, fout);
+          fputc ('\n', fout);
+          line[0] = savechar;
+          linelen = 1;
+        }
       }
-      else
+
+      /* Escape lines that begin with/only contain "the message separator". */
+      if (linelen == 4 && !mutt_strncmp ("From", line, 4))
       {
-        savechar = line[linelen-1];
-        line[linelen-1] = '=';
-        line[linelen] = 0;
-        fputs (line, fout);
-        fputc ('\n', fout);
-        line[0] = savechar;
-        linelen = 1;
+        strfcpy (line, "=46rom", sizeof (line));
+        linelen = 6;
+      }
+      else if (linelen == 4 && !mutt_strncmp ("from", line, 4))
+      {
+        strfcpy (line, "=66rom", sizeof (line));
+        linelen = 6;
+      }
+      else if (linelen == 1 && line[0] == '.')
+      {
+        strfcpy (line, "=2E", sizeof (line));
+        linelen = 3;
       }
-    }
-
-    /* Escape lines that begin with/only contain "the message separator". */
-    if (linelen == 4 && !mutt_strncmp ("From", line, 4))
-    {
-      strfcpy (line, "=46rom", sizeof (line));
-      linelen = 6;
-    }
-    else if (linelen == 4 && !mutt_strncmp ("from", line, 4))
-    {
-      strfcpy (line, "=66rom", sizeof (line));
-      linelen = 6;
-    }
-    else if (linelen == 1 && line[0] == '.')
-    {
-      strfcpy (line, "=2E", sizeof (line));
-      linelen = 3;
-    }
 
 
-    if (c == '\n' && istext)
-    {
-      /* Check to make sure there is no trailing space on this line. */
-      if (linelen > 0 && (line[linelen-1] == ' ' || line[linelen-1] == '\t'))
+      if (c == '\n' && istext)
       {
-        if (linelen < 74)
-	{
-          sprintf (line+linelen-1, "=%2.2X", (unsigned char) line[linelen-1]);
-          fputs (line, fout);
+        /* Check to make sure there is no trailing space on this line. */
+        if (linelen > 0 && (line[linelen-1] == ' ' || line[linelen-1] == '\t'))
+        {
+          if (linelen < 74)
+	  {
+            sprintf (line+linelen-1, "=%2.2X", (unsigned char) line[linelen-1]);
+            fputs (line, fout);
+          }
+          else
+	  {
+            int savechar = line[linelen-1];
+
+            line[linelen-1] = '=';
+            line[linelen] = 0;
+            fputs (line, fout);
+            fprintf (fout, "\n=%2.2X", (unsigned char) savechar);
+          }
         }
         else
-	{
-          int savechar = line[linelen-1];
-
-          line[linelen-1] = '=';
+        {
           line[linelen] = 0;
           fputs (line, fout);
-          fprintf (fout, "\n=%2.2X", (unsigned char) savechar);
         }
+        fputc ('\n', fout);
+        linelen = 0;
       }
-      else
+      else if (c != 9 && (c < 32 || c > 126 || c == '='))
       {
-        line[linelen] = 0;
-        fputs (line, fout);
+        /* Check to make sure there is enough room for the quoted character.
+         * If not, wrap to the next line.
+         */
+        if (linelen > 73)
+        {
+          line[linelen++] = '=';
+          line[linelen] = 0;
+          fputs (line, fout);
+          fputc ('\n', fout);
+          linelen = 0;
+        }
+        sprintf (line+linelen,"=%2.2X", (unsigned char) c);
+        linelen += 3;
       }
-      fputc ('\n', fout);
-      linelen = 0;
-    }
-    else if (c != 9 && (c < 32 || c > 126 || c == '='))
-    {
-      /* Check to make sure there is enough room for the quoted character.
-       * If not, wrap to the next line.
-       */
-      if (linelen > 73)
+      else
       {
-        line[linelen++] = '=';
-        line[linelen] = 0;
-        fputs (line, fout);
-        fputc ('\n', fout);
-        linelen = 0;
+        /* Don't worry about wrapping the line here.  That will happen during
+         * the next iteration when I'll also know what the next character is.
+         */
+        line[linelen++] = c;
       }
-      sprintf (line+linelen,"=%2.2X", (unsigned char) c);
-      linelen += 3;
-    }
-    else
-    {
-      /* Don't worry about wrapping the line here.  That will happen during
-       * the next iteration when I'll also know what the next character is.
-       */
-      line[linelen++] = c;
     }
   }
 
@@ -214,84 +221,44 @@ static void encode_quoted (FGETCONV * fc, FILE *fout, int istext)
   }
 }
 
-static char b64_buffer[3];
-static short b64_num;
-static short b64_linelen;
-
-static void b64_flush(FILE *fout)
+static void encode_base64 (FGETCONV * fc, FILE *fout, int istext)
 {
-  short i;
+  unsigned char bufi[HUGE_STRING], text[2 * HUGE_STRING], *in;
+  char bufo[B64_ENCODE_SIZE (2 * HUGE_STRING)];
+  B64_ENCODER enc;
+  size_t n, i, l;
+  int ch1 = EOF;
 
-  if (!b64_num)
-    return;
+  memset (&enc, 0, sizeof (enc));
 
-  if (b64_linelen >= 72)
+  while ((n = fgetconv_read ((char *) bufi, sizeof (bufi), fc)) > 0)
   {
-    fputc('\n', fout);
-    b64_linelen = 0;
-  }
-
-  for (i = b64_num; i < 3; i++)
-    b64_buffer[i] = '\0';
-
-  fputc(B64Chars[(b64_buffer[0] >> 2) & 0x3f], fout);
-  b64_linelen++;
-  fputc(B64Chars[((b64_buffer[0] & 0x3) << 4) | ((b64_buffer[1] >> 4) & 0xf) ], fout);
-  b64_linelen++;
-
-  if (b64_num > 1)
-  {
-    fputc(B64Chars[((b64_buffer[1] & 0xf) << 2) | ((b64_buffer[2] >> 6) & 0x3) ], fout);
-    b64_linelen++;
-    if (b64_num > 2)
+    in = bufi;
+    if (istext)
     {
-      fputc(B64Chars[b64_buffer[2] & 0x3f], fout);
-      b64_linelen++;
+      /* text parts are encoded with CRLF line endings */
+      for (i = l = 0; i < n; i++)
+      {
+        if (bufi[i] == '\n' && ch1 != '\r')
+          text[l++] = '\r';
+        text[l++] = ch1 = bufi[i];
+      }
+      in = text;
+      n = l;
     }
+    fwrite (bufo, 1, mutt_b64_encode_block (&enc, bufo, in, n), fout);
   }
-
-  while (b64_linelen % 4)
-  {
-    fputc('=', fout);
-    b64_linelen++;
-  }
-
-  b64_num = 0;
-}
-
-
-static void b64_putc(char c, FILE *fout)
-{
-  if (b64_num == 3)
-    b64_flush(fout);
-
-  b64_buffer[b64_num++] = c;
-}
-
-
-static void encode_base64 (FGETCONV * fc, FILE *fout, int istext)
-{
-  int ch, ch1 = EOF;
-
-  b64_num = b64_linelen = 0;
-
-  while ((ch = fgetconv (fc)) != EOF)
-  {
-    if (istext && ch == '\n' && ch1 != '\r')
-      b64_putc('\r', fout);
-    b64_putc(ch, fout);
-    ch1 = ch;
-  }
-  b64_flush(fout);
+  fwrite (bufo, 1, mutt_b64_encode_finish (&enc, bufo), fout);
   fputc('\n', fout);
 }
 
 static void encode_8bit (FGETCONV *fc, FILE *fout, int istext)
 {
-  int ch;
+  char buf[HUGE_STRING];
+  size_t n;
 
-  while ((ch = fgetconv (fc)) != EOF)
-    fputc (ch, fout);
+  while ((n = fgetconv_read (buf, sizeof (buf), fc)) > 0)
+    fwrite (buf, 1, n, fout);
 }
 
 
@@ -669,7 +636,7 @@ static size_t convert_file_to (FILE *file, const char *fromcode,
 {
 #ifdef HAVE_ICONV
   iconv_t cd1, *cd;
-  char bufi[256], bufu[512], bufo[4 * sizeof (bufi)];
+  char bufi[HUGE_STRING], bufu[2 * HUGE_STRING], bufo[4 * sizeof (bufi)];
   ICONV_CONST char *ib, *ub;
   char *ob;
   size_t ibl, obl, ubl, ubl1, n, ret;
@@ -783,9 +750,9 @@ static size_t convert_file_to (FILE *file, const char *fromcode,
 
   for (i = 0; i < ncodes; i++)
     if (cd[i] != (iconv_t)(-1))
-      iconv_close (cd[i]);
+      mutt_iconv_close (cd[i]);
 
-  iconv_close (cd1);
+  mutt_iconv_close (cd1);
   FREE (&cd);
   FREE (&infos);
   FREE (&score);
@@ -879,6 +846,59 @@ static size_t convert_file_from_to (FILE *file,
   return ret;
 }
 
+/* Copies to buf the first charset of a colon-separated list that
+ * convert_file_to() would use: one iconv can convert to UTF-8 from
+ * (from != 0), or to from UTF-8 (from == 0). */
+static int first_charset (char *buf, size_t buflen, const char *charsets,
+                          int from)
+{
+  const char *c, *c1;
+  iconv_t cd;
+
+  for (c = charsets; c; c = c1 ? c1 + 1 : 0)
+  {
+    if ((c1 = strchr (c, ':')) == c)
+      continue;
+    strfcpy (buf, c, c1 ? MIN (buflen, (size_t)(c1 - c) + 1) : buflen);
+
+    /* Special case for conversion to UTF-8 */
+    if (!from && !ascii_strcasecmp (buf, "utf-8"))
+      return 1;
+
+    if (from)
+      cd = mutt_iconv_open ("utf-8", buf, 0);
+    else
+      cd = mutt_iconv_open (buf, "utf-8", 0);
+    if (cd != (iconv_t)(-1))
+    {
+      mutt_iconv_close (cd);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Counts the file, as long as it is 7-bit.  Returns 1 if the whole
+ * file was counted, 0 when an 8-bit byte stopped the scan. */
+static int scan_7bit (FILE *fp, CONTENT *info, CONTENT_STATE *state)
+{
+  char buffer[HUGE_STRING];
+  size_t r, i;
+
+  rewind (fp);
+  while ((r = fread (buffer, 1, sizeof (buffer), fp)))
+  {
+    for (i = 0; i < r; i++)
+      if (buffer[i] & 0x80)
+        return 0;
+    update_content_info (info, state, buffer, r);
+  }
+  update_content_info (info, state, 0, 0);
+
+  return 1;
+}
+
 /*
  * Analyze the contents of a file to determine which MIME encoding to use.
  * Also set the body charset, sometimes, or not.
@@ -890,8 +910,9 @@ CONTENT *mutt_get_content_info (const char *fname, BODY *b)
   FILE *fp = NULL;
   char *fromcode = NULL;
   char *tocode;
-  char buffer[100];
+  char buffer[HUGE_STRING];
   char chsbuf[STRING];
+  char fbuf[STRING], tbuf[STRING];
   size_t r;
 
   struct stat sb;
@@ -926,9 +947,33 @@ CONTENT *mutt_get_content_info (const char *fname, BODY *b)
   {
     char *chs = mutt_get_parameter ("charset", b->parameter);
     char *fchs = b->use_disp ? (AttachCharset ? AttachCharset : Charset) : Charset;
-    if (Charset && (chs || SendCharset) &&
-        convert_file_from_to (fp, fchs, chs ? chs : SendCharset,
-                              &fromcode, &tocode, info) != (size_t)(-1))
+    char *tchs = chs ? chs : SendCharset;
+    int converted = 0;
+
+    if (Charset && tchs)
+    {
+      /* 7-bit text converts unchanged between ASCII supersets, so the
+       * first usable candidates win without trying iconv on the file */
+      if (first_charset (fbuf, sizeof (fbuf), fchs, 1) &&
+          mutt_is_ascii_superset (fbuf) &&
+          first_charset (tbuf, sizeof (tbuf), tchs, 0) &&
+          mutt_is_ascii_superset (tbuf) &&
+          scan_7bit (fp, info, &state))
+      {
+        fromcode = safe_strdup (fbuf);
+        tocode = safe_strdup (tbuf);
+        converted = 1;
+      }
+      else
+      {
+        memset (info, 0, sizeof (CONTENT));
+        memset (&state, 0, sizeof (state));
+        converted = convert_file_from_to (fp, fchs, tchs, &fromcode, &tocode,
+                                          info) != (size_t)(-1);
+      }
+    }
+
+    if (converted)
     {
       if (!chs)
       {
@@ -1274,26 +1319,90 @@ char *mutt_get_body_charset (char *d, size_t dlen, BODY *b)
 }
 
 
+/* The settings the charset conversion in mutt_get_content_info()
+ * depends on, or NULL if it won't convert. */
+static char *content_info_charsets (BODY *a)
+{
+  BUFFER *buf;
+  char *charsets;
+
+  if (a->type != TYPETEXT || a->noconv || a->force_charset)
+    return NULL;
+
+  buf = mutt_buffer_pool_get ();
+  mutt_buffer_printf (buf, "%s;%s;%s", NONULL (Charset),
+                      a->use_disp ? NONULL (AttachCharset) : "",
+                      NONULL (SendCharset));
+  charsets = safe_strdup (mutt_b2s (buf));
+  mutt_buffer_pool_release (&buf);
+
+  return charsets;
+}
+
+/* Remembers which file and settings info was computed from.  st must
+ * have been taken before the file was scanned. */
+static void content_info_stamp (CONTENT *info, const struct stat *st,
+                                char **charsets)
+{
+  /* a file modified within the current second could be modified again
+   * without changing its mtime, so it isn't remembered */
+  if (st->st_mtime >= time (NULL))
+    return;
+
+  info->mtime = st->st_mtime;
+  info->size = st->st_size;
+  FREE (&info->charsets);
+  info->charsets = *charsets;
+  *charsets = NULL;
+}
+
 /* Assumes called from send mode where BODY->filename points to actual file */
 void mutt_update_encoding (BODY *a)
 {
   CONTENT *info;
   char chsbuff[STRING];
+  char *charsets;
+  struct stat st;
+  int have_st;
 
   /* override noconv when it's us-ascii */
   if (mutt_is_us_ascii (mutt_get_body_charset (chsbuff, sizeof (chsbuff), a)))
     a->noconv = 0;
 
+  charsets = content_info_charsets (a);
+  have_st = a->filename && stat (a->filename, &st) == 0;
+
+  /* The file was scanned with the same settings and hasn't changed
+   * since.  The charset parameter is still the one chosen then. */
+  if (have_st && a->content && a->content->mtime &&
+      a->content->mtime == st.st_mtime && a->content->size == st.st_size &&
+      !mutt_strcmp (a->content->charsets, charsets))
+  {
+    dprint (2, (debugfile, "mutt_update_encoding: reusing content info for %s\n",
+                a->filename));
+    FREE (&charsets);
+    mutt_set_encoding (a, a->content);
+    mutt_stamp_attachment(a);
+    return;
+  }
+
   if (!a->force_charset && !a->noconv)
     mutt_delete_parameter ("charset", &a->parameter);
 
   if ((info = mutt_get_content_info (a->filename, a)) == NULL)
+  {
+    FREE (&charsets);
     return;
+  }
 
   mutt_set_encoding (a, info);
   mutt_stamp_attachment(a);
 
-  FREE (&a->content);
+  if (have_st)
+    content_info_stamp (info, &st, &charsets);
+  FREE (&charsets);
+
+  mutt_free_content (&a->content);
   a->content = info;
 
 }
@@ -1589,6 +1698,8 @@ BODY *mutt_make_file_attach (const char *path)
 {
   BODY *att;
   CONTENT *info;
+  struct stat st;
+  char *charsets;
 
   if (!(path && *path))
     return NULL;
@@ -1610,13 +1721,24 @@ BODY *mutt_make_file_attach (const char *path)
       !option (OPTMIMETYPEQUERYFIRST))
     run_mime_type_query (att);
 
+  if (stat (path, &st) == -1)
+    memset (&st, 0, sizeof (st));
+
   if ((info = mutt_get_content_info (path, att)) == NULL)
   {
     mutt_free_body (&att);
     return NULL;
   }
 
-  if (!att->subtype)
+  if (att->subtype)
+  {
+    /* scanned as what it is, so mutt_update_encoding() can reuse it */
+    charsets = content_info_charsets (att);
+    content_info_stamp (info, &st, &charsets);
+    FREE (&charsets);
+    att->content = info;
+  }
+  else
   {
     if ((info->nulbin == 0) &&
         (info->lobin == 0 || (info->lobin + info->hibin + info->ascii)/ info->lobin >= 10))
@@ -1633,9 +1755,9 @@ BODY *mutt_make_file_attach (const char *path)
       att->type = TYPEAPPLICATION;
       att->subtype = safe_strdup ("octet-stream");
     }
+    mutt_free_content (&info);
   }
 
-  FREE(&info);
   mutt_update_encoding (att);
   return (att);
 }
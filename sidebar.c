@@ -46,6 +46,29 @@ static int EntryCount = 0;
 static int EntryLen   = 0;
 static SBENTRY **Entries = NULL;
 
+/**
+ * struct sidebar_row - What draw_sidebar() last put on a sidebar row
+ *
+ * Rows whose mailbox, name, counts and colour are unchanged are not
+ * formatted and printed again.
+ */
+typedef struct sidebar_row
+{
+  SBENTRY     *entry;
+  int          color;
+  int          cursor;          /* 0, or MT_COLOR_INDICATOR/HIGHLIGHT */
+  int          msg_count;
+  int          msg_unread;
+  int          msg_flagged;
+  short        new;
+  char         name[STRING];
+} SBROW;
+
+static SBROW *Rows    = NULL;
+static int RowsLen    = 0;
+static int RowsDrawn  = 0;   /* Rows showing an entry on the screen */
+static int RowsValid  = 0;   /* Rows describes the screen contents */
+
 static int TopIndex = -1;    /* First mailbox visible in sidebar */
 static int OpnIndex = -1;    /* Current (open) mailbox */
 static int HilIndex = -1;    /* Highlighted mailbox */
@@ -353,14 +376,48 @@ static void unsort_entries (void)
   }
 }
 
+/**
+ * resort_entries - Restore the order of an already sorted Entries array
+ *
+ * Between two draws only the entries whose counts changed, and newly
+ * added mailboxes, are out of place.  An insertion sort moves just those,
+ * and needs a single comparison per entry when nothing changed.  Like
+ * the qsort it replaces, it keeps equal entries in their current order.
+ */
+static void resort_entries (void)
+{
+  SBENTRY *tmp;
+  int i, lo, hi, mid;
+
+  for (i = 1; i < EntryCount; i++)
+  {
+    if (cb_qsort_sbe (&Entries[i - 1], &Entries[i]) <= 0)
+      continue;
+
+    tmp = Entries[i];
+    lo = 0;
+    hi = i - 1;
+    while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (cb_qsort_sbe (&Entries[mid], &tmp) <= 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    memmove (&Entries[lo + 1], &Entries[lo], (i - lo) * sizeof (*Entries));
+    Entries[lo] = tmp;
+  }
+}
+
 /**
  * sort_entries - Sort Entries array.
  *
  * Sort the Entries array according to the current sort config
- * option "sidebar_sort_method". This calls qsort to do the work which calls our
- * callback function "cb_qsort_sbe".
- *
- * Once sorted, the prev/next links will be reconstructed.
+ * option "sidebar_sort_method".  When the sort method changes, qsort
+ * does the work with our callback function "cb_qsort_sbe".  Otherwise
+ * the array is still sorted from the last call and resort_entries()
+ * only repositions entries whose sort keys changed.
  */
 static void sort_entries (void)
 {
@@ -372,7 +429,12 @@ static void sort_entries (void)
       (ssm == SORT_FLAGGED)   ||
       (ssm == SORT_PATH)      ||
       (ssm == SORT_SUBJECT))
-    qsort (Entries, EntryCount, sizeof (*Entries), cb_qsort_sbe);
+  {
+    if (SidebarSortMethod != PreviousSort)
+      qsort (Entries, EntryCount, sizeof (*Entries), cb_qsort_sbe);
+    else
+      resort_entries ();
+  }
   else if ((ssm == SORT_ORDER) &&
            (SidebarSortMethod != PreviousSort))
     unsort_entries ();
@@ -626,8 +688,10 @@ static void calculate_depth (const char *path, const char *lastpath,
 static void draw_sidebar (int num_rows, int num_cols, int div_width)
 {
   int entryidx;
-  int entry_color;
+  int entry_color, cursor_color;
+  int cache;
   SBENTRY *entry;
+  SBROW *r;
   BUFFY *b;
   int maildir_is_prefix;
   int indent_width = -1;
@@ -642,6 +706,17 @@ static void draw_sidebar (int num_rows, int num_cols, int div_width)
   last_folder_name = mutt_buffer_pool_get ();
   indent_folder_name = mutt_buffer_pool_get ();
 
+  if (num_rows > RowsLen)
+  {
+    safe_realloc (&Rows, num_rows * sizeof (SBROW));
+    memset (Rows + RowsLen, 0, (num_rows - RowsLen) * sizeof (SBROW));
+    RowsLen = num_rows;
+  }
+
+  /* a format filter may give different output for the same mailbox */
+  size_t fmtlen = mutt_strlen (SidebarFormat);
+  cache = RowsValid && !(fmtlen > 1 && SidebarFormat[fmtlen - 1] == '|');
+
   int w = num_cols - div_width;
   int row = 0;
   for (entryidx = TopIndex; (entryidx < EntryCount) && (row < num_rows); entryidx++)
@@ -666,19 +741,15 @@ static void draw_sidebar (int num_rows, int num_cols, int div_width)
     {
       if ((ColorDefs[MT_COLOR_SB_INDICATOR].pair != 0 ||
            ColorDefs[MT_COLOR_SB_INDICATOR].attrs != 0))
-	mutt_attrset_cursor (ColorDefs[entry_color],
-		ColorDefs[MT_COLOR_SB_INDICATOR]);
+        cursor_color = MT_COLOR_SB_INDICATOR;
       else
-	mutt_attrset_cursor (ColorDefs[entry_color],
-		ColorDefs[MT_COLOR_INDICATOR]);
+        cursor_color = MT_COLOR_INDICATOR;
     }
     else if (entryidx == HilIndex)
-      mutt_attrset_cursor (ColorDefs[entry_color],
-	      ColorDefs[MT_COLOR_HIGHLIGHT]);
+      cursor_color = MT_COLOR_HIGHLIGHT;
     else
-      SETCOLOR(entry_color);
+      cursor_color = 0;
 
-    mutt_window_move (MuttSidebarWindow, row, 0);
     if (Context && Context->realpath && !b->nopoll &&
         !mutt_strcmp (b->realpath, Context->realpath))
     {
@@ -801,6 +872,37 @@ static void draw_sidebar (int num_rows, int num_cols, int div_width)
     else if (b->label)
       sidebar_folder_name = b->label;
 
+    /* The open mailbox is always redrawn: its row shows Context counts */
+    r = &Rows[row];
+    if (cache && (row < RowsDrawn) && (entryidx != OpnIndex) &&
+        (r->entry == entry) &&
+        (r->color == entry_color) && (r->cursor == cursor_color) &&
+        (r->msg_count == b->msg_count) &&
+        (r->msg_unread == b->msg_unread) &&
+        (r->msg_flagged == b->msg_flagged) &&
+        (r->new == b->new) &&
+        !mutt_strcmp (r->name, sidebar_folder_name))
+    {
+      row++;
+      continue;
+    }
+
+    r->entry       = entry;
+    r->color       = entry_color;
+    r->cursor      = cursor_color;
+    r->msg_count   = b->msg_count;
+    r->msg_unread  = b->msg_unread;
+    r->msg_flagged = b->msg_flagged;
+    r->new         = b->new;
+    strfcpy (r->name, sidebar_folder_name, sizeof (r->name));
+
+    if (cursor_color)
+      mutt_attrset_cursor (ColorDefs[entry_color], ColorDefs[cursor_color]);
+    else
+      SETCOLOR(entry_color);
+
+    mutt_window_move (MuttSidebarWindow, row, 0);
+
     char str[STRING];
     make_sidebar_entry (str, sizeof (str), w, sidebar_folder_name, entry);
     printw ("%s", str);
@@ -811,15 +913,21 @@ static void draw_sidebar (int num_rows, int num_cols, int div_width)
   mutt_buffer_pool_release (&last_folder_name);
   mutt_buffer_pool_release (&indent_folder_name);
 
-  fill_empty_space (row, num_rows - row, w);
+  /* rows past the last entry are still blank from the last draw */
+  if (!RowsValid || (row < RowsDrawn))
+    fill_empty_space (row, (RowsValid ? RowsDrawn : num_rows) - row, w);
+
+  RowsDrawn = row;
+  RowsValid = 1;
 }
 
 
 /**
- * mutt_sb_draw - Completely redraw the sidebar
+ * mutt_sb_draw - Redraw the sidebar
  *
- * Completely refresh the sidebar region.  First draw the divider; then, for
- * each BUFFY, call make_sidebar_entry; finally blank out any remaining space.
+ * Refresh the sidebar region.  First draw the divider; then, for each BUFFY
+ * whose row changed, call make_sidebar_entry; finally blank out any
+ * remaining space.  After mutt_sb_invalidate() every row is drawn.
  */
 void mutt_sb_draw (void)
 {
@@ -832,16 +940,34 @@ void mutt_sb_draw (void)
   if (!num_cols)
     return;
 
-  int div_width = draw_divider (num_rows, num_cols);
+  int div_width;
+  if (RowsValid)
+    div_width = mutt_strwidth (SidebarDividerChar);
+  else
+    div_width = draw_divider (num_rows, num_cols);
   if ((div_width < 0) || (div_width >= num_cols))
     return;
 
   if (!prepare_sidebar (num_rows))
+  {
     fill_empty_space (0, num_rows, num_cols - div_width);
+    RowsValid = 0;
+  }
   else
     draw_sidebar (num_rows, num_cols, div_width);
 }
 
+/**
+ * mutt_sb_invalidate - Forget what the sidebar rows show
+ *
+ * Called when the screen was cleared, or when a setting changed how the
+ * rows look.  The next mutt_sb_draw() draws the divider and every row.
+ */
+void mutt_sb_invalidate (void)
+{
+  RowsValid = 0;
+}
+
 /**
  * select_first - Selects the first unhidden mailbox
  *
@@ -1126,22 +1252,16 @@ void mutt_sb_set_buffystats (const CONTEXT *ctx)
 {
   /* Even if the sidebar's hidden,
    * we should take note of the new data. */
-  BUFFY *b = Incoming;
-  if (!ctx || !b)
+  BUFFY *b;
+  if (!ctx)
     return;
 
-  for (; b; b = b->next)
+  b = mutt_buffy_find_realpath (ctx->realpath);
+  if (b && !b->nopoll)
   {
-    if (!mutt_strcmp (b->realpath, ctx->realpath))
-    {
-      if (!b->nopoll)
-      {
-        b->msg_unread  = ctx->unread;
-        b->msg_count   = ctx->msgcount;
-        b->msg_flagged = ctx->flagged;
-      }
-      break;
-    }
+    b->msg_unread  = ctx->unread;
+    b->msg_count   = ctx->msgcount;
+    b->msg_flagged = ctx->flagged;
   }
 }
 
@@ -1254,5 +1374,7 @@ void mutt_sb_notify_mailbox (BUFFY *b, int created)
       Entries[del_index] = Entries[del_index + 1];
   }
 
+  /* Rows may point at the freed entry */
+  RowsValid = 0;
   mutt_set_current_menu_redraw (REDRAW_SIDEBAR);
 }
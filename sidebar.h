@@ -26,6 +26,7 @@
 void         mutt_sb_change_mailbox (int op);
 void         mutt_sb_draw (void);
 const char * mutt_sb_get_highlight (void);
+void         mutt_sb_invalidate (void);
 void         mutt_sb_notify_mailbox (BUFFY *b, int created);
 void         mutt_sb_set_buffystats (const CONTEXT *ctx);
 BUFFY *      mutt_sb_set_open_buffy (void);
@@ -52,6 +52,9 @@
 #define SMTP_PORT 25
 #define SMTPS_PORT 465
 
+/* size of the blocks the message is sent in */
+#define SMTP_BLOCK_SIZE 65536
+
 #define SMTP_AUTH_SUCCESS 0
 #define SMTP_AUTH_UNAVAIL 1
 #define SMTP_AUTH_FAIL    -1
@@ -62,6 +65,8 @@ enum {
   DSN,
   EIGHTBITMIME,
   SMTPUTF8,
+  PIPELINING,
+  CHUNKING,
 
   CAPMAX
 };
@@ -79,6 +84,12 @@ static int Esmtp = 0;
 static char* AuthMechs = NULL;
 static unsigned char Capabilities[(CAPMAX + 7)/ 8];
 
+/* connection kept open after a send for $smtp_idle_timeout.  Capabilities
+ * above still describe it. */
+static CONNECTION *IdleConn = NULL;
+static time_t IdleSince = 0;
+static int IdleEsmtp = 0;
+
 static int smtp_code (char *buf, size_t len, int *n)
 {
   char code[4];
@@ -128,6 +139,10 @@ smtp_get_resp (CONNECTION * conn)
       mutt_bit_set (Capabilities, STARTTLS);
     else if (!ascii_strncasecmp ("SMTPUTF8", buf + 4, 8))
       mutt_bit_set (Capabilities, SMTPUTF8);
+    else if (!ascii_strncasecmp ("PIPELINING", buf + 4, 10))
+      mutt_bit_set (Capabilities, PIPELINING);
+    else if (!ascii_strncasecmp ("CHUNKING", buf + 4, 8))
+      mutt_bit_set (Capabilities, CHUNKING);
 
     if (smtp_code (buf, n, &n) < 0)
       return smtp_err_code;
@@ -141,11 +156,12 @@ smtp_get_resp (CONNECTION * conn)
   return -1;
 }
 
+/* Appends a RCPT TO command for each address in a to cmds.
+ * Returns the number of commands added. */
 static int
-smtp_rcpt_to (CONNECTION * conn, const ADDRESS * a)
+smtp_rcpt_to (BUFFER *cmds, const ADDRESS * a)
 {
-  char buf[1024];
-  int r;
+  int n = 0;
 
   while (a)
   {
@@ -156,28 +172,109 @@ smtp_rcpt_to (CONNECTION * conn, const ADDRESS * a)
       continue;
     }
     if (mutt_bit_isset (Capabilities, DSN) && DsnNotify)
-      snprintf (buf, sizeof (buf), "RCPT TO:<%s> NOTIFY=%s\r\n",
-                a->mailbox, DsnNotify);
+      mutt_buffer_add_printf (cmds, "RCPT TO:<%s> NOTIFY=%s\r\n",
+                              a->mailbox, DsnNotify);
     else
-      snprintf (buf, sizeof (buf), "RCPT TO:<%s>\r\n", a->mailbox);
-    if (mutt_socket_write (conn, buf) == -1)
+      mutt_buffer_add_printf (cmds, "RCPT TO:<%s>\r\n", a->mailbox);
+    n++;
+    a = a->next;
+  }
+
+  return n;
+}
+
+/* Sends the CRLF terminated commands in cmds.  If the server supports
+ * PIPELINING (RFC 2920), they all go out in one write and the ncmds
+ * responses are read afterwards, otherwise each command waits for its
+ * response.  Returns 0, or the first error. */
+static int
+smtp_exec_cmds (CONNECTION * conn, BUFFER *cmds, int ncmds)
+{
+  char *cmd, *eol;
+  int r, rc = 0;
+
+  if (mutt_bit_isset (Capabilities, PIPELINING))
+  {
+    if (mutt_socket_write (conn, mutt_b2s (cmds)) == -1)
+      return smtp_err_write;
+
+    while (ncmds--)
+    {
+      if ((r = smtp_get_resp (conn)))
+      {
+        /* the remaining responses can't be matched up anymore */
+        if (r != -1)
+          return r;
+        if (!rc)
+          rc = r;
+      }
+    }
+    return rc;
+  }
+
+  for (cmd = cmds->data; cmd && *cmd; cmd = eol)
+  {
+    if (!(eol = strstr (cmd, "\r\n")))
+      break;
+    eol += 2;
+    if (mutt_socket_write_n (conn, cmd, eol - cmd) == -1)
       return smtp_err_write;
     if ((r = smtp_get_resp (conn)))
       return r;
-    a = a->next;
   }
 
   return 0;
 }
 
+/* Sends block as message data and clears it.  With bdat the block is
+ * sent as a BDAT chunk (RFC 3030), and the response is only counted in
+ * *pending when the server supports PIPELINING. */
+static int
+smtp_send_block (CONNECTION * conn, BUFFER *block, int bdat, int last,
+                 int *pending)
+{
+  char buf[SHORT_STRING];
+  int r;
+
+  if (bdat)
+  {
+    snprintf (buf, sizeof (buf), "BDAT %lu%s\r\n",
+              (unsigned long) mutt_buffer_len (block), last ? " LAST" : "");
+    if (mutt_socket_write (conn, buf) == -1)
+      return smtp_err_write;
+  }
+
+  if (mutt_buffer_len (block) &&
+      mutt_socket_write_d (conn, block->data, mutt_buffer_len (block),
+                           MUTT_SOCK_LOG_FULL) == -1)
+    return smtp_err_write;
+  mutt_buffer_clear (block);
+
+  if (bdat)
+  {
+    if (mutt_bit_isset (Capabilities, PIPELINING))
+      (*pending)++;
+    else if ((r = smtp_get_resp (conn)))
+      return r;
+  }
+
+  return 0;
+}
+
+/* Sends msgfile with DATA, or with BDAT if the server supports
+ * CHUNKING.  The message is converted to CRLF line endings (and
+ * dot-stuffed for DATA) into blocks of SMTP_BLOCK_SIZE, so large
+ * messages aren't written out a line at a time. */
 static int
 smtp_data (CONNECTION * conn, const char *msgfile)
 {
   char buf[1024];
   FILE *fp = 0;
+  BUFFER *block = NULL;
   progress_t progress;
   struct stat st;
-  int r, term = 0;
+  int r, term = 0, bol = 1, pending = 0;
+  int bdat = mutt_bit_isset (Capabilities, CHUNKING);
   size_t buflen = 0;
 
   fp = fopen (msgfile, "r");
@@ -191,55 +288,64 @@ smtp_data (CONNECTION * conn, const char *msgfile)
   mutt_progress_init (&progress, _("Sending message..."), MUTT_PROGRESS_SIZE,
                       NetInc, st.st_size);
 
-  snprintf (buf, sizeof (buf), "DATA\r\n");
-  if (mutt_socket_write (conn, buf) == -1)
+  if (!bdat)
   {
-    safe_fclose (&fp);
-    return smtp_err_write;
-  }
-  if ((r = smtp_get_resp (conn)))
-  {
-    safe_fclose (&fp);
-    return r;
+    snprintf (buf, sizeof (buf), "DATA\r\n");
+    if (mutt_socket_write (conn, buf) == -1)
+    {
+      r = smtp_err_write;
+      goto out;
+    }
+    if ((r = smtp_get_resp (conn)))
+      goto out;
   }
 
+  block = mutt_buffer_new ();
+  mutt_buffer_increase_size (block, SMTP_BLOCK_SIZE + sizeof (buf) + 1);
+
   while (fgets (buf, sizeof (buf) - 1, fp))
   {
     buflen = mutt_strlen (buf);
     term = buflen && buf[buflen-1] == '\n';
     if (term && (buflen == 1 || buf[buflen - 2] != '\r'))
-      snprintf (buf + buflen - 1, sizeof (buf) - buflen + 1, "\r\n");
-    if (buf[0] == '.')
     {
-      if (mutt_socket_write_d (conn, ".", -1, MUTT_SOCK_LOG_FULL) == -1)
-      {
-        safe_fclose (&fp);
-        return smtp_err_write;
-      }
+      buf[buflen - 1] = '\r';
+      buf[buflen++] = '\n';
     }
-    if (mutt_socket_write_d (conn, buf, -1, MUTT_SOCK_LOG_FULL) == -1)
+    if (!bdat && bol && buf[0] == '.')
+      mutt_buffer_addch (block, '.');
+    mutt_buffer_addstr_n (block, buf, buflen);
+    bol = term;
+
+    if (mutt_buffer_len (block) >= SMTP_BLOCK_SIZE)
     {
-      safe_fclose (&fp);
-      return smtp_err_write;
+      if ((r = smtp_send_block (conn, block, bdat, 0, &pending)))
+        goto out;
+      mutt_progress_update (&progress, ftell (fp), -1);
     }
-    mutt_progress_update (&progress, ftell (fp), -1);
-  }
-  if (!term && buflen &&
-      mutt_socket_write_d (conn, "\r\n", -1, MUTT_SOCK_LOG_FULL) == -1)
-  {
-    safe_fclose (&fp);
-    return smtp_err_write;
   }
-  safe_fclose (&fp);
+  if (!term && buflen)
+    mutt_buffer_addstr (block, "\r\n");
 
   /* terminate the message body */
-  if (mutt_socket_write (conn, ".\r\n") == -1)
-    return smtp_err_write;
+  if (!bdat)
+    mutt_buffer_addstr (block, ".\r\n");
+  if ((r = smtp_send_block (conn, block, bdat, 1, &pending)))
+    goto out;
+  mutt_progress_update (&progress, st.st_size, -1);
+
+  if (!bdat)
+    pending = 1;
+  while (pending--)
+    if ((r = smtp_get_resp (conn)))
+      goto out;
 
-  if ((r = smtp_get_resp (conn)))
-    return r;
+  r = 0;
 
-  return 0;
+out:
+  safe_fclose (&fp);
+  mutt_buffer_free (&block);
+  return r;
 }
 
 
@@ -276,6 +382,72 @@ static int addresses_use_unicode(const ADDRESS* a)
 }
 
 
+/* conn_dispatch hook for the idle connection: the server only speaks up
+ * on its own to say goodbye (e.g. a 421 timeout), so just close it. */
+static int smtp_idle_dispatch (CONNECTION *conn)
+{
+  dprint (2, (debugfile, "smtp_idle_dispatch: server closed idle connection\n"));
+  conn->conn_dispatch = NULL;
+  mutt_socket_close (conn);
+  if (conn == IdleConn)
+    IdleConn = NULL;
+
+  return 0;
+}
+
+/* closes the connection kept open for reuse, if any */
+void mutt_smtp_logout (void)
+{
+  CONNECTION *conn = IdleConn;
+
+  if (!conn)
+    return;
+
+  IdleConn = NULL;
+  conn->conn_dispatch = NULL;
+  if (conn->fd >= 0)
+  {
+    mutt_socket_write (conn, "QUIT\r\n");
+    mutt_socket_close (conn);
+  }
+}
+
+/* Takes over the idle connection if it is conn, and resets its
+ * transaction state with RSET.  Returns 0 if conn is ready for the
+ * next message, 1 if it has to be opened anew. */
+static int smtp_reuse (CONNECTION *conn)
+{
+  if (conn != IdleConn)
+  {
+    mutt_smtp_logout ();
+    return 1;
+  }
+
+  IdleConn = NULL;
+  conn->conn_dispatch = NULL;
+  if (conn->fd < 0)
+    return 1;
+
+  /* a HELO session can't do what EHLO was asked for */
+  if (time (NULL) - IdleSince > SmtpIdleTimeout || (Esmtp && !IdleEsmtp))
+  {
+    mutt_socket_write (conn, "QUIT\r\n");
+    mutt_socket_close (conn);
+    return 1;
+  }
+
+  if (mutt_socket_write (conn, "RSET\r\n") == -1 || smtp_get_resp (conn))
+  {
+    dprint (1, (debugfile, "smtp_reuse: RSET failed, reconnecting\n"));
+    mutt_socket_close (conn);
+    return 1;
+  }
+
+  dprint (2, (debugfile, "smtp_reuse: reusing connection to %s\n",
+              conn->account.host));
+  return 0;
+}
+
 int
 mutt_smtp_send (const ADDRESS* from, const ADDRESS* to, const ADDRESS* cc,
                 const ADDRESS* bcc, const char *msgfile, int eightbit)
@@ -284,7 +456,8 @@ mutt_smtp_send (const ADDRESS* from, const ADDRESS* to, const ADDRESS* cc,
   ACCOUNT account;
   const char* envfrom;
   char buf[1024];
-  int ret = -1;
+  BUFFER *cmds = NULL;
+  int ret = -1, ncmds;
 
   /* it might be better to synthesize an envelope from from user and host
    * but this condition is most likely arrived at accidentally */
@@ -305,11 +478,12 @@ mutt_smtp_send (const ADDRESS* from, const ADDRESS* to, const ADDRESS* cc,
     return -1;
 
   Esmtp = eightbit;
+  cmds = mutt_buffer_pool_get ();
 
   do
   {
-    /* send our greeting */
-    if (( ret = smtp_open (conn)))
+    /* send our greeting, unless the last connection is still usable */
+    if (smtp_reuse (conn) && (ret = smtp_open (conn)))
       break;
     FREE (&AuthMechs);
 
@@ -329,24 +503,31 @@ mutt_smtp_send (const ADDRESS* from, const ADDRESS* to, const ADDRESS* cc,
 	 addresses_use_unicode(bcc)))
       ret += snprintf (buf + ret, sizeof (buf) - ret, " SMTPUTF8");
     safe_strncat (buf, sizeof (buf), "\r\n", 3);
-    if (mutt_socket_write (conn, buf) == -1)
-    {
-      ret = smtp_err_write;
-      break;
-    }
-    if ((ret = smtp_get_resp (conn)))
-      break;
 
-    /* send the recipient list */
-    if ((ret = smtp_rcpt_to (conn, to)) || (ret = smtp_rcpt_to (conn, cc))
-        || (ret = smtp_rcpt_to (conn, bcc)))
+    /* send the envelope */
+    mutt_buffer_addstr (cmds, buf);
+    ncmds = 1;
+    ncmds += smtp_rcpt_to (cmds, to);
+    ncmds += smtp_rcpt_to (cmds, cc);
+    ncmds += smtp_rcpt_to (cmds, bcc);
+    if ((ret = smtp_exec_cmds (conn, cmds, ncmds)))
       break;
 
     /* send the message data */
     if ((ret = smtp_data (conn, msgfile)))
       break;
 
-    mutt_socket_write (conn, "QUIT\r\n");
+    if (SmtpIdleTimeout > 0)
+    {
+      /* keep it around for the next message */
+      IdleConn = conn;
+      IdleSince = time (NULL);
+      IdleEsmtp = Esmtp;
+      conn->conn_dispatch = smtp_idle_dispatch;
+      conn = NULL;
+    }
+    else
+      mutt_socket_write (conn, "QUIT\r\n");
 
     ret = 0;
   }
@@ -354,6 +535,7 @@ mutt_smtp_send (const ADDRESS* from, const ADDRESS* to, const ADDRESS* cc,
 
   if (conn)
     mutt_socket_close (conn);
+  mutt_buffer_pool_release (&cmds);
 
   if (ret == smtp_err_read)
     mutt_error (_("SMTP session failed: read error"));